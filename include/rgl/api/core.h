@@ -199,6 +199,72 @@ typedef enum
 	RGL_FIELD_DYNAMIC_FORMAT = 13842,
 } rgl_field_t;
 
+/**
+ * Implementations of raytracing available for RaytraceNode.
+ */
+typedef enum : int
+{
+	RGL_RAYTRACE_BACKEND_OPTIX = 0,  // GPU-accelerated raytracing (default)
+	RGL_RAYTRACE_BACKEND_CPU = 1,    // Multithreaded reference implementation, intended for testing and low ray counts
+} rgl_raytrace_backend_t;
+
+/**
+ * Parts of node execution measured by the graph profiler.
+ */
+typedef enum : int
+{
+	RGL_PROFILE_PHASE_SCHEDULE = 0,    // Enqueuing the node's work, done on each run
+	RGL_PROFILE_PHASE_FIELD_DATA = 1,  // Lazy computation of the node's output, done on request of its children
+} rgl_profile_phase_t;
+
+/**
+ * Timing statistics of a node, computed over the profiler's window of the last runs. Times are in milliseconds.
+ * Host time is spent by the thread scheduling the node, GPU time by the work it enqueued.
+ */
+typedef struct
+{
+	rgl_node_t node;
+	rgl_profile_phase_t phase;
+	int32_t sample_count;
+	float host_min_ms;
+	float host_avg_ms;
+	float host_p99_ms;
+	float gpu_min_ms;
+	float gpu_avg_ms;
+	float gpu_p99_ms;
+} rgl_node_profile_t;
+
+/**
+ * Memory pools caching buffers released by RGL for reuse by later allocations of a similar size.
+ * Buffers of each memory mode (see rgl_memory_mode_t) are pooled separately; settings and statistics cover all of them.
+ */
+typedef enum : int
+{
+	RGL_MEMORY_POOL_DEVICE = 0,       // GPU memory, 512 MiB of cache by default
+	RGL_MEMORY_POOL_HOST_PINNED = 1,  // Page-locked host memory used for transfers, 128 MiB of cache by default
+} rgl_memory_pool_t;
+
+/**
+ * Kinds of memory backing RGL buffers which are accessed both by the host and the device (e.g. node results).
+ */
+typedef enum : int
+{
+	RGL_MEMORY_MODE_AUTO = 0,      // Mapped on integrated GPUs (e.g. Jetson), discrete otherwise; the default
+	RGL_MEMORY_MODE_DISCRETE = 1,  // Separate host and device allocations, copied between on access
+	RGL_MEMORY_MODE_MANAGED = 2,   // Managed memory (cudaMallocManaged) migrated by the driver, no copies
+	RGL_MEMORY_MODE_MAPPED = 3,    // Page-locked host memory mapped for the device (cudaHostAllocMapped), no copies
+} rgl_memory_mode_t;
+
+/**
+ * Kinds of user buffers which RGL can write results to, see rgl_graph_bind_result_buffer.
+ */
+typedef enum : int
+{
+	RGL_RESULT_BUFFER_HOST = 0,         // Pageable host memory, page-locked by RGL while bound (cudaHostRegister)
+	RGL_RESULT_BUFFER_HOST_PINNED = 1,  // Host memory already page-locked by the caller (e.g. cudaMallocHost)
+	RGL_RESULT_BUFFER_DEVICE = 2,       // CUDA device memory, e.g. for interop with other GPU consumers
+} rgl_result_buffer_t;
+
 /******************************** GENERAL ********************************/
 
 /**
@@ -225,6 +291,37 @@ rgl_get_version_info(int32_t *out_major, int32_t *out_minor, int32_t *out_patch)
 RGL_API rgl_status_t
 rgl_configure_logging(rgl_log_level_t log_level, const char* log_file_path, bool use_stdout);
 
+/**
+ * Limits the amount of released memory the given pool keeps for reuse.
+ * Cached memory exceeding the new limit is returned to the system immediately.
+ * @param pool Memory pool to configure
+ * @param cache_limit_bytes Maximum number of cached bytes, 0 disables caching
+ */
+RGL_API rgl_status_t
+rgl_configure_memory_pool(rgl_memory_pool_t pool, int64_t cache_limit_bytes);
+
+/**
+ * Selects the kind of memory backing buffers shared by the host and the device.
+ * Buffers created before the call (e.g. by existing nodes) keep their memory, so it should be called before creating nodes.
+ * Managed memory cannot be accessed by the host while any kernel runs on GPUs without concurrent managed access,
+ * which includes integrated ones; therefore, it is never selected automatically.
+ * @param mode Memory mode to use for buffers created afterwards
+ */
+RGL_API rgl_status_t
+rgl_configure_memory_mode(rgl_memory_mode_t mode);
+
+/**
+ * Returns statistics of the given memory pool. Sizes are rounded up to the pool's size classes.
+ * @param pool Memory pool to query
+ * @param out_used_bytes Address to store the number of bytes held by RGL objects
+ * @param out_cached_bytes Address to store the number of released bytes kept for reuse
+ * @param out_hit_count Address to store the number of allocations served from the cache
+ * @param out_miss_count Address to store the number of allocations which had to be made in the system
+ */
+RGL_API rgl_status_t
+rgl_get_memory_pool_stats(rgl_memory_pool_t pool, int64_t* out_used_bytes, int64_t* out_cached_bytes,
+                          int64_t* out_hit_count, int64_t* out_miss_count);
+
 /**
  * Returns a pointer to a string explaining last error. This function always succeeds.
  * Returned pointer is valid only until next RGL API call.
@@ -280,6 +377,32 @@ rgl_mesh_update_vertices(rgl_mesh_t mesh,
                          const rgl_vec3f *vertices,
                          int32_t vertex_count);
 
+/**
+ * Updates vertex data of many meshes in a single call. Equivalent to calling rgl_mesh_update_vertices for each mesh.
+ * Vertices are uploaded asynchronously and take effect in the next rgl_graph_run,
+ * so that updates for the next frame may overlap with raytracing of the current one.
+ * All arguments are validated before any mesh is modified.
+ * @param meshes Array of meshes to modify
+ * @param vertices Array of pointers to vertex arrays (rgl_vec3f or binary-compatible data), one per mesh
+ * @param vertex_counts Array of vertex counts, one per mesh. Each must be equal to the original vertex count of the mesh!
+ * @param mesh_count Number of elements in the meshes, vertices and vertex_counts arrays
+ */
+RGL_API rgl_status_t
+rgl_mesh_update_vertices_many(const rgl_mesh_t *meshes,
+                              const rgl_vec3f *const *vertices,
+                              const int32_t *vertex_counts,
+                              int32_t mesh_count);
+
+/**
+ * Enables or disables deduplication of meshes. Disabled by default.
+ * When enabled, meshes created with identical vertices and indices share GPU memory and acceleration structure.
+ * Updating vertices of such mesh makes a private copy of its data first, other meshes are not affected.
+ * The setting affects meshes created after the call.
+ * @param enabled If true, rgl_mesh_create will deduplicate meshes.
+ */
+RGL_API rgl_status_t
+rgl_configure_mesh_deduplication(bool enabled);
+
 
 /******************************** ENTITY ********************************/
 
@@ -309,6 +432,21 @@ rgl_entity_destroy(rgl_entity_t entity);
 RGL_API rgl_status_t
 rgl_entity_set_pose(rgl_entity_t entity, const rgl_mat3x4f *local_to_world_tf);
 
+/**
+ * Makes the given entity move during the scan, e.g. to simulate rolling-shutter distortion of spinning lidars.
+ * The entity's transform is interpolated between the given ones according to the time offset of each ray
+ * (see rgl_node_rays_set_time_offsets). Outside of [time_begin, time_end] the entity stays at the nearest given pose.
+ * Calling rgl_entity_set_pose makes the entity static again.
+ * @param entity Entity to modify
+ * @param begin_local_to_world_tf Pointer to rgl_mat3x4f representing (entity -> world) transform at time_begin.
+ * @param end_local_to_world_tf Pointer to rgl_mat3x4f representing (entity -> world) transform at time_end.
+ * @param time_begin Time offset (in seconds) of the begin pose.
+ * @param time_end Time offset (in seconds) of the end pose, must be greater than time_begin.
+ */
+RGL_API rgl_status_t
+rgl_entity_set_pose_motion(rgl_entity_t entity, const rgl_mat3x4f *begin_local_to_world_tf,
+                           const rgl_mat3x4f *end_local_to_world_tf, float time_begin, float time_end);
+
 
 /**
  * Set laser retro value for the given entity.
@@ -318,6 +456,40 @@ rgl_entity_set_pose(rgl_entity_t entity, const rgl_mat3x4f *local_to_world_tf);
 RGL_API rgl_status_t
 rgl_entity_set_laser_retro(rgl_entity_t entity, float retro);
 
+/******************************** SCENE ********************************/
+
+/**
+ * Builds acceleration structures of all meshes and entities added to the scene so far.
+ * GASes of meshes that have not been built yet are built in a single batch.
+ * Intended to be called after loading a level, so that its cost is not paid inside the first rgl_graph_run.
+ * Calling it is optional, the scene is prepared lazily otherwise.
+ * @param scene Scene to prepare. Pass NULL to use the default scene.
+ */
+RGL_API rgl_status_t
+rgl_scene_prepare(rgl_scene_t scene);
+
+/**
+ * Configures compaction of mesh acceleration structures (GAS), which reduces their GPU memory usage.
+ * Compaction is performed in the background, in the course of rgl_graph_run calls,
+ * for meshes which have not been modified for the given number of runs.
+ * It continues as long as the memory used by GASes exceeds the given budget.
+ * By default, every mesh that has not been modified for 30 runs is compacted.
+ * @param scene Scene to configure. Pass NULL to use the default scene.
+ * @param stable_run_count Number of graph runs without modification after which a mesh can be compacted.
+ * @param memory_budget Number of bytes that GASes may occupy without being compacted.
+ */
+RGL_API rgl_status_t
+rgl_scene_configure_compaction(rgl_scene_t scene, int32_t stable_run_count, int64_t memory_budget);
+
+/**
+ * Obtains statistics of mesh acceleration structure (GAS) compaction.
+ * @param scene Scene to query. Pass NULL to use the default scene.
+ * @param out_compacted_count Address to store the number of compacted GASes.
+ * @param out_bytes_saved Address to store the number of GPU memory bytes released by compaction.
+ */
+RGL_API rgl_status_t
+rgl_scene_get_compaction_stats(rgl_scene_t scene, int64_t* out_compacted_count, int64_t* out_bytes_saved);
+
 /******************************** NODES ********************************/
 
 /**
@@ -345,6 +517,19 @@ rgl_node_rays_from_mat3x4f(rgl_node_t* node, const rgl_mat3x4f* rays, int32_t ra
 RGL_API rgl_status_t
 rgl_node_rays_set_ring_ids(rgl_node_t* node, const int32_t* ring_ids, int32_t ring_ids_count);
 
+/**
+ * Creates or modifies SetTimeOffsetsRaysNode.
+ * The node assigns firing time to existing rays. Each ray intersects moving entities at its own time offset
+ * (see rgl_entity_set_pose_motion), which is also reported in RGL_FIELD_TIME_STAMP_F64.
+ * Input: rays
+ * Output: rays
+ * @param node If (*node) == nullptr, a new node will be created. Otherwise, (*node) will be modified.
+ * @param time_offsets Pointer to time offsets (in seconds) of rays, relative to the beginning of the scan.
+ * @param time_offsets_count Size of the `time_offsets` array, must be equal to the number of rays.
+ */
+RGL_API rgl_status_t
+rgl_node_rays_set_time_offsets(rgl_node_t* node, const float* time_offsets, int32_t time_offsets_count);
+
 /**
  * Creates or modifies TransformRaysNode.
  * Effectively, the node performs the following operation for all rays: `outputRay[i] = (*transform) * inputRay[i]`
@@ -384,6 +569,26 @@ rgl_node_points_transform(rgl_node_t* node, const rgl_mat3x4f* transform);
 RGL_API rgl_status_t
 rgl_node_raytrace(rgl_node_t* node, rgl_scene_t scene, float range);
 
+/**
+ * Selects implementation of raytracing used by the given RaytraceNode.
+ * Both backends produce the same fields for the same scene and rays.
+ * @param node RaytraceNode to modify
+ * @param backend Backend to use, RGL_RAYTRACE_BACKEND_OPTIX by default
+ */
+RGL_API rgl_status_t
+rgl_node_raytrace_set_backend(rgl_node_t node, rgl_raytrace_backend_t backend);
+
+/**
+ * Makes the given RaytraceNode record up to return_count nearest hits of every ray (multi-return lidars), 1 by default.
+ * The node outputs return_count points per ray; the k-th point of the ray is its k-th hit ordered by distance.
+ * Field RGL_FIELD_RETURN_TYPE_U8 holds that ordinal (0 is the first return, the last return has the highest one).
+ * Points of missing returns are non-hits, which can be removed with rgl_node_points_compact.
+ * @param node RaytraceNode to modify
+ * @param return_count Number of hits to record per ray, from 1 to 4
+ */
+RGL_API rgl_status_t
+rgl_node_raytrace_set_return_count(rgl_node_t node, int32_t return_count);
+
 /**
  * Creates or modifies FormatNode.
  * The node converts internal representation into a binary format defined by `fields` array.
@@ -445,12 +650,123 @@ rgl_node_points_write_pcd_file(rgl_node_t* node, const char* file_path);
 
 /**
  * Starts execution of the RGL graph containing provided node.
- * This function is asynchronous.
+ * This function is asynchronous: it validates the graph, enqueues its execution and returns.
+ * Each graph executes in its own stream and worker thread, concurrently with other graphs.
+ * Calls reading results or modifying the graph, its scene, meshes or entities wait until the execution is finished.
  * @param node Any node from the graph to execute
  */
 RGL_API rgl_status_t
 rgl_graph_run(rgl_node_t node);
 
+/**
+ * Blocks until the last execution of the RGL graph containing provided node is finished.
+ * Errors raised during the execution are reported by this call (or by the first one that waits for the graph).
+ * @param node Any node from the graph to wait for
+ */
+RGL_API rgl_status_t
+rgl_graph_wait(rgl_node_t node);
+
+/**
+ * Checks without blocking whether the last execution of the RGL graph containing provided node is finished.
+ * Graphs that were never run are reported as done.
+ * @param node Any node from the graph to check
+ * @param out_done Returns true if results of the graph are available without waiting
+ */
+RGL_API rgl_status_t
+rgl_graph_is_done(rgl_node_t node, bool* out_done);
+
+/**
+ * Enables or disables replaying the RGL graph containing provided node from a CUDA graph. Disabled by default.
+ * When enabled, a graph run twice without changes is recorded into a CUDA graph, which subsequent runs launch
+ * instead of scheduling nodes one by one. Changes of node parameters or of the scene update the recording,
+ * changes of the graph structure or of buffer sizes make the graph execute as usual until it is recorded again.
+ * Graphs containing nodes which cannot be recorded (e.g. CPU raytracing, bound result buffers) always execute as usual.
+ * @param node Any node from the graph to configure
+ * @param enabled If true, the graph will be recorded and replayed
+ */
+RGL_API rgl_status_t
+rgl_graph_configure_capture(rgl_node_t node, bool enabled);
+
+/**
+ * Sets how many runs (frames) of the RGL graph containing provided node may be in flight. Default is 1.
+ * With depth N > 1, rgl_graph_run returns without waiting for the GPU part of the previous frames,
+ * so that preparing the next frame overlaps with raytracing and post-processing of the previous ones.
+ * Yield nodes keep results of the last N frames, see rgl_graph_get_frame_result_data.
+ * Results of frames run before this call become unavailable.
+ * Pipelined graphs are not replayed from a CUDA graph (see rgl_graph_configure_capture).
+ * @param node Any node from the graph to configure
+ * @param depth Number of frames in flight, between 1 and 3
+ */
+RGL_API rgl_status_t
+rgl_graph_configure_pipeline(rgl_node_t node, int32_t depth);
+
+/**
+ * Returns id of the frame started by the last rgl_graph_run of the graph containing provided node.
+ * Frames are numbered consecutively from 0; -1 is returned if the graph was never run.
+ * @param node Any node from the graph
+ * @param out_frame_id Address to store the frame id
+ */
+RGL_API rgl_status_t
+rgl_graph_get_frame_id(rgl_node_t node, int64_t* out_frame_id);
+
+/**
+ * Enables or disables profiling of the RGL graph containing provided node. Disabled by default.
+ * When enabled, host and GPU time of each node is measured on every run; this adds a small overhead
+ * and disables replaying the graph from a CUDA graph. Configuration discards previously collected samples.
+ * @param node Any node from the graph to configure
+ * @param enabled If true, runs of the graph will be profiled
+ * @param window_size Number of the last runs used to compute statistics, must be positive
+ */
+RGL_API rgl_status_t
+rgl_graph_configure_profiling(rgl_node_t node, bool enabled, int32_t window_size);
+
+/**
+ * Obtains timing statistics of nodes of the RGL graph containing provided node, see rgl_node_profile_t.
+ * Waits for the graph to finish. Nodes that compute their outputs lazily have a separate entry for that phase.
+ * @param node Any node from the graph
+ * @param out_profiles Buffer for the statistics; may be NULL to query only their count
+ * @param capacity Number of elements the buffer can hold; statistics beyond it are not written
+ * @param out_count Address to store the number of available statistics
+ */
+RGL_API rgl_status_t
+rgl_graph_get_profile(rgl_node_t node, rgl_node_profile_t* out_profiles, int32_t capacity, int32_t* out_count);
+
+/**
+ * Writes the samples of the profiler's window in Chrome trace format (JSON), viewable e.g. in chrome://tracing or Perfetto.
+ * Host timeline has a track per scheduling thread, GPU timeline a track per stream.
+ * Waits for the graph to finish.
+ * @param node Any node from the graph
+ * @param file_path Path to the output file, which will be created or truncated
+ */
+RGL_API rgl_status_t
+rgl_graph_write_profile_trace(rgl_node_t node, const char* file_path);
+
+/**
+ * Configures capacity policy of buffers used by the graph's nodes.
+ * Growing buffers allocate at least growth_factor times their previous capacity, so that counts creeping up
+ * (e.g. numbers of hits) do not reallocate on every frame. Capacity exceeding the high-water mark of the last
+ * shrink_after_frames runs (with the same growth headroom) is released. Defaults are 1.5 and 128.
+ * Waits for the graph to finish.
+ * @param node Any node from the graph
+ * @param growth_factor Minimal ratio of grown to previous capacity, at least 1 (exact growth)
+ * @param shrink_after_frames Number of runs after which unused capacity is released, 0 disables shrinking
+ */
+RGL_API rgl_status_t
+rgl_graph_configure_memory(rgl_node_t node, float growth_factor, int32_t shrink_after_frames);
+
+/**
+ * Returns memory held by buffers used by the graph's nodes, and its high-water mark since the graph's creation.
+ * Buffers are attributed to the graph which used them last. Waits for the graph to finish.
+ * @param node Any node from the graph
+ * @param out_device_bytes Address to store the number of device bytes currently held
+ * @param out_device_high_water_bytes Address to store the highest number of device bytes held at once
+ * @param out_host_bytes Address to store the number of host bytes currently held
+ * @param out_host_high_water_bytes Address to store the highest number of host bytes held at once
+ */
+RGL_API rgl_status_t
+rgl_graph_get_memory_stats(rgl_node_t node, int64_t* out_device_bytes, int64_t* out_device_high_water_bytes,
+                           int64_t* out_host_bytes, int64_t* out_host_high_water_bytes);
+
 /**
  * Destroys RGL graph (all connected nodes) containing provided node.
  * @param node Any node from the graph to destroy
@@ -480,6 +796,66 @@ rgl_graph_get_result_size(rgl_node_t node, rgl_field_t field, int32_t* out_count
 RGL_API rgl_status_t
 rgl_graph_get_result_data(rgl_node_t node, rgl_field_t field, void* data);
 
+/**
+ * Obtains the size of the result of a given frame yielded by the node (see rgl_graph_configure_pipeline).
+ * Blocks until the frame is finished, but not newer frames.
+ * Fails if the frame is no longer kept, i.e. it is older than the pipeline depth, or if the node was not executed in it.
+ * @param node Yield node to get output from
+ * @param frame_id Frame id returned by rgl_graph_get_frame_id
+ * @param field Field to get output from
+ * @param out_count Returns the number of elements
+ * @param out_size_of Returns byte size of a single element
+ */
+RGL_API rgl_status_t
+rgl_graph_get_frame_result_size(rgl_node_t node, int64_t frame_id, rgl_field_t field, int32_t* out_count, int32_t* out_size_of);
+
+/**
+ * Obtains the result data of a given frame yielded by the node (see rgl_graph_configure_pipeline).
+ * Blocks until the frame is finished, but not newer frames.
+ * @param node Yield node to get output from
+ * @param frame_id Frame id returned by rgl_graph_get_frame_id
+ * @param field Field to get output from
+ * @param data Returns binary data, expects a buffer of size (*out_count) * (*out_size_of) from rgl_graph_get_frame_result_size(...) call.
+ */
+RGL_API rgl_status_t
+rgl_graph_get_frame_result_data(rgl_node_t node, int64_t frame_id, rgl_field_t field, void* data);
+
+/**
+ * Registers a user buffer as the destination of the given field of a yield node (any of its fields)
+ * or a format node (RGL_FIELD_DYNAMIC_FORMAT). Each run of the graph copies the field to the buffer asynchronously,
+ * straight from the GPU, as soon as the node produces it; the next run overwrites it.
+ * Completion can be awaited with rgl_graph_wait_result_buffer or rgl_graph_get_result_buffer_event.
+ * A run fails if the results do not fit the buffer. Nodes writing to bound buffers are not replayed from a CUDA graph.
+ * Waits for the graph to finish. The buffer must stay valid until it is unbound or the node is destroyed.
+ * @param node Yield or format node to bind the buffer to
+ * @param field Field to write to the buffer
+ * @param buffer Buffer to write to, nullptr removes the previous binding of the field
+ * @param capacity_bytes Size of the buffer in bytes
+ * @param type Kind of memory of the buffer
+ */
+RGL_API rgl_status_t
+rgl_graph_bind_result_buffer(rgl_node_t node, rgl_field_t field, void* buffer, int64_t capacity_bytes, rgl_result_buffer_t type);
+
+/**
+ * Blocks until the results of the last run are written to the buffer bound to the field, but not for the rest of the graph.
+ * @param node Node the buffer is bound to
+ * @param field Field the buffer is bound to
+ * @param out_count Returns the number of points written to the buffer
+ */
+RGL_API rgl_status_t
+rgl_graph_wait_result_buffer(rgl_node_t node, rgl_field_t field, int32_t* out_count);
+
+/**
+ * Returns CUDA event (cudaEvent_t) completed once the results of the last run are written to the buffer bound to the field.
+ * It can be waited for in caller's CUDA streams (cudaStreamWaitEvent) without blocking the host.
+ * The event is owned by RGL and re-recorded by each run; it is valid until the buffer is unbound.
+ * @param node Node the buffer is bound to
+ * @param field Field the buffer is bound to
+ * @param out_cuda_event Address to store the event
+ */
+RGL_API rgl_status_t
+rgl_graph_get_result_buffer_event(rgl_node_t node, rgl_field_t field, void** out_cuda_event);
+
 /**
  * Activates or deactivates node in the graph.
  * Children of inactive nodes do not execute as well.
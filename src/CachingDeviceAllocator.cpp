@@ -0,0 +1,177 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <CachingDeviceAllocator.hpp>
+
+#include <bit>
+#include <stdexcept>
+
+#include <Logger.hpp>
+
+const std::shared_ptr<CachingDeviceAllocator>& CachingDeviceAllocator::getInstance(MemoryMode mode)
+{
+	// Never destroyed, buffers of static objects may be released after them otherwise
+	static auto makeInstance = [](MemoryMode mode) {
+		return new std::shared_ptr<CachingDeviceAllocator>(
+			std::make_shared<CachingDeviceAllocator>(std::make_shared<CudaDeviceAllocator>(mode)));
+	};
+	static auto* discrete = makeInstance(MemoryMode::Discrete);
+	if (mode == MemoryMode::Discrete) {
+		return *discrete;
+	}
+	static auto* managed = makeInstance(MemoryMode::Managed);
+	if (mode == MemoryMode::Managed) {
+		return *managed;
+	}
+	static auto* mapped = makeInstance(MemoryMode::Mapped);
+	return *mapped;
+}
+
+CachingDeviceAllocator::CachingDeviceAllocator(DeviceAllocator::Ptr upstream) : upstream(std::move(upstream))
+{
+	pools[MemLoc::Host].cacheLimit = DEFAULT_HOST_CACHE_LIMIT;
+	pools[MemLoc::Device].cacheLimit = DEFAULT_DEVICE_CACHE_LIMIT;
+}
+
+CachingDeviceAllocator::~CachingDeviceAllocator()
+{
+	releaseCached();
+	for (auto&& event : idleEvents) {
+		upstream->destroyEvent(event);
+	}
+}
+
+std::size_t CachingDeviceAllocator::getBlockSize(std::size_t bytes)
+{
+	if (bytes > LARGE_BLOCK_SIZE) {
+		return (bytes + LARGE_BLOCK_SIZE - 1) / LARGE_BLOCK_SIZE * LARGE_BLOCK_SIZE;
+	}
+	return std::max(MIN_BLOCK_SIZE, std::bit_ceil(bytes));
+}
+
+void CachingDeviceAllocator::setCacheLimit(MemLoc location, std::size_t bytes)
+{
+	std::lock_guard lock {mutex};
+	Pool& pool = pools.at(location);
+	pool.cacheLimit = bytes;
+	trimCache(pool, location, bytes);
+}
+
+CachingDeviceAllocator::Stats CachingDeviceAllocator::getStats(MemLoc location) const
+{
+	std::lock_guard lock {mutex};
+	return pools.at(location).stats;
+}
+
+void CachingDeviceAllocator::releaseCached()
+{
+	std::lock_guard lock {mutex};
+	for (auto&& [location, pool] : pools) {
+		trimCache(pool, location, 0);
+	}
+}
+
+void* CachingDeviceAllocator::allocate(std::size_t bytes, MemLoc location)
+{
+	std::size_t blockSize = getBlockSize(bytes);
+	std::lock_guard lock {mutex};
+	Pool& pool = pools.at(location);
+	auto& blocks = pool.cachedBlocks[blockSize];
+	for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+		if (!upstream->isEventDone(it->releaseEvent)) {
+			continue;  // Still used by work enqueued before its release
+		}
+		void* ptr = it->ptr;
+		idleEvents.push_back(it->releaseEvent);
+		blocks.erase(it);
+		pool.usedBlocks[ptr] = blockSize;
+		pool.stats.cachedBytes -= blockSize;
+		pool.stats.usedBytes += blockSize;
+		pool.stats.hitCount += 1;
+		return ptr;
+	}
+
+	void* ptr = nullptr;
+	try {
+		ptr = upstream->allocate(blockSize, location);
+	}
+	catch (std::runtime_error& e) {
+		if (pool.stats.cachedBytes == 0) {
+			throw;
+		}
+		// Memory may be exhausted by blocks of other size classes
+		RGL_WARN("Allocation of {} bytes failed, releasing {} cached bytes: {}", blockSize, pool.stats.cachedBytes, e.what());
+		trimCache(pool, location, 0);
+		ptr = upstream->allocate(blockSize, location);
+	}
+	pool.usedBlocks[ptr] = blockSize;
+	pool.stats.usedBytes += blockSize;
+	pool.stats.missCount += 1;
+	return ptr;
+}
+
+void CachingDeviceAllocator::deallocate(void* ptr, MemLoc location, cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	Pool& pool = pools.at(location);
+	auto usedIt = pool.usedBlocks.find(ptr);
+	if (usedIt == pool.usedBlocks.end()) {
+		throw std::logic_error(fmt::format("attempted to release memory {} not allocated by the pool", ptr));
+	}
+	std::size_t blockSize = usedIt->second;
+	pool.usedBlocks.erase(usedIt);
+	pool.stats.usedBytes -= blockSize;
+
+	if (blockSize > pool.cacheLimit) {
+		upstream->deallocate(ptr, location, stream);
+		return;
+	}
+	cudaEvent_t releaseEvent = acquireEvent();
+	upstream->recordEvent(releaseEvent, stream);
+	pool.cachedBlocks[blockSize].push_back({ptr, releaseEvent});
+	pool.stats.cachedBytes += blockSize;
+	trimCache(pool, location, pool.cacheLimit);
+}
+
+void CachingDeviceAllocator::trimCache(Pool& pool, MemLoc location, std::size_t limit)
+{
+	// Blocks no longer used by pending work are released first, starting from the largest ones
+	for (bool waitForPendingWork : {false, true}) {
+		for (auto sizeIt = pool.cachedBlocks.rbegin(); sizeIt != pool.cachedBlocks.rend() && pool.stats.cachedBytes > limit; ++sizeIt) {
+			auto& [blockSize, blocks] = *sizeIt;
+			for (auto it = blocks.begin(); it != blocks.end() && pool.stats.cachedBytes > limit;) {
+				if (!waitForPendingWork && !upstream->isEventDone(it->releaseEvent)) {
+					++it;
+					continue;
+				}
+				upstream->synchronizeEvent(it->releaseEvent);
+				upstream->deallocate(it->ptr, location, nullptr);
+				idleEvents.push_back(it->releaseEvent);
+				pool.stats.cachedBytes -= blockSize;
+				it = blocks.erase(it);
+			}
+		}
+	}
+}
+
+cudaEvent_t CachingDeviceAllocator::acquireEvent()
+{
+	if (idleEvents.empty()) {
+		return upstream->createEvent();
+	}
+	cudaEvent_t event = idleEvents.back();
+	idleEvents.pop_back();
+	return event;
+}
@@ -0,0 +1,102 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <DeviceAllocator.hpp>
+
+/**
+ * Memory pool caching blocks released by buffers for later allocations of the same size class, separately per location.
+ * Released block becomes reusable once the work enqueued before its release in the given stream completes,
+ * which is checked with an event recorded at the release, without blocking.
+ * Cached memory exceeding the limit is returned to the upstream allocator, blocks still in use by pending work last.
+ * Other operations are forwarded to the upstream allocator.
+ */
+struct CachingDeviceAllocator : DeviceAllocator
+{
+	struct Stats
+	{
+		std::size_t usedBytes {0};    // In blocks handed out, rounded up to their size classes
+		std::size_t cachedBytes {0};  // In released blocks kept for reuse
+		std::size_t hitCount {0};     // Allocations served from the cache
+		std::size_t missCount {0};    // Allocations served by the upstream allocator
+	};
+
+	static constexpr std::size_t MIN_BLOCK_SIZE = 512;
+	static constexpr std::size_t LARGE_BLOCK_SIZE = 2 << 20;  // Larger blocks are multiples of it, smaller ones powers of two
+	static constexpr std::size_t DEFAULT_DEVICE_CACHE_LIMIT = 512 << 20;
+	static constexpr std::size_t DEFAULT_HOST_CACHE_LIMIT = 128 << 20;  // Pinned memory is taken away from the OS
+
+	// Pool of memory of the given mode, see DeviceAllocator::getDefault().
+	static const std::shared_ptr<CachingDeviceAllocator>& getInstance(MemoryMode mode=MemoryMode::Discrete);
+
+	explicit CachingDeviceAllocator(DeviceAllocator::Ptr upstream);
+	~CachingDeviceAllocator() override;
+
+	// Size class of an allocation.
+	static std::size_t getBlockSize(std::size_t bytes);
+
+	// Limit of cached bytes; zero disables caching. Excessive cached memory is released immediately.
+	void setCacheLimit(MemLoc location, std::size_t bytes);
+	Stats getStats(MemLoc location) const;
+
+	// Returns all cached memory to the upstream allocator, waiting for pending work using it.
+	void releaseCached();
+
+	// DeviceAllocator
+	void* allocate(std::size_t bytes, MemLoc location) override;
+	void deallocate(void* ptr, MemLoc location, cudaStream_t stream) override;
+	void copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream) override { upstream->copyAsync(dst, src, bytes, stream); }
+	void memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream) override { upstream->memsetAsync(dst, value, bytes, stream); }
+	cudaEvent_t createEvent() override { return upstream->createEvent(); }
+	void destroyEvent(cudaEvent_t event) override { upstream->destroyEvent(event); }
+	void recordEvent(cudaEvent_t event, cudaStream_t stream) override { upstream->recordEvent(event, stream); }
+	void streamWaitEvent(cudaStream_t stream, cudaEvent_t event) override { upstream->streamWaitEvent(stream, event); }
+	void synchronizeEvent(cudaEvent_t event) override { upstream->synchronizeEvent(event); }
+	bool isEventDone(cudaEvent_t event) override { return upstream->isEventDone(event); }
+	bool isUnified() const override { return upstream->isUnified(); }
+	void prefetchAsync(const void* ptr, std::size_t bytes, MemLoc location, cudaStream_t stream) override { upstream->prefetchAsync(ptr, bytes, location, stream); }
+
+private:
+	struct CachedBlock
+	{
+		void* ptr;
+		cudaEvent_t releaseEvent;  // Recorded in the stream given on release
+	};
+
+	struct Pool
+	{
+		std::map<std::size_t, std::deque<CachedBlock>> cachedBlocks;  // By size class, in order of release
+		std::unordered_map<void*, std::size_t> usedBlocks;            // Size classes of blocks handed out
+		std::size_t cacheLimit;
+		Stats stats;
+	};
+
+	// Callers hold the mutex
+	void trimCache(Pool& pool, MemLoc location, std::size_t limit);
+	cudaEvent_t acquireEvent();
+
+private:
+	DeviceAllocator::Ptr upstream;
+	mutable std::mutex mutex;  // Buffers are allocated and released by all threads scheduling graphs
+	std::map<MemLoc, Pool> pools;
+	std::vector<cudaEvent_t> idleEvents;
+};
@@ -0,0 +1,156 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <DeviceAllocator.hpp>
+#include <CachingDeviceAllocator.hpp>
+
+#include <atomic>
+
+#include <macros/cuda.hpp>
+#include <Logger.hpp>
+
+static std::atomic<std::optional<MemoryMode>> configuredMode;
+
+DeviceAllocator::Ptr DeviceAllocator::getDefault()
+{
+	return CachingDeviceAllocator::getInstance(getDefaultMode());
+}
+
+MemoryMode DeviceAllocator::getDefaultMode()
+{
+	std::optional<MemoryMode> mode = configuredMode.load();
+	if (mode.has_value()) {
+		return *mode;
+	}
+	static MemoryMode detectedMode = CudaDeviceAllocator::detectMode();
+	return detectedMode;
+}
+
+void DeviceAllocator::setDefaultMode(std::optional<MemoryMode> mode)
+{
+	configuredMode.store(mode);
+}
+
+CudaDeviceAllocator::CudaDeviceAllocator(MemoryMode mode) : mode(mode)
+{
+	if (mode == MemoryMode::Managed) {
+		int concurrentManagedAccess = 0;
+		CHECK_CUDA(cudaGetDevice(&device));
+		CHECK_CUDA(cudaDeviceGetAttribute(&concurrentManagedAccess, cudaDevAttrConcurrentManagedAccess, device));
+		canPrefetch = concurrentManagedAccess != 0;
+	}
+}
+
+MemoryMode CudaDeviceAllocator::detectMode()
+{
+	int device = 0;
+	int integrated = 0;
+	int canMapHostMemory = 0;
+	CHECK_CUDA(cudaGetDevice(&device));
+	CHECK_CUDA(cudaDeviceGetAttribute(&integrated, cudaDevAttrIntegrated, device));
+	CHECK_CUDA(cudaDeviceGetAttribute(&canMapHostMemory, cudaDevAttrCanMapHostMemory, device));
+	MemoryMode mode = integrated && canMapHostMemory ? MemoryMode::Mapped : MemoryMode::Discrete;
+	RGL_DEBUG("Detected {} GPU, using {} memory", integrated ? "integrated" : "discrete",
+	          mode == MemoryMode::Mapped ? "mapped" : "discrete");
+	return mode;
+}
+
+void* CudaDeviceAllocator::allocate(std::size_t bytes, MemLoc location)
+{
+	void* ptr = nullptr;
+	if (mode == MemoryMode::Managed) {
+		CHECK_CUDA(cudaMallocManaged(&ptr, bytes));
+		return ptr;
+	}
+	if (mode == MemoryMode::Mapped) {
+		// With unified addressing the host pointer is valid on the device as well
+		CHECK_CUDA(cudaHostAlloc(&ptr, bytes, cudaHostAllocMapped));
+		return ptr;
+	}
+	if (location == MemLoc::Host) {
+		CHECK_CUDA(cudaMallocHost(&ptr, bytes));
+	}
+	if (location == MemLoc::Device) {
+		CHECK_CUDA(cudaMalloc(&ptr, bytes));
+	}
+	return ptr;
+}
+
+void CudaDeviceAllocator::deallocate(void* ptr, MemLoc location, cudaStream_t stream)
+{
+	// Both functions synchronize the device implicitly, which covers work pending in the stream
+	if (mode == MemoryMode::Mapped || (mode == MemoryMode::Discrete && location == MemLoc::Host)) {
+		CHECK_CUDA(cudaFreeHost(ptr));
+	}
+	else {
+		CHECK_CUDA(cudaFree(ptr));
+	}
+}
+
+void CudaDeviceAllocator::prefetchAsync(const void* ptr, std::size_t bytes, MemLoc location, cudaStream_t stream)
+{
+	// Mapped memory is not migrated, managed memory follows accesses anyway; prefetching only saves page faults
+	if (!canPrefetch) {
+		return;
+	}
+	CHECK_CUDA(cudaMemPrefetchAsync(ptr, bytes, location == MemLoc::Device ? device : cudaCpuDeviceId, stream));
+}
+
+void CudaDeviceAllocator::copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream)
+{
+	CHECK_CUDA(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDefault, stream));
+}
+
+void CudaDeviceAllocator::memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream)
+{
+	CHECK_CUDA(cudaMemsetAsync(dst, value, bytes, stream));
+}
+
+cudaEvent_t CudaDeviceAllocator::createEvent()
+{
+	cudaEvent_t event = nullptr;
+	CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+	return event;
+}
+
+void CudaDeviceAllocator::destroyEvent(cudaEvent_t event)
+{
+	CHECK_CUDA(cudaEventDestroy(event));
+}
+
+void CudaDeviceAllocator::recordEvent(cudaEvent_t event, cudaStream_t stream)
+{
+	CHECK_CUDA(cudaEventRecord(event, stream));
+}
+
+void CudaDeviceAllocator::streamWaitEvent(cudaStream_t stream, cudaEvent_t event)
+{
+	CHECK_CUDA(cudaStreamWaitEvent(stream, event));
+}
+
+void CudaDeviceAllocator::synchronizeEvent(cudaEvent_t event)
+{
+	CHECK_CUDA(cudaEventSynchronize(event));
+}
+
+bool CudaDeviceAllocator::isEventDone(cudaEvent_t event)
+{
+	cudaError_t status = cudaEventQuery(event);
+	if (status == cudaErrorNotReady) {
+		return false;
+	}
+	CHECK_CUDA(status);
+	return true;
+}
@@ -0,0 +1,106 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include <cuda_runtime_api.h>
+
+enum struct MemLoc
+{
+	Host,
+	Device
+};
+
+/**
+ * Kind of memory backing both locations of VArrays.
+ * Discrete mode keeps separate host (pinned) and device allocations, copied between on demand.
+ * Managed and mapped modes allocate memory accessible from both, so that locations share a single allocation;
+ * they pay off on integrated GPUs (e.g. Jetson), where host and device share the physical memory anyway.
+ */
+enum struct MemoryMode
+{
+	Discrete,
+	Managed,  // cudaMallocManaged, migrated between locations by the driver (prefetched if the device supports it)
+	Mapped,   // Pinned host memory mapped into the device address space (cudaHostAllocMapped)
+};
+
+/**
+ * Memory and stream operations used by VArray.
+ * Abstracts CUDA runtime away from VArray, so that its bookkeeping of streams can be tested with a fake.
+ */
+struct DeviceAllocator
+{
+	using Ptr = std::shared_ptr<DeviceAllocator>;
+	virtual ~DeviceAllocator() = default;
+
+	// Memory pool of the default mode backed by CUDA runtime (see CachingDeviceAllocator), used by VArrays unless given another allocator.
+	// Changing the default mode affects only arrays created afterwards; arrays release memory to the allocator they got it from.
+	static DeviceAllocator::Ptr getDefault();
+	static MemoryMode getDefaultMode();
+	static void setDefaultMode(std::optional<MemoryMode> mode);  // Empty selects the mode based on device attributes
+
+	// True if memory allocated for any location is accessible from both, i.e. VArrays need not copy data between them.
+	virtual bool isUnified() const { return false; }
+
+	// Hint to migrate unified memory to the location ahead of work enqueued in the stream after it.
+	virtual void prefetchAsync(const void* ptr, std::size_t bytes, MemLoc location, cudaStream_t stream) {}
+
+	virtual void* allocate(std::size_t bytes, MemLoc location) = 0;
+
+	// Memory may still be accessed by work enqueued in the stream, it must not be reused before that work completes.
+	// Other work using the memory must be ordered before the tail of the stream (e.g. legacy stream follows blocking streams).
+	virtual void deallocate(void* ptr, MemLoc location, cudaStream_t stream) = 0;
+
+	virtual void copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream) = 0;
+	virtual void memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream) = 0;
+
+	virtual cudaEvent_t createEvent() = 0;
+	virtual void destroyEvent(cudaEvent_t event) = 0;
+	virtual void recordEvent(cudaEvent_t event, cudaStream_t stream) = 0;
+	virtual void streamWaitEvent(cudaStream_t stream, cudaEvent_t event) = 0;
+	virtual void synchronizeEvent(cudaEvent_t event) = 0;
+	virtual bool isEventDone(cudaEvent_t event) = 0;
+};
+
+struct CudaDeviceAllocator : DeviceAllocator
+{
+	explicit CudaDeviceAllocator(MemoryMode mode=MemoryMode::Discrete);
+
+	// Mapped memory on integrated GPUs, discrete memory otherwise. Managed memory is not selected automatically:
+	// integrated GPUs lack concurrent managed access, so the host could not touch any managed memory while kernels run.
+	static MemoryMode detectMode();
+
+	bool isUnified() const override { return mode != MemoryMode::Discrete; }
+	void prefetchAsync(const void* ptr, std::size_t bytes, MemLoc location, cudaStream_t stream) override;
+	void* allocate(std::size_t bytes, MemLoc location) override;
+	void deallocate(void* ptr, MemLoc location, cudaStream_t stream) override;
+	void copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream) override;
+	void memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream) override;
+	cudaEvent_t createEvent() override;
+	void destroyEvent(cudaEvent_t event) override;
+	void recordEvent(cudaEvent_t event, cudaStream_t stream) override;
+	void streamWaitEvent(cudaStream_t stream, cudaEvent_t event) override;
+	void synchronizeEvent(cudaEvent_t event) override;
+	bool isEventDone(cudaEvent_t event) override;
+
+private:
+	MemoryMode mode;
+	int device {0};
+	bool canPrefetch {false};  // Managed memory can be prefetched only with concurrent managed access
+};
@@ -23,6 +23,7 @@
 
 #include <Logger.hpp>
 #include <HostPinnedBuffer.hpp>
+#include <CachingDeviceAllocator.hpp>
 
 #include <macros/cuda.hpp>
 
@@ -52,7 +53,12 @@ public:
 	~DeviceBuffer()
 	{
 		if (data != nullptr) {
-			cudaFree(data);
+			try {
+				CachingDeviceAllocator::getInstance()->deallocate(data, MemLoc::Device, nullptr);
+			}
+			catch (std::exception&) {
+				// CUDA runtime may be already unloaded when static objects are destroyed
+			}
 			data = nullptr;
 		}
 	}
@@ -71,6 +77,41 @@ public:
 		elemCount = srcElemCount;
 	}
 
+	// Overwrites a part of the existing buffer, does not change its size.
+	void copyFromHostAtAsync(const T* src, std::size_t srcElemCount, std::size_t dstElemOffset, cudaStream_t stream)
+	{
+		if (dstElemOffset + srcElemCount > elemCount) {
+			auto msg = fmt::format("DeviceBuffer: attempted to write elements [{}, {}) of a buffer holding {} elements",
+			                       dstElemOffset, dstElemOffset + srcElemCount, elemCount);
+			throw std::out_of_range(msg);
+		}
+		CHECK_CUDA(cudaMemcpyAsync(data + dstElemOffset, src, srcElemCount * sizeof(T), cudaMemcpyHostToDevice, stream));
+	}
+
+	void copyFromDevice(const DeviceBuffer<T>& src)
+	{
+		ensureDeviceCanFit(src.getElemCount());
+		CHECK_CUDA(cudaMemcpy(data, src.readDevice(), src.getElemCount() * sizeof(T), cudaMemcpyDeviceToDevice));
+		elemCount = src.getElemCount();
+	}
+
+	void copyFromDeviceAsync(const DeviceBuffer<T>& src, cudaStream_t stream)
+	{
+		ensureDeviceCanFit(src.getElemCount());
+		CHECK_CUDA(cudaMemcpyAsync(data, src.readDevice(), src.getElemCount() * sizeof(T), cudaMemcpyDeviceToDevice, stream));
+		elemCount = src.getElemCount();
+	}
+
+	void copyFromHostAsync(const HostPinnedBuffer<T>& src, cudaStream_t stream)
+	{
+		copyFromHostAsync(src.readHost(), src.getElemCount(), stream);
+	}
+
+	void copyToHost(T* dst) const
+	{
+		CHECK_CUDA(cudaMemcpy(dst, data, elemCount * sizeof(T), cudaMemcpyDeviceToHost));
+	}
+
 	void copyFromHost(const HostPinnedBuffer<int>& src)
 	{
 		copyFromHost(src.readHost(), src.getElemCount());
@@ -119,12 +160,13 @@ private:
 		if (elemCapacity >= newElemCount) {
 			return false;
 		}
+		// Released memory is reused once the work enqueued before in the legacy stream (which follows blocking streams) is done
 		if (data != nullptr) {
-			CHECK_CUDA(cudaFree(data));
+			CachingDeviceAllocator::getInstance()->deallocate(data, MemLoc::Device, nullptr);
 			data = nullptr;
 		}
 		if (newElemCount > 0) {
-			CHECK_CUDA(cudaMalloc(reinterpret_cast<void**>(&data), newElemCount * sizeof(T)));
+			data = static_cast<T*>(CachingDeviceAllocator::getInstance()->allocate(newElemCount * sizeof(T), MemLoc::Device));
 		}
 		elemCapacity = newElemCount;
 		return true;
@@ -16,11 +16,13 @@
 
 #pragma once
 
+#include <cstring>
 #include <type_traits>
 #include <optional>
 #include "Logger.hpp"
 #include "DeviceBuffer.hpp"
 #include <macros/cuda.hpp>
+#include <CachingDeviceAllocator.hpp>
 
 template<typename T>
 struct DeviceBuffer;
@@ -46,7 +48,12 @@ public:
 	~HostPinnedBuffer()
 	{
 		if (data != nullptr) {
-			cudaFreeHost(data);
+			try {
+				CachingDeviceAllocator::getInstance()->deallocate(data, MemLoc::Host, nullptr);
+			}
+			catch (std::exception&) {
+				// CUDA runtime may be already unloaded when static objects are destroyed
+			}
 		}
 	}
 
@@ -57,6 +64,13 @@ public:
 		elemCount = src.getElemCount();
 	}
 
+	void copyFromHost(const T* src, std::size_t srcElemCount)
+	{
+		ensureHostCanFit(srcElemCount);
+		std::memcpy(data, src, srcElemCount * sizeof(T));
+		elemCount = srcElemCount;
+	}
+
 	const T* readHost() const
 	{
 		return data;
@@ -77,9 +91,9 @@ private:
 			return;
 		}
 		if (data != nullptr) {
-			CHECK_CUDA(cudaFreeHost(data));
+			CachingDeviceAllocator::getInstance()->deallocate(data, MemLoc::Host, nullptr);
 		}
-		CHECK_CUDA(cudaMallocHost(reinterpret_cast<void**>(&data), newElemCount * sizeof(T)));
+		data = static_cast<T*>(CachingDeviceAllocator::getInstance()->allocate(newElemCount * sizeof(T), MemLoc::Host));
 		elemCapacity = newElemCount;
 	}
 };
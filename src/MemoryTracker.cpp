@@ -0,0 +1,63 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <MemoryTracker.hpp>
+
+#include <algorithm>
+
+thread_local MemoryTracker* MemoryTracker::active = nullptr;
+
+MemoryTracker::Activation::Activation(MemoryTracker* tracker) : previous(active)
+{
+	active = tracker;
+}
+
+MemoryTracker::Activation::~Activation()
+{
+	active = previous;
+}
+
+void MemoryTracker::setPolicy(const CapacityPolicy& newPolicy)
+{
+	std::lock_guard lock {mutex};
+	policy = newPolicy;
+}
+
+MemoryTracker::CapacityPolicy MemoryTracker::getPolicy() const
+{
+	std::lock_guard lock {mutex};
+	return policy;
+}
+
+void MemoryTracker::onAllocated(MemLoc location, std::size_t bytes)
+{
+	std::lock_guard lock {mutex};
+	Stats& locationStats = stats[location];
+	locationStats.currentBytes += bytes;
+	locationStats.highWaterBytes = std::max(locationStats.highWaterBytes, locationStats.currentBytes);
+}
+
+void MemoryTracker::onReleased(MemLoc location, std::size_t bytes)
+{
+	std::lock_guard lock {mutex};
+	stats[location].currentBytes -= bytes;
+}
+
+MemoryTracker::Stats MemoryTracker::getStats(MemLoc location) const
+{
+	std::lock_guard lock {mutex};
+	auto it = stats.find(location);
+	return it != stats.end() ? it->second : Stats {};
+}
@@ -0,0 +1,79 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <DeviceAllocator.hpp>
+
+/**
+ * Accounts memory of VArrays used by a single graph and provides the policy of their capacity.
+ * Arrays are attributed to the tracker active on the thread resizing them (see Activation), i.e. to the graph using them last.
+ * Frames are counted by the graph's runner; arrays shrink when their capacity exceeds the need of recent frames (see VArray).
+ */
+struct MemoryTracker : std::enable_shared_from_this<MemoryTracker>
+{
+	using Ptr = std::shared_ptr<MemoryTracker>;
+
+	struct CapacityPolicy
+	{
+		float growthFactor {1.5f};        // Growing capacity is at least this multiple of the previous one
+		int32_t shrinkAfterFrames {128};  // Capacity above the high-water mark of that many frames is released; 0 disables
+	};
+
+	struct Stats
+	{
+		std::size_t currentBytes {0};
+		std::size_t highWaterBytes {0};
+	};
+
+	// Makes the tracker (or none, if nullptr) active on the calling thread for the lifetime of the object.
+	struct Activation
+	{
+		explicit Activation(MemoryTracker* tracker);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+
+	private:
+		MemoryTracker* previous;
+	};
+
+	static MemoryTracker* getActive() { return active; }
+
+	void setPolicy(const CapacityPolicy& newPolicy);
+	CapacityPolicy getPolicy() const;
+
+	// Called by the runner before scheduling each frame.
+	void beginFrame() { frameCount += 1; }
+	int64_t getFrameCount() const { return frameCount; }
+
+	void onAllocated(MemLoc location, std::size_t bytes);
+	void onReleased(MemLoc location, std::size_t bytes);
+	Stats getStats(MemLoc location) const;
+
+private:
+	mutable std::mutex mutex;  // Arrays are resized by threads of all branches
+	CapacityPolicy policy;
+	std::map<MemLoc, Stats> stats;
+	std::atomic<int64_t> frameCount {0};
+
+	static thread_local MemoryTracker* active;
+};
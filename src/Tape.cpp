@@ -66,25 +66,51 @@ TapePlay::TapePlay(const char* path)
 	tapeFunctions = {
 		{ "rgl_get_version_info", std::bind(&TapePlay::tape_get_version_info, this, _1) },
 		{ "rgl_configure_logging", std::bind(&TapePlay::tape_configure_logging, this, _1) },
+		{ "rgl_configure_memory_pool", std::bind(&TapePlay::tape_configure_memory_pool, this, _1) },
+		{ "rgl_configure_memory_mode", std::bind(&TapePlay::tape_configure_memory_mode, this, _1) },
+		{ "rgl_get_memory_pool_stats", std::bind(&TapePlay::tape_get_memory_pool_stats, this, _1) },
 		{ "rgl_cleanup", std::bind(&TapePlay::tape_cleanup, this, _1) },
 		{ "rgl_mesh_create", std::bind(&TapePlay::tape_mesh_create, this, _1) },
 		{ "rgl_mesh_destroy", std::bind(&TapePlay::tape_mesh_destroy, this, _1) },
 		{ "rgl_mesh_update_vertices", std::bind(&TapePlay::tape_mesh_update_vertices, this, _1) },
+		{ "rgl_configure_mesh_deduplication", std::bind(&TapePlay::tape_configure_mesh_deduplication, this, _1) },
 		{ "rgl_entity_create", std::bind(&TapePlay::tape_entity_create, this, _1) },
 		{ "rgl_entity_destroy", std::bind(&TapePlay::tape_entity_destroy, this, _1) },
 		{ "rgl_entity_set_pose", std::bind(&TapePlay::tape_entity_set_pose, this, _1) },
+		{ "rgl_entity_set_pose_motion", std::bind(&TapePlay::tape_entity_set_pose_motion, this, _1) },
+		{ "rgl_scene_prepare", std::bind(&TapePlay::tape_scene_prepare, this, _1) },
+		{ "rgl_scene_configure_compaction", std::bind(&TapePlay::tape_scene_configure_compaction, this, _1) },
+		{ "rgl_scene_get_compaction_stats", std::bind(&TapePlay::tape_scene_get_compaction_stats, this, _1) },
 		{ "rgl_graph_run", std::bind(&TapePlay::tape_graph_run, this, _1) },
+		{ "rgl_graph_wait", std::bind(&TapePlay::tape_graph_wait, this, _1) },
+		{ "rgl_graph_is_done", std::bind(&TapePlay::tape_graph_is_done, this, _1) },
+		{ "rgl_graph_configure_capture", std::bind(&TapePlay::tape_graph_configure_capture, this, _1) },
+		{ "rgl_graph_configure_pipeline", std::bind(&TapePlay::tape_graph_configure_pipeline, this, _1) },
+		{ "rgl_graph_get_frame_id", std::bind(&TapePlay::tape_graph_get_frame_id, this, _1) },
+		{ "rgl_graph_configure_profiling", std::bind(&TapePlay::tape_graph_configure_profiling, this, _1) },
+		{ "rgl_graph_get_profile", std::bind(&TapePlay::tape_graph_get_profile, this, _1) },
+		{ "rgl_graph_write_profile_trace", std::bind(&TapePlay::tape_graph_write_profile_trace, this, _1) },
+		{ "rgl_graph_configure_memory", std::bind(&TapePlay::tape_graph_configure_memory, this, _1) },
+		{ "rgl_graph_get_memory_stats", std::bind(&TapePlay::tape_graph_get_memory_stats, this, _1) },
 		{ "rgl_graph_destroy", std::bind(&TapePlay::tape_graph_destroy, this, _1) },
 		{ "rgl_graph_get_result_size", std::bind(&TapePlay::tape_graph_get_result_size, this, _1) },
 		{ "rgl_graph_get_result_data", std::bind(&TapePlay::tape_graph_get_result_data, this, _1) },
+		{ "rgl_graph_get_frame_result_size", std::bind(&TapePlay::tape_graph_get_frame_result_size, this, _1) },
+		{ "rgl_graph_get_frame_result_data", std::bind(&TapePlay::tape_graph_get_frame_result_data, this, _1) },
+		{ "rgl_graph_bind_result_buffer", std::bind(&TapePlay::tape_graph_bind_result_buffer, this, _1) },
+		{ "rgl_graph_wait_result_buffer", std::bind(&TapePlay::tape_graph_wait_result_buffer, this, _1) },
+		{ "rgl_graph_get_result_buffer_event", std::bind(&TapePlay::tape_graph_get_result_buffer_event, this, _1) },
 		{ "rgl_graph_node_set_active", std::bind(&TapePlay::tape_graph_node_set_active, this, _1) },
 		{ "rgl_graph_node_add_child", std::bind(&TapePlay::tape_graph_node_add_child, this, _1) },
 		{ "rgl_graph_node_remove_child", std::bind(&TapePlay::tape_graph_node_remove_child, this, _1) },
 		{ "rgl_node_rays_from_mat3x4f", std::bind(&TapePlay::tape_node_rays_from_mat3x4f, this, _1) },
 		{ "rgl_node_rays_set_ring_ids", std::bind(&TapePlay::tape_node_rays_set_ring_ids, this, _1) },
+		{ "rgl_node_rays_set_time_offsets", std::bind(&TapePlay::tape_node_rays_set_time_offsets, this, _1) },
 		{ "rgl_node_rays_transform", std::bind(&TapePlay::tape_node_rays_transform, this, _1) },
 		{ "rgl_node_points_transform", std::bind(&TapePlay::tape_node_points_transform, this, _1) },
 		{ "rgl_node_raytrace", std::bind(&TapePlay::tape_node_raytrace, this, _1) },
+		{ "rgl_node_raytrace_set_backend", std::bind(&TapePlay::tape_node_raytrace_set_backend, this, _1) },
+		{ "rgl_node_raytrace_set_return_count", std::bind(&TapePlay::tape_node_raytrace_set_return_count, this, _1) },
 		{ "rgl_node_points_format", std::bind(&TapePlay::tape_node_points_format, this, _1) },
 		{ "rgl_node_points_yield", std::bind(&TapePlay::tape_node_points_yield, this, _1) },
 		{ "rgl_node_points_compact", std::bind(&TapePlay::tape_node_points_compact, this, _1) },
@@ -122,8 +122,14 @@ class TapeRecord
 	uintptr_t valueToYaml(void* value) { return (uintptr_t) value; }
 
 	int valueToYaml(int32_t* value) { return *value; }
+	int64_t valueToYaml(int64_t* value) { return *value; }
+	bool valueToYaml(bool* value) { return *value; }
 	int valueToYaml(rgl_field_t value) { return (int)value; }
 	int valueToYaml(rgl_log_level_t value) { return (int)value; }
+	int valueToYaml(rgl_raytrace_backend_t value) { return (int)value; }
+	int valueToYaml(rgl_memory_pool_t value) { return (int)value; }
+	int valueToYaml(rgl_memory_mode_t value) { return (int)value; }
+	int valueToYaml(rgl_result_buffer_t value) { return (int)value; }
 
 	size_t valueToYaml(const rgl_mat3x4f* value) { return writeToBin(value, 1); }
 
@@ -162,26 +168,52 @@ class TapePlay
 
 	void tape_get_version_info(const YAML::Node& yamlNode);
 	void tape_configure_logging(const YAML::Node& yamlNode);
+	void tape_configure_memory_pool(const YAML::Node& yamlNode);
+	void tape_configure_memory_mode(const YAML::Node& yamlNode);
+	void tape_get_memory_pool_stats(const YAML::Node& yamlNode);
 	void tape_cleanup(const YAML::Node& yamlNode);
 	void tape_mesh_create(const YAML::Node& yamlNode);
 	void tape_mesh_destroy(const YAML::Node& yamlNode);
 	void tape_mesh_update_vertices(const YAML::Node& yamlNode);
+	void tape_configure_mesh_deduplication(const YAML::Node& yamlNode);
 	void tape_entity_create(const YAML::Node& yamlNode);
 	void tape_entity_destroy(const YAML::Node& yamlNode);
 	void tape_entity_set_pose(const YAML::Node& yamlNode);
+	void tape_entity_set_pose_motion(const YAML::Node& yamlNode);
 	void tape_entity_set_laser_retro(const YAML::Node& yamlNode);
+	void tape_scene_prepare(const YAML::Node& yamlNode);
+	void tape_scene_configure_compaction(const YAML::Node& yamlNode);
+	void tape_scene_get_compaction_stats(const YAML::Node& yamlNode);
 	void tape_graph_run(const YAML::Node& yamlNode);
+	void tape_graph_wait(const YAML::Node& yamlNode);
+	void tape_graph_is_done(const YAML::Node& yamlNode);
+	void tape_graph_configure_capture(const YAML::Node& yamlNode);
+	void tape_graph_configure_pipeline(const YAML::Node& yamlNode);
+	void tape_graph_get_frame_id(const YAML::Node& yamlNode);
+	void tape_graph_configure_profiling(const YAML::Node& yamlNode);
+	void tape_graph_get_profile(const YAML::Node& yamlNode);
+	void tape_graph_write_profile_trace(const YAML::Node& yamlNode);
+	void tape_graph_configure_memory(const YAML::Node& yamlNode);
+	void tape_graph_get_memory_stats(const YAML::Node& yamlNode);
 	void tape_graph_destroy(const YAML::Node& yamlNode);
 	void tape_graph_get_result_size(const YAML::Node& yamlNode);
 	void tape_graph_get_result_data(const YAML::Node& yamlNode);
+	void tape_graph_get_frame_result_size(const YAML::Node& yamlNode);
+	void tape_graph_get_frame_result_data(const YAML::Node& yamlNode);
+	void tape_graph_bind_result_buffer(const YAML::Node& yamlNode);
+	void tape_graph_wait_result_buffer(const YAML::Node& yamlNode);
+	void tape_graph_get_result_buffer_event(const YAML::Node& yamlNode);
 	void tape_graph_node_set_active(const YAML::Node& yamlNode);
 	void tape_graph_node_add_child(const YAML::Node& yamlNode);
 	void tape_graph_node_remove_child(const YAML::Node& yamlNode);
 	void tape_node_rays_from_mat3x4f(const YAML::Node& yamlNode);
 	void tape_node_rays_set_ring_ids(const YAML::Node& yamlNode);
+	void tape_node_rays_set_time_offsets(const YAML::Node& yamlNode);
 	void tape_node_rays_transform(const YAML::Node& yamlNode);
 	void tape_node_points_transform(const YAML::Node& yamlNode);
 	void tape_node_raytrace(const YAML::Node& yamlNode);
+	void tape_node_raytrace_set_backend(const YAML::Node& yamlNode);
+	void tape_node_raytrace_set_return_count(const YAML::Node& yamlNode);
 	void tape_node_points_format(const YAML::Node& yamlNode);
 	void tape_node_points_yield(const YAML::Node& yamlNode);
 	void tape_node_points_compact(const YAML::Node& yamlNode);
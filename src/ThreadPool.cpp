@@ -0,0 +1,68 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+
+ThreadPool& ThreadPool::instance()
+{
+	static ThreadPool pool {std::max(2U, std::thread::hardware_concurrency())};
+	return pool;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock {mutex};
+		quit = true;
+	}
+	taskAvailable.notify_all();
+	for (auto&& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard lock {mutex};
+		tasks.push_back(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+	std::unique_lock lock {mutex};
+	while (true) {
+		taskAvailable.wait(lock, [this]() { return quit || !tasks.empty(); });
+		if (tasks.empty()) {
+			return;  // Quitting once all tasks are done
+		}
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
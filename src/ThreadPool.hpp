@@ -0,0 +1,49 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of host threads executing enqueued tasks in FIFO order.
+ * Used to execute host-bound parts of graphs (e.g. PCL processing) concurrently to each other.
+ */
+struct ThreadPool
+{
+	static ThreadPool& instance();
+
+	explicit ThreadPool(std::size_t threadCount);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void enqueue(std::function<void()> task);
+
+private:
+	void workerLoop();
+
+private:
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::deque<std::function<void()>> tasks;
+	bool quit {false};
+	std::vector<std::thread> workers;
+};
@@ -12,35 +12,64 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+
 #include <VArray.hpp>
 
+#include <cmath>
+
 #include <RGLFields.hpp>
 
-VArray::VArray(const std::type_info &type, std::size_t sizeOfType, std::size_t initialSize)
+VArray::VArray(const std::type_info &type, std::size_t sizeOfType, std::size_t initialSize, DeviceAllocator::Ptr allocator)
 : typeInfo(type)
 , sizeOfType(sizeOfType)
+, allocator(std::move(allocator))
+, unified(this->allocator->isUnified())
 {
 	instance[MemLoc::Host] = {0};
-	instance[MemLoc::Device] = {0};
+	instance[MemLoc::Device] = {.isValid = true};
 	currentLocation = MemLoc::Device;
 	this->resize(initialSize);
 }
 
 const void* VArray::getReadPtr(MemLoc location) const
 {
-	// TODO(prybicki): optimize: do not move if not changed
-	if (currentLocation != location) {
-		// TODO(prybicki): Refactor it to avoid this hack:
-		const_cast<VArray*>(this)->migrateToLocation(location);
+	std::lock_guard lock {mutex};
+	// TODO(prybicki): Refactor it to avoid this hack:
+	bool copied = const_cast<VArray*>(this)->syncLocation(location, nullptr);
+	if (copied || location == MemLoc::Host) {
+		waitForPendingWork();  // Users of the pointer are not ordered after the copy
 	}
-	return current().data;
+	return at(location).data;
 }
 
 void* VArray::getWritePtr(MemLoc location)
 {
-	return const_cast<void*>(getReadPtr(location));
+	std::lock_guard lock {mutex};
+	bool copied = syncLocation(location, nullptr);
+	markWritten(location);
+	if (copied || location == MemLoc::Host) {
+		waitForPendingWork();  // Users of the pointer are not ordered after the copy
+	}
+	return current().data;
+}
+
+const void* VArray::getReadPtr(MemLoc location, cudaStream_t stream) const
+{
+	std::lock_guard lock {mutex};
+	const_cast<VArray*>(this)->syncLocation(location, stream);
+	waitInStream(stream);
+	return at(location).data;
 }
 
+void* VArray::getWritePtr(MemLoc location, cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	syncLocation(location, stream);
+	markWritten(location);
+	waitInStream(stream);
+	markPendingWork(stream);
+	return current().data;
+}
 
 VArray::Ptr VArray::create(rgl_field_t type, std::size_t initialSize)
 {
@@ -49,86 +78,253 @@ VArray::Ptr VArray::create(rgl_field_t type, std::size_t initialSize)
 
 void VArray::setData(const void *src, std::size_t elements)
 {
-	resize(elements, false, false);
-	CHECK_CUDA(cudaMemcpy(current().data, src, sizeOfType * elements, cudaMemcpyDefault));
+	std::lock_guard lock {mutex};
+	copyLocked(src, elements, nullptr);
+	waitForPendingWork();  // Source may be released by the caller
+}
+
+void VArray::copyAsync(const void* src, std::size_t elements, cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	copyLocked(src, elements, stream);
+}
+
+void VArray::copyLocked(const void* src, std::size_t elements, cudaStream_t stream)
+{
+	resizeLocked(elements, stream, false, false);
+	if (elements > 0) {
+		waitInStream(stream);
+		allocator->copyAsync(current().data, src, sizeOfType * elements, stream);
+		markPendingWork(stream);
+	}
 }
 
 void VArray::resize(std::size_t newCount, bool zeroInit, bool preserveData)
 {
-	reserve(newCount, preserveData);
+	std::lock_guard lock {mutex};
+	resizeLocked(newCount, nullptr, zeroInit, preserveData);
+	completeLegacyStreamWork();
+}
+
+void VArray::resizeAsync(std::size_t newCount, cudaStream_t stream, bool zeroInit, bool preserveData)
+{
+	std::lock_guard lock {mutex};
+	resizeLocked(newCount, stream, zeroInit, preserveData);
+}
+
+void VArray::resizeLocked(std::size_t newCount, cudaStream_t stream, bool zeroInit, bool preserveData)
+{
+	attachToActiveTracker();
+	if (newCount != current().elemCount) {
+		markWritten(currentLocation);
+	}
+	reserveLocked(newCount, stream, preserveData);
 	if (zeroInit && current().elemCount < newCount) {
 		char* start = (char*) current().data + sizeOfType * current().elemCount;
 		std::size_t bytesToClear = sizeOfType * (newCount - current().elemCount);
-		CHECK_CUDA(cudaMemset(start, 0, bytesToClear));
+		waitInStream(stream);
+		allocator->memsetAsync(start, 0, bytesToClear, stream);
+		markPendingWork(stream);
 	}
 	current().elemCount = newCount;
+	shrinkIfIdle(stream);
 }
 
 void VArray::reserve(std::size_t newCapacity, bool preserveData)
+{
+	std::lock_guard lock {mutex};
+	reserveLocked(newCapacity, nullptr, preserveData);
+	completeLegacyStreamWork();
+}
+
+void VArray::reserveAsync(std::size_t newCapacity, cudaStream_t stream, bool preserveData)
+{
+	std::lock_guard lock {mutex};
+	reserveLocked(newCapacity, stream, preserveData);
+}
+
+void VArray::reserveLocked(std::size_t newCapacity, cudaStream_t stream, bool preserveData)
 {
 	if (!preserveData) {
 		current().elemCount = 0;
+		markWritten(currentLocation);
 	}
 
 	if(current().elemCapacity >= newCapacity) {
 		return;
 	}
 
-	void* newMem = memAlloc(newCapacity * sizeOfType);
+	// Counts creeping up frame by frame do not reallocate each time
+	auto grownCapacity = static_cast<std::size_t>(std::ceil(current().elemCapacity * getCapacityPolicy().growthFactor));
+	reallocateLocked(currentLocation, std::max(newCapacity, grownCapacity), stream, preserveData);
+}
+
+void VArray::reallocateLocked(MemLoc location, std::size_t newCapacity, cudaStream_t stream, bool preserveData)
+{
+	Instance& target = instance.at(location);
+	void* newMem = newCapacity > 0 ? allocator->allocate(newCapacity * sizeOfType, location) : nullptr;
+
+	if (target.data != nullptr) {
+		// Released memory may still be used by pending work, which has to precede the stream
+		waitInStream(stream);
+		if (preserveData && target.elemCount > 0) {
+			allocator->copyAsync(newMem, target.data, sizeOfType * target.elemCount, stream);
+			markPendingWork(stream);
+		}
+		allocator->deallocate(target.data, location, stream);
+	}
+
+	if (tracker != nullptr) {
+		tracker->onReleased(location, target.elemCapacity * sizeOfType);
+		tracker->onAllocated(location, newCapacity * sizeOfType);
+	}
+	target.data = newMem;
+	target.elemCapacity = newCapacity;
+}
 
-	if (preserveData && current().data != nullptr) {
-		CHECK_CUDA(cudaMemcpy(newMem, current().data, sizeOfType * current().elemCount, cudaMemcpyDefault));
+void VArray::attachToActiveTracker()
+{
+	MemoryTracker* active = MemoryTracker::getActive();
+	if (active == nullptr || active == tracker.get()) {
+		return;
+	}
+	for (auto&& [location, state] : instance) {
+		if (tracker != nullptr) {
+			tracker->onReleased(location, state.elemCapacity * sizeOfType);
+		}
+		active->onAllocated(location, state.elemCapacity * sizeOfType);
 	}
+	tracker = active->shared_from_this();
+	windowStartFrame = tracker->getFrameCount();
+	windowPeakCount = current().elemCount;
+}
 
-	if (current().data != nullptr) {
-		memFree(current().data);
+void VArray::shrinkIfIdle(cudaStream_t stream)
+{
+	windowPeakCount = std::max(windowPeakCount, current().elemCount);
+	MemoryTracker::CapacityPolicy policy = getCapacityPolicy();
+	if (tracker == nullptr || policy.shrinkAfterFrames <= 0) {
+		return;
+	}
+	int64_t frame = tracker->getFrameCount();
+	if (frame - windowStartFrame < policy.shrinkAfterFrames) {
+		return;
 	}
+	// Headroom that growth would give to the high-water mark is retained, so that shrinking does not cause regrowth
+	auto retainedCapacity = static_cast<int64_t>(std::ceil(windowPeakCount * policy.growthFactor));
+	if (retainedCapacity < current().elemCapacity) {
+		reallocateLocked(currentLocation, retainedCapacity, stream, true);
+	}
+	windowStartFrame = frame;
+	windowPeakCount = current().elemCount;
+}
+
+MemoryTracker::CapacityPolicy VArray::getCapacityPolicy() const
+{
+	return tracker != nullptr ? tracker->getPolicy() : MemoryTracker::CapacityPolicy {};
+}
 
-	current().data = newMem;
-	current().elemCapacity = newCapacity;
+void VArray::migrateAsync(MemLoc location, cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	syncLocation(location, stream);
+	if (!unified) {
+		currentLocation = location;  // The other copy stays valid until the next modification
+	}
 }
 
 VArray::~VArray()
 {
 	for (auto&& [location, state] : instance) {
 		if (state.data != nullptr) {
-			memFree(state.data, {location});
-			state = {0};
+			allocator->deallocate(state.data, location, hasPendingWork ? lastStream : nullptr);
+		}
+		if (tracker != nullptr) {
+			tracker->onReleased(location, state.elemCapacity * sizeOfType);
 		}
+		state = {0};
+	}
+	if (lastStreamEvent != nullptr) {
+		allocator->destroyEvent(lastStreamEvent);
+	}
+}
+
+bool VArray::syncLocation(MemLoc location, cudaStream_t stream)
+{
+	if (unified) {
+		prefetchLocked(location, stream);
+		return false;
+	}
+	Instance& target = instance.at(location);
+	if (target.isValid) {
+		return false;
+	}
+	// Copy in the current location is always valid
+	const Instance& source = current();
+	if (target.elemCapacity < source.elemCount) {
+		reallocateLocked(location, source.elemCount, stream, false);
+	}
+	if (source.elemCount > 0) {
+		waitInStream(stream);
+		allocator->copyAsync(target.data, source.data, sizeOfType * source.elemCount, stream);
+		markPendingWork(stream);
+	}
+	target.elemCount = source.elemCount;
+	target.isValid = true;
+	return true;
+}
+
+void VArray::prefetchLocked(MemLoc location, cudaStream_t stream)
+{
+	if (prefetchedLocation == location || current().elemCount == 0) {
+		return;
 	}
+	waitInStream(stream);
+	allocator->prefetchAsync(current().data, sizeOfType * current().elemCount, location, stream);
+	markPendingWork(stream);
+	prefetchedLocation = location;
 }
 
-void* VArray::memAlloc(std::size_t bytes, std::optional<MemLoc> locationHint) const
+void VArray::markWritten(MemLoc location)
 {
-	MemLoc location = locationHint.has_value() ? locationHint.value() : currentLocation;
-	void* ptr = nullptr;
-	if (location == MemLoc::Host) {
-		CHECK_CUDA(cudaMallocHost(&ptr, bytes));
+	if (unified) {
+		return;
+	}
+	currentLocation = location;
+	for (auto&& [otherLocation, other] : instance) {
+		other.isValid = otherLocation == location;
 	}
-	if (location == MemLoc::Device) {
-		CHECK_CUDA(cudaMalloc(&ptr, bytes));
+}
+
+void VArray::waitInStream(cudaStream_t stream) const
+{
+	if (hasPendingWork && lastStream != stream) {
+		allocator->streamWaitEvent(stream, recordLastStreamEvent());
 	}
-	return ptr;
 }
 
-void VArray::memFree(void* ptr, std::optional<MemLoc> locationHint) const
+void VArray::completeLegacyStreamWork() const
 {
-	MemLoc location = locationHint.has_value() ? locationHint.value() : currentLocation;
-	if (location == MemLoc::Host) {
-		CHECK_CUDA(cudaFreeHost(ptr));
+	// Nothing is left pending in the legacy stream, which would have to be waited for e.g. by streams being captured
+	if (lastStream == nullptr) {
+		waitForPendingWork();
 	}
-	if (location == MemLoc::Device) {
-		CHECK_CUDA(cudaFree(ptr));
+}
+
+void VArray::waitForPendingWork() const
+{
+	if (hasPendingWork) {
+		allocator->synchronizeEvent(recordLastStreamEvent());
+		hasPendingWork = false;
 	}
 }
 
-void VArray::migrateToLocation(MemLoc newLoc)
+cudaEvent_t VArray::recordLastStreamEvent() const
 {
-	if (currentLocation == newLoc) {
-		return;
+	if (lastStreamEvent == nullptr) {
+		lastStreamEvent = allocator->createEvent();
 	}
-	void* srcData = current().data;
-	size_t elemCount = current().elemCount;
-	currentLocation = newLoc;
-	setData(srcData, elemCount);
+	// Recorded when needed, since tracked work may be enqueued after handing out a pointer
+	allocator->recordEvent(lastStreamEvent, lastStream);
+	return lastStreamEvent;
 }
@@ -16,11 +16,14 @@
 
 #include <typeindex>
 #include <map>
+#include <mutex>
 
 #include <cuda_runtime.h>
 #include <macros/cuda.hpp>
 
 #include <Logger.hpp>
+#include <DeviceAllocator.hpp>
+#include <MemoryTracker.hpp>
 #include <rgl/api/core.h>
 #include <math/Vector.hpp>
 #include <typingUtils.hpp>
@@ -28,14 +31,25 @@
 template<typename T>
 struct VArrayProxy;
 
-enum struct MemLoc
-{
-	Host,
-	Device
-};
-
 /**
  * Dynamically typed, virtual (accessible from GPU & CPU) array.
+ *
+ * Array keeps a copy of its data in each location where it was accessed, and tracks which copies are up to date.
+ * Reading in a location copies the data there only if that copy is stale. Modifications (including handing out
+ * a write pointer) are made in the location of the last write, and invalidate the copy in the other location.
+ * If the allocator provides unified memory (see MemoryMode), both locations share a single allocation;
+ * accessing a location only hints the allocator to prefetch the data there.
+ *
+ * Array remembers the stream of the last work it enqueued or handed out a write pointer for (see stream-ordered methods).
+ * Work on the array requested in another stream waits for it with an event, without blocking the host.
+ * Readers are not tracked, i.e. writes in another stream are not ordered after preceding reads.
+ * Methods without a stream complete their work in the legacy default stream before returning;
+ * getters of host pointers also wait for pending work. Device pointers obtained without a stream are not tracked.
+ * Streams of tracked work must outlive the array; graph runners never destroy their streams for that reason.
+ *
+ * Capacity grows geometrically and is shrunk to the high-water mark of recent frames once it exceeds it,
+ * according to the policy of the MemoryTracker which the array is attributed to (see MemoryTracker).
+ * Arrays resized outside of graphs only grow.
  */
 struct VArray : std::enable_shared_from_this<VArray>
 {
@@ -48,14 +62,15 @@ struct VArray : std::enable_shared_from_this<VArray>
 		void* data = nullptr;
 		int64_t elemCount = 0;
 		int64_t elemCapacity = 0;
+		bool isValid = false;  // Holds the current data; always true for the current location
 	};
 
 	// Static construction
 	static VArray::Ptr create(rgl_field_t type, std::size_t initialSize=0);
 
 	template<typename T>
-	static VArray::Ptr create(std::size_t initialSize=0)
-	{ return VArray::Ptr(new VArray(typeid(T), sizeof(T), initialSize)); }
+	static VArray::Ptr create(std::size_t initialSize=0, DeviceAllocator::Ptr allocator=DeviceAllocator::getDefault())
+	{ return VArray::Ptr(new VArray(typeid(T), sizeof(T), initialSize, std::move(allocator))); }
 
 
 	// Typed proxy construction
@@ -74,12 +89,21 @@ struct VArray : std::enable_shared_from_this<VArray>
 	{ return VArrayProxy<T>::create(shared_from_this()); }
 
 
-	// Methods
+	// Methods ordered in the legacy default stream
 	void* getWritePtr(MemLoc location);
 	const void* getReadPtr(MemLoc location) const;
 	void setData(const void* src, std::size_t elements);
 	void resize(std::size_t newCount, bool zeroInit=true, bool preserveData=true);
 	void reserve(std::size_t newCapacity, bool preserveData=true);
+
+	// Stream-ordered methods; pointers and data are valid for work enqueued in the stream after the call.
+	// Source of the copy must stay valid until the stream executes it. Growing capacity may block (see DeviceAllocator).
+	void* getWritePtr(MemLoc location, cudaStream_t stream);
+	const void* getReadPtr(MemLoc location, cudaStream_t stream) const;
+	void copyAsync(const void* src, std::size_t elements, cudaStream_t stream);
+	void resizeAsync(std::size_t newCount, cudaStream_t stream, bool zeroInit=true, bool preserveData=true);
+	void reserveAsync(std::size_t newCapacity, cudaStream_t stream, bool preserveData=true);
+	void migrateAsync(MemLoc location, cudaStream_t stream);
 	std::size_t getElemSize() const { return sizeOfType; }
 	std::size_t getElemCount() const { return current().elemCount; }
 	std::size_t getElemCapacity() const { return current().elemCapacity; }
@@ -88,18 +112,48 @@ struct VArray : std::enable_shared_from_this<VArray>
 
 private:
 	Instance& current() const { return instance.at(currentLocation); }
-	void* memAlloc(std::size_t bytes, std::optional<MemLoc> locationHint= std::nullopt) const;
-	void memFree(void*, std::optional<MemLoc> locationHint= std::nullopt) const;
-	void migrateToLocation(MemLoc location);
+	Instance& at(MemLoc location) const { return unified ? current() : instance.at(location); }
+
+	// Callers hold the mutex
+	void copyLocked(const void* src, std::size_t elements, cudaStream_t stream);
+	void resizeLocked(std::size_t newCount, cudaStream_t stream, bool zeroInit, bool preserveData);
+	void reserveLocked(std::size_t newCapacity, cudaStream_t stream, bool preserveData);
+	void reallocateLocked(MemLoc location, std::size_t newCapacity, cudaStream_t stream, bool preserveData);
+	bool syncLocation(MemLoc location, cudaStream_t stream);  // Returns whether data had to be copied
+	void prefetchLocked(MemLoc location, cudaStream_t stream);
+	void markWritten(MemLoc location);
+	void attachToActiveTracker();
+	void shrinkIfIdle(cudaStream_t stream);
+	MemoryTracker::CapacityPolicy getCapacityPolicy() const;
+	void waitInStream(cudaStream_t stream) const;
+	void markPendingWork(cudaStream_t stream) const { hasPendingWork = true; lastStream = stream; }
+	void waitForPendingWork() const;
+	void completeLegacyStreamWork() const;
+	cudaEvent_t recordLastStreamEvent() const;
 
 private:
 	std::size_t sizeOfType;
 	std::reference_wrapper<const std::type_info> typeInfo;
+	DeviceAllocator::Ptr allocator;
+	bool unified;  // Only the instance in the current location is used, which never changes
 
 	mutable MemLoc currentLocation;
+	mutable MemLoc prefetchedLocation {MemLoc::Device};  // Of unified memory, where the last prefetch moved it
 	mutable std::map<MemLoc, Instance> instance;
+	mutable std::mutex mutex;  // Nodes of concurrent graph branches may read the same array
+
+	// Stream tracking; the event is created on first use and recorded only when another stream or the host needs to wait
+	mutable bool hasPendingWork {false};
+	mutable cudaStream_t lastStream {nullptr};
+	mutable cudaEvent_t lastStreamEvent {nullptr};
+
+	// Capacity policy; the window of frames is restarted after each shrink check
+	MemoryTracker::Ptr tracker;
+	int64_t windowStartFrame {0};
+	int64_t windowPeakCount {0};
 
-	VArray(const std::type_info& type, std::size_t sizeOfType, std::size_t initialSize);
+	VArray(const std::type_info& type, std::size_t sizeOfType, std::size_t initialSize,
+	       DeviceAllocator::Ptr allocator=DeviceAllocator::getDefault());
 
 	template<typename T>
 	friend struct VArrayTyped;
@@ -42,13 +42,19 @@ struct VArrayProxy
 	std::size_t getBytesInUse() const { return src->getElemCount() * sizeof(T); }
 	void resize(std::size_t newCount, bool zeroInit=true, bool preserveData=true) { src->resize(newCount, zeroInit, preserveData); }
 
+	// Stream-ordered variants, see VArray
+	void copyAsync(const T* srcRaw, std::size_t count, cudaStream_t stream) { src->copyAsync(srcRaw, count, stream); }
+	void resizeAsync(std::size_t newCount, cudaStream_t stream, bool zeroInit=true, bool preserveData=true) { src->resizeAsync(newCount, stream, zeroInit, preserveData); }
+	T* getWritePtr(MemLoc location, cudaStream_t stream) { return reinterpret_cast<T*>(src->getWritePtr(location, stream)); }
+	const T* getReadPtr(MemLoc location, cudaStream_t stream) const { return reinterpret_cast<const T*>(src->getReadPtr(location, stream)); }
+
 	T* getWritePtr(MemLoc location) { return reinterpret_cast<T*>(src->getWritePtr(location)); }
 	const T* getReadPtr(MemLoc location) const { return reinterpret_cast<const T*>(src->getReadPtr(location)); }
 	CUdeviceptr getCUdeviceptr() { return reinterpret_cast<CUdeviceptr>(src->getWritePtr(MemLoc::Device)); }
 
 	// TODO(prybicki): remove these in favor of ...(location)
 	T*          getHostPtr()           { return reinterpret_cast<T*>(src->getWritePtr(MemLoc::Host)); }
-	const T*    getHostPtr()     const { return reinterpret_cast<const T*>(src->getReadPtr(MemLoc::Device)); }
+	const T*    getHostPtr()     const { return reinterpret_cast<const T*>(src->getReadPtr(MemLoc::Host)); }
 	T*          getDevicePtr()         { return reinterpret_cast<T*>(src->getWritePtr(MemLoc::Device)); }
 	const T*    getDevicePtr()   const { return reinterpret_cast<const T*>(src->getReadPtr(MemLoc::Device)); }
 
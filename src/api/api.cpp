@@ -22,11 +22,14 @@
 #include <scene/Scene.hpp>
 #include <scene/Entity.hpp>
 #include <scene/Mesh.hpp>
+#include <scene/MeshRegistry.hpp>
 
 #include <graph/Nodes.hpp>
 #include <graph/graph.hpp>
+#include <gpu/RayReturns.hpp>
 
 #include <Tape.hpp>
+#include <CachingDeviceAllocator.hpp>
 #include <RGLExceptions.hpp>
 
 #include <repr.hpp>
@@ -155,8 +158,10 @@ void createOrUpdateNode(rgl_node_t* nodeRawPtr, Args&&... args)
 	}
 	else {
 		node = Node::validatePtr<NodeType>(*nodeRawPtr);
+		waitForGraph(node);
 	}
 	node->setParameters(args...);
+	node->invalidateExecutionPlan();
 	*nodeRawPtr = node.get();
 }
 
@@ -232,6 +237,92 @@ void TapePlay::tape_configure_logging(const YAML::Node& yamlNode)
 		yamlNode[2].as<bool>());
 }
 
+static MemLoc toMemLoc(rgl_memory_pool_t pool)
+{
+	return pool == RGL_MEMORY_POOL_HOST_PINNED ? MemLoc::Host : MemLoc::Device;
+}
+
+RGL_API rgl_status_t
+rgl_configure_memory_pool(rgl_memory_pool_t pool, int64_t cache_limit_bytes)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_configure_memory_pool(pool={}, cache_limit_bytes={})", static_cast<int>(pool), cache_limit_bytes);
+		CHECK_ARG(pool == RGL_MEMORY_POOL_DEVICE || pool == RGL_MEMORY_POOL_HOST_PINNED);
+		CHECK_ARG(cache_limit_bytes >= 0);
+		for (auto&& mode : {MemoryMode::Discrete, MemoryMode::Managed, MemoryMode::Mapped}) {
+			CachingDeviceAllocator::getInstance(mode)->setCacheLimit(toMemLoc(pool), cache_limit_bytes);
+		}
+	});
+	TAPE_HOOK(pool, cache_limit_bytes);
+	return status;
+}
+
+void TapePlay::tape_configure_memory_pool(const YAML::Node& yamlNode)
+{
+	rgl_configure_memory_pool(
+		(rgl_memory_pool_t) yamlNode[0].as<int>(),
+		yamlNode[1].as<int64_t>());
+}
+
+RGL_API rgl_status_t
+rgl_configure_memory_mode(rgl_memory_mode_t mode)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_configure_memory_mode(mode={})", static_cast<int>(mode));
+		CHECK_ARG(mode >= RGL_MEMORY_MODE_AUTO && mode <= RGL_MEMORY_MODE_MAPPED);
+		static const std::map<rgl_memory_mode_t, MemoryMode> modes = {
+			{RGL_MEMORY_MODE_DISCRETE, MemoryMode::Discrete},
+			{RGL_MEMORY_MODE_MANAGED, MemoryMode::Managed},
+			{RGL_MEMORY_MODE_MAPPED, MemoryMode::Mapped},
+		};
+		DeviceAllocator::setDefaultMode(modes.contains(mode) ? std::optional(modes.at(mode)) : std::nullopt);
+	});
+	TAPE_HOOK(mode);
+	return status;
+}
+
+void TapePlay::tape_configure_memory_mode(const YAML::Node& yamlNode)
+{
+	rgl_configure_memory_mode((rgl_memory_mode_t) yamlNode[0].as<int>());
+}
+
+RGL_API rgl_status_t
+rgl_get_memory_pool_stats(rgl_memory_pool_t pool, int64_t* out_used_bytes, int64_t* out_cached_bytes,
+                          int64_t* out_hit_count, int64_t* out_miss_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_get_memory_pool_stats(pool={}, out_used_bytes={}, out_cached_bytes={}, out_hit_count={}, out_miss_count={})",
+		            static_cast<int>(pool), (void*) out_used_bytes, (void*) out_cached_bytes, (void*) out_hit_count, (void*) out_miss_count);
+		CHECK_ARG(pool == RGL_MEMORY_POOL_DEVICE || pool == RGL_MEMORY_POOL_HOST_PINNED);
+		CHECK_ARG(out_used_bytes != nullptr);
+		CHECK_ARG(out_cached_bytes != nullptr);
+		CHECK_ARG(out_hit_count != nullptr);
+		CHECK_ARG(out_miss_count != nullptr);
+		CachingDeviceAllocator::Stats stats;
+		for (auto&& mode : {MemoryMode::Discrete, MemoryMode::Managed, MemoryMode::Mapped}) {
+			auto modeStats = CachingDeviceAllocator::getInstance(mode)->getStats(toMemLoc(pool));
+			stats.usedBytes += modeStats.usedBytes;
+			stats.cachedBytes += modeStats.cachedBytes;
+			stats.hitCount += modeStats.hitCount;
+			stats.missCount += modeStats.missCount;
+		}
+		*out_used_bytes = static_cast<int64_t>(stats.usedBytes);
+		*out_cached_bytes = static_cast<int64_t>(stats.cachedBytes);
+		*out_hit_count = static_cast<int64_t>(stats.hitCount);
+		*out_miss_count = static_cast<int64_t>(stats.missCount);
+	});
+	TAPE_HOOK(pool, out_used_bytes, out_cached_bytes, out_hit_count, out_miss_count);
+	return status;
+}
+
+void TapePlay::tape_get_memory_pool_stats(const YAML::Node& yamlNode)
+{
+	// Statistics depend on the allocation history of the replaying process, so they are not compared
+	int64_t out_used_bytes, out_cached_bytes, out_hit_count, out_miss_count;
+	rgl_get_memory_pool_stats((rgl_memory_pool_t) yamlNode[0].as<int>(),
+	                          &out_used_bytes, &out_cached_bytes, &out_hit_count, &out_miss_count);
+}
+
 RGL_API void
 rgl_get_last_error_string(const char** out_error_string)
 {
@@ -261,6 +352,7 @@ RGL_API rgl_status_t
 rgl_cleanup(void)
 {
 	auto status = rglSafeCall([&]() {
+		waitForAllGraphs();
 		CHECK_CUDA(cudaStreamSynchronize(nullptr));
 		Entity::instances.clear();
 		Mesh::instances.clear();
@@ -355,6 +447,53 @@ void TapePlay::tape_mesh_update_vertices(const YAML::Node& yamlNode)
 		yamlNode[2].as<int>());
 }
 
+RGL_API rgl_status_t
+rgl_mesh_update_vertices_many(const rgl_mesh_t* meshes, const rgl_vec3f* const* vertices, const int32_t* vertex_counts, int32_t mesh_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_mesh_update_vertices_many(meshes={}, vertices={}, vertex_counts={}, mesh_count={})",
+		            (void*) meshes, (void*) vertices, (void*) vertex_counts, mesh_count);
+		CHECK_ARG(meshes != nullptr);
+		CHECK_ARG(vertices != nullptr);
+		CHECK_ARG(vertex_counts != nullptr);
+		CHECK_ARG(mesh_count > 0);
+		std::vector<std::shared_ptr<Mesh>> meshesSafe;
+		for (int32_t i = 0; i < mesh_count; ++i) {
+			CHECK_ARG(meshes[i] != nullptr);
+			CHECK_ARG(vertices[i] != nullptr);
+			CHECK_ARG(vertex_counts[i] > 0);
+			meshesSafe.push_back(Mesh::validatePtr(meshes[i]));
+			CHECK_ARG(meshesSafe.back()->getGeometry()->getVertexCount() == vertex_counts[i]);
+		}
+		for (int32_t i = 0; i < mesh_count; ++i) {
+			meshesSafe[i]->updateVertices(reinterpret_cast<const Vec3f*>(vertices[i]), vertex_counts[i]);
+		}
+	});
+	// Recorded as separate updates, which is equivalent on playback
+	if (tapeRecord.has_value() && status == RGL_SUCCESS) {
+		for (int32_t i = 0; i < mesh_count; ++i) {
+			tapeRecord->recordApiCall("rgl_mesh_update_vertices", meshes[i], TAPE_ARRAY(vertices[i], vertex_counts[i]), vertex_counts[i]);
+		}
+	}
+	return status;
+}
+
+RGL_API rgl_status_t
+rgl_configure_mesh_deduplication(bool enabled)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_configure_mesh_deduplication(enabled={})", enabled);
+		MeshRegistry::instance().setEnabled(enabled);
+	});
+	TAPE_HOOK(enabled);
+	return status;
+}
+
+void TapePlay::tape_configure_mesh_deduplication(const YAML::Node& yamlNode)
+{
+	rgl_configure_mesh_deduplication(yamlNode[0].as<bool>());
+}
+
 RGL_API rgl_status_t
 rgl_entity_create(rgl_entity_t* out_entity, rgl_scene_t scene, rgl_mesh_t mesh)
 {
@@ -427,6 +566,34 @@ void TapePlay::tape_entity_set_pose(const YAML::Node& yamlNode)
 		reinterpret_cast<const rgl_mat3x4f*>(fileMmap + yamlNode[1].as<size_t>()));
 }
 
+RGL_API rgl_status_t
+rgl_entity_set_pose_motion(rgl_entity_t entity, const rgl_mat3x4f* begin_local_to_world_tf,
+                           const rgl_mat3x4f* end_local_to_world_tf, float time_begin, float time_end)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_entity_set_pose_motion(entity={}, begin_local_to_world_tf={}, end_local_to_world_tf={}, time_begin={}, time_end={})",
+		            (void*) entity, repr(begin_local_to_world_tf, 1), repr(end_local_to_world_tf, 1), time_begin, time_end);
+		CHECK_ARG(entity != nullptr);
+		CHECK_ARG(begin_local_to_world_tf != nullptr);
+		CHECK_ARG(end_local_to_world_tf != nullptr);
+		CHECK_ARG(time_begin < time_end);
+		auto beginTf = Mat3x4f::fromRaw(reinterpret_cast<const float*>(&begin_local_to_world_tf->value[0][0]));
+		auto endTf = Mat3x4f::fromRaw(reinterpret_cast<const float*>(&end_local_to_world_tf->value[0][0]));
+		Entity::validatePtr(entity)->setTransformMotion(beginTf, endTf, time_begin, time_end);
+	});
+	TAPE_HOOK(entity, begin_local_to_world_tf, end_local_to_world_tf, time_begin, time_end);
+	return status;
+}
+
+void TapePlay::tape_entity_set_pose_motion(const YAML::Node& yamlNode)
+{
+	rgl_entity_set_pose_motion(tapeEntities[yamlNode[0].as<size_t>()],
+		reinterpret_cast<const rgl_mat3x4f*>(fileMmap + yamlNode[1].as<size_t>()),
+		reinterpret_cast<const rgl_mat3x4f*>(fileMmap + yamlNode[2].as<size_t>()),
+		yamlNode[3].as<float>(),
+		yamlNode[4].as<float>());
+}
+
 RGL_API rgl_status_t
 rgl_entity_set_laser_retro(rgl_entity_t entity, float retro)
 {
@@ -445,6 +612,78 @@ void TapePlay::tape_entity_set_laser_retro(const YAML::Node& yamlNode)
 					  yamlNode[1].as<Field<LASER_RETRO_F32>::type>());
 }
 
+RGL_API rgl_status_t
+rgl_scene_prepare(rgl_scene_t scene)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_scene_prepare(scene={})", (void*) scene);
+		if (scene == nullptr) {
+			scene = Scene::defaultInstance().get();
+		}
+		Scene::validatePtr(scene)->prepare(nullptr);
+		CHECK_CUDA(cudaStreamSynchronize(nullptr));
+	});
+	TAPE_HOOK(scene);
+	return status;
+}
+
+void TapePlay::tape_scene_prepare(const YAML::Node& yamlNode)
+{
+	rgl_scene_prepare(nullptr);  // TODO(msz-rai) support multiple scenes
+}
+
+RGL_API rgl_status_t
+rgl_scene_configure_compaction(rgl_scene_t scene, int32_t stable_run_count, int64_t memory_budget)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_scene_configure_compaction(scene={}, stable_run_count={}, memory_budget={})",
+		            (void*) scene, stable_run_count, memory_budget);
+		CHECK_ARG(stable_run_count >= 0);
+		CHECK_ARG(memory_budget >= 0);
+		if (scene == nullptr) {
+			scene = Scene::defaultInstance().get();
+		}
+		Scene::validatePtr(scene)->setCompactionPolicy({
+			.stableFrameCount = static_cast<std::size_t>(stable_run_count),
+			.memoryBudget = static_cast<std::size_t>(memory_budget),
+		});
+	});
+	TAPE_HOOK(scene, stable_run_count, memory_budget);
+	return status;
+}
+
+void TapePlay::tape_scene_configure_compaction(const YAML::Node& yamlNode)
+{
+	rgl_scene_configure_compaction(nullptr,  // TODO(msz-rai) support multiple scenes
+		yamlNode[1].as<int32_t>(),
+		yamlNode[2].as<int64_t>());
+}
+
+RGL_API rgl_status_t
+rgl_scene_get_compaction_stats(rgl_scene_t scene, int64_t* out_compacted_count, int64_t* out_bytes_saved)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_scene_get_compaction_stats(scene={}, out_compacted_count={}, out_bytes_saved={})",
+		            (void*) scene, (void*) out_compacted_count, (void*) out_bytes_saved);
+		CHECK_ARG(out_compacted_count != nullptr);
+		CHECK_ARG(out_bytes_saved != nullptr);
+		if (scene == nullptr) {
+			scene = Scene::defaultInstance().get();
+		}
+		auto stats = Scene::validatePtr(scene)->getCompactionStats();
+		*out_compacted_count = static_cast<int64_t>(stats.compactedGASCount);
+		*out_bytes_saved = static_cast<int64_t>(stats.bytesSaved);
+	});
+	TAPE_HOOK(scene, out_compacted_count, out_bytes_saved);
+	return status;
+}
+
+void TapePlay::tape_scene_get_compaction_stats(const YAML::Node& yamlNode)
+{
+	int64_t out_compacted_count, out_bytes_saved;
+	rgl_scene_get_compaction_stats(nullptr, &out_compacted_count, &out_bytes_saved);
+}
+
 RGL_API rgl_status_t
 rgl_graph_run(rgl_node_t node)
 {
@@ -462,14 +701,232 @@ void TapePlay::tape_graph_run(const YAML::Node& yamlNode)
 	rgl_graph_run(tapeNodes[yamlNode[0].as<size_t>()]);
 }
 
+RGL_API rgl_status_t
+rgl_graph_wait(rgl_node_t node)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_wait(node={})", repr(node));
+		CHECK_ARG(node != nullptr);
+		waitForGraph(Node::validatePtr(node));
+	});
+	TAPE_HOOK(node);
+	return status;
+}
+
+void TapePlay::tape_graph_wait(const YAML::Node& yamlNode)
+{
+	rgl_graph_wait(tapeNodes[yamlNode[0].as<size_t>()]);
+}
+
+RGL_API rgl_status_t
+rgl_graph_is_done(rgl_node_t node, bool* out_done)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_is_done(node={}, out_done={})", repr(node), (void*) out_done);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(out_done != nullptr);
+		*out_done = isGraphDone(Node::validatePtr(node));
+	});
+	TAPE_HOOK(node, out_done);
+	return status;
+}
+
+void TapePlay::tape_graph_is_done(const YAML::Node& yamlNode)
+{
+	bool out_done;
+	rgl_graph_is_done(tapeNodes[yamlNode[0].as<size_t>()], &out_done);
+}
+
+RGL_API rgl_status_t
+rgl_graph_configure_capture(rgl_node_t node, bool enabled)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_configure_capture(node={}, enabled={})", repr(node), enabled);
+		CHECK_ARG(node != nullptr);
+		setGraphCaptureEnabled(Node::validatePtr(node), enabled);
+	});
+	TAPE_HOOK(node, enabled);
+	return status;
+}
+
+void TapePlay::tape_graph_configure_capture(const YAML::Node& yamlNode)
+{
+	rgl_graph_configure_capture(tapeNodes[yamlNode[0].as<size_t>()], yamlNode[1].as<bool>());
+}
+
+RGL_API rgl_status_t
+rgl_graph_configure_pipeline(rgl_node_t node, int32_t depth)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_configure_pipeline(node={}, depth={})", repr(node), depth);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(depth >= 1 && depth <= GraphRunner::MAX_PIPELINE_DEPTH);
+		setGraphPipelineDepth(Node::validatePtr(node), depth);
+	});
+	TAPE_HOOK(node, depth);
+	return status;
+}
+
+void TapePlay::tape_graph_configure_pipeline(const YAML::Node& yamlNode)
+{
+	rgl_graph_configure_pipeline(tapeNodes[yamlNode[0].as<size_t>()], yamlNode[1].as<int32_t>());
+}
+
+RGL_API rgl_status_t
+rgl_graph_get_frame_id(rgl_node_t node, int64_t* out_frame_id)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_frame_id(node={}, out_frame_id={})", repr(node), (void*) out_frame_id);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(out_frame_id != nullptr);
+		*out_frame_id = getGraphLastFrameId(Node::validatePtr(node));
+	});
+	TAPE_HOOK(node, out_frame_id);
+	return status;
+}
+
+void TapePlay::tape_graph_get_frame_id(const YAML::Node& yamlNode)
+{
+	int64_t out_frame_id;
+	rgl_graph_get_frame_id(tapeNodes[yamlNode[0].as<size_t>()], &out_frame_id);
+	if (out_frame_id != yamlNode[1].as<int64_t>()) RGL_WARN("tape_graph_get_frame_id: out_frame_id mismatch");
+}
+
+RGL_API rgl_status_t
+rgl_graph_configure_profiling(rgl_node_t node, bool enabled, int32_t window_size)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_configure_profiling(node={}, enabled={}, window_size={})", repr(node), enabled, window_size);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(window_size > 0);
+		setGraphProfilingEnabled(Node::validatePtr(node), enabled, window_size);
+	});
+	TAPE_HOOK(node, enabled, window_size);
+	return status;
+}
+
+void TapePlay::tape_graph_configure_profiling(const YAML::Node& yamlNode)
+{
+	rgl_graph_configure_profiling(tapeNodes[yamlNode[0].as<size_t>()], yamlNode[1].as<bool>(), yamlNode[2].as<int32_t>());
+}
+
+RGL_API rgl_status_t
+rgl_graph_get_profile(rgl_node_t node, rgl_node_profile_t* out_profiles, int32_t capacity, int32_t* out_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_profile(node={}, out_profiles={}, capacity={}, out_count={})", repr(node), (void*) out_profiles, capacity, (void*) out_count);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(capacity >= 0);
+		CHECK_ARG(out_profiles != nullptr || capacity == 0);
+		CHECK_ARG(out_count != nullptr);
+
+		auto profiles = getGraphProfile(Node::validatePtr(node));
+		for (int32_t i = 0; i < capacity && i < static_cast<int32_t>(profiles.size()); ++i) {
+			const GraphProfiler::Profile& profile = profiles[i];
+			out_profiles[i] = {
+				.node = const_cast<Node*>(profile.node),
+				.phase = profile.phase,
+				.sample_count = static_cast<int32_t>(profile.host.sampleCount),
+				.host_min_ms = static_cast<float>(profile.host.minMs),
+				.host_avg_ms = static_cast<float>(profile.host.avgMs),
+				.host_p99_ms = static_cast<float>(profile.host.p99Ms),
+				.gpu_min_ms = static_cast<float>(profile.gpu.minMs),
+				.gpu_avg_ms = static_cast<float>(profile.gpu.avgMs),
+				.gpu_p99_ms = static_cast<float>(profile.gpu.p99Ms),
+			};
+		}
+		*out_count = static_cast<int32_t>(profiles.size());
+	});
+	TAPE_HOOK(node, (void*) out_profiles, capacity, out_count);
+	return status;
+}
+
+void TapePlay::tape_graph_get_profile(const YAML::Node& yamlNode)
+{
+	// Timings are not reproducible, only the call is replayed
+	int32_t out_count;
+	rgl_graph_get_profile(tapeNodes[yamlNode[0].as<size_t>()], nullptr, 0, &out_count);
+}
+
+RGL_API rgl_status_t
+rgl_graph_write_profile_trace(rgl_node_t node, const char* file_path)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_write_profile_trace(node={}, file_path={})", repr(node), file_path);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(file_path != nullptr);
+		CHECK_ARG(file_path[0] != '\0');
+		writeGraphProfileTrace(Node::validatePtr(node), file_path);
+	});
+	TAPE_HOOK(node, file_path);
+	return status;
+}
+
+void TapePlay::tape_graph_write_profile_trace(const YAML::Node& yamlNode)
+{
+	rgl_graph_write_profile_trace(tapeNodes[yamlNode[0].as<size_t>()], yamlNode[1].as<std::string>().c_str());
+}
+
+RGL_API rgl_status_t
+rgl_graph_configure_memory(rgl_node_t node, float growth_factor, int32_t shrink_after_frames)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_configure_memory(node={}, growth_factor={}, shrink_after_frames={})", repr(node), growth_factor, shrink_after_frames);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(growth_factor >= 1.0f);
+		CHECK_ARG(shrink_after_frames >= 0);
+		setGraphCapacityPolicy(Node::validatePtr(node), {.growthFactor = growth_factor, .shrinkAfterFrames = shrink_after_frames});
+	});
+	TAPE_HOOK(node, growth_factor, shrink_after_frames);
+	return status;
+}
+
+void TapePlay::tape_graph_configure_memory(const YAML::Node& yamlNode)
+{
+	rgl_graph_configure_memory(tapeNodes[yamlNode[0].as<size_t>()], yamlNode[1].as<float>(), yamlNode[2].as<int32_t>());
+}
+
+RGL_API rgl_status_t
+rgl_graph_get_memory_stats(rgl_node_t node, int64_t* out_device_bytes, int64_t* out_device_high_water_bytes,
+                           int64_t* out_host_bytes, int64_t* out_host_high_water_bytes)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_memory_stats(node={}, out_device_bytes={}, out_device_high_water_bytes={}, out_host_bytes={}, out_host_high_water_bytes={})",
+		            repr(node), (void*) out_device_bytes, (void*) out_device_high_water_bytes, (void*) out_host_bytes, (void*) out_host_high_water_bytes);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(out_device_bytes != nullptr);
+		CHECK_ARG(out_device_high_water_bytes != nullptr);
+		CHECK_ARG(out_host_bytes != nullptr);
+		CHECK_ARG(out_host_high_water_bytes != nullptr);
+		auto nodeSafe = Node::validatePtr(node);
+		auto deviceStats = getGraphMemoryStats(nodeSafe, MemLoc::Device);
+		auto hostStats = getGraphMemoryStats(nodeSafe, MemLoc::Host);
+		*out_device_bytes = static_cast<int64_t>(deviceStats.currentBytes);
+		*out_device_high_water_bytes = static_cast<int64_t>(deviceStats.highWaterBytes);
+		*out_host_bytes = static_cast<int64_t>(hostStats.currentBytes);
+		*out_host_high_water_bytes = static_cast<int64_t>(hostStats.highWaterBytes);
+	});
+	TAPE_HOOK(node, out_device_bytes, out_device_high_water_bytes, out_host_bytes, out_host_high_water_bytes);
+	return status;
+}
+
+void TapePlay::tape_graph_get_memory_stats(const YAML::Node& yamlNode)
+{
+	// Statistics depend on the allocation history of the replaying process, so they are not compared
+	int64_t out_device_bytes, out_device_high_water_bytes, out_host_bytes, out_host_high_water_bytes;
+	rgl_graph_get_memory_stats(tapeNodes[yamlNode[0].as<size_t>()], &out_device_bytes, &out_device_high_water_bytes,
+	                           &out_host_bytes, &out_host_high_water_bytes);
+}
+
 RGL_API rgl_status_t
 rgl_graph_destroy(rgl_node_t node)
 {
 	auto status = rglSafeCall([&]() {
 		RGL_API_LOG("rgl_graph_destroy(node={})", repr(node));
 		CHECK_ARG(node != nullptr);
-		CHECK_CUDA(cudaStreamSynchronize(nullptr));
-		destroyGraph(Node::validatePtr(node));
+		auto nodeSafe = Node::validatePtr(node);
+		waitForGraph(nodeSafe);
+		destroyGraph(nodeSafe);
 	});
 	TAPE_HOOK(node);
 	return status;
@@ -507,6 +964,7 @@ rgl_graph_get_result_size(rgl_node_t node, rgl_field_t field, int32_t* out_count
 		RGL_API_LOG("rgl_graph_get_result_size(node={}, field={}, out_count={}, out_size_of={})", repr(node), field, (void*)out_count, (void*)out_size_of);
 		CHECK_ARG(node != nullptr);
 
+		waitForGraph(Node::validatePtr(node));
 		auto pointCloudNode = Node::validatePtr<IPointsNode>(node);
 		int32_t elemCount = (int32_t)pointCloudNode->getPointCount();
 		int32_t elemSize = (int32_t)pointCloudNode->getFieldPointSize(field);
@@ -538,11 +996,14 @@ rgl_graph_get_result_data(rgl_node_t node, rgl_field_t field, void* data)
 		CHECK_ARG(node != nullptr);
 		CHECK_ARG(data != nullptr);
 
+		waitForGraph(Node::validatePtr(node));
 		auto pointCloudNode = Node::validatePtr<IPointsNode>(node);
 		VArray::ConstPtr output = pointCloudNode->getFieldData(field, nullptr);
+		// Arrays recorded into a CUDA graph may hold more elements than valid points (see CompactPointsNode::getOutputCount)
+		std::size_t byteCount = pointCloudNode->getPointCount() * pointCloudNode->getFieldPointSize(field);
 
 		// TODO: cudaMemcpyAsync + explicit sync can be used here (better behavior for multiple graphs)
-		CHECK_CUDA(cudaMemcpy(data, output->getReadPtr(MemLoc::Device), output->getElemCount() * output->getElemSize(), cudaMemcpyDefault));
+		CHECK_CUDA(cudaMemcpy(data, output->getReadPtr(MemLoc::Device), byteCount, cudaMemcpyDefault));
 	});
 	TAPE_HOOK(node, field, data);
 	return status;
@@ -559,6 +1020,118 @@ void TapePlay::tape_graph_get_result_data(const YAML::Node& yamlNode)
 	rgl_graph_get_result_data(node, field, tmpVec.data());
 }
 
+RGL_API rgl_status_t
+rgl_graph_get_frame_result_size(rgl_node_t node, int64_t frame_id, rgl_field_t field, int32_t* out_count, int32_t* out_size_of)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_frame_result_size(node={}, frame_id={}, field={}, out_count={}, out_size_of={})", repr(node), frame_id, field, (void*)out_count, (void*)out_size_of);
+		CHECK_ARG(node != nullptr);
+
+		VArray::ConstPtr output = getGraphFrameResult(Node::validatePtr<YieldPointsNode>(node), frame_id, field);
+		if (out_count != nullptr) { *out_count = (int32_t)output->getElemCount(); }
+		if (out_size_of != nullptr) { *out_size_of = (int32_t)getFieldSize(field); }
+	});
+	TAPE_HOOK(node, frame_id, field, out_count, out_size_of);
+	return status;
+}
+
+void TapePlay::tape_graph_get_frame_result_size(const YAML::Node& yamlNode)
+{
+	int32_t out_count, out_size_of;
+	rgl_graph_get_frame_result_size(tapeNodes[yamlNode[0].as<size_t>()],
+		yamlNode[1].as<int64_t>(),
+		(rgl_field_t)yamlNode[2].as<int>(),
+		&out_count,
+		&out_size_of);
+
+	if (out_count != yamlNode[3].as<int32_t>()) RGL_WARN("tape_graph_get_frame_result_size: out_count mismatch");
+	if (out_size_of != yamlNode[4].as<int32_t>()) RGL_WARN("tape_graph_get_frame_result_size: out_size_of mismatch");
+}
+
+RGL_API rgl_status_t
+rgl_graph_get_frame_result_data(rgl_node_t node, int64_t frame_id, rgl_field_t field, void* data)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_frame_result_data(node={}, frame_id={}, field={}, data={})", repr(node), frame_id, field, (void*)data);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(data != nullptr);
+
+		copyGraphFrameResult(Node::validatePtr<YieldPointsNode>(node), frame_id, field, data);
+	});
+	TAPE_HOOK(node, frame_id, field, data);
+	return status;
+}
+
+void TapePlay::tape_graph_get_frame_result_data(const YAML::Node& yamlNode)
+{
+	rgl_node_t node = tapeNodes[yamlNode[0].as<size_t>()];
+	int64_t frame_id = yamlNode[1].as<int64_t>();
+	rgl_field_t field = (rgl_field_t)yamlNode[2].as<int>();
+	int32_t out_count, out_size_of;
+	rgl_graph_get_frame_result_size(node, frame_id, field, &out_count, &out_size_of);
+	std::vector<char> tmpVec(out_count * out_size_of);
+	rgl_graph_get_frame_result_data(node, frame_id, field, tmpVec.data());
+}
+
+RGL_API rgl_status_t
+rgl_graph_bind_result_buffer(rgl_node_t node, rgl_field_t field, void* buffer, int64_t capacity_bytes, rgl_result_buffer_t type)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_bind_result_buffer(node={}, field={}, buffer={}, capacity_bytes={}, type={})",
+		            repr(node), field, buffer, capacity_bytes, static_cast<int>(type));
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(buffer == nullptr || capacity_bytes > 0);
+		CHECK_ARG(type == RGL_RESULT_BUFFER_HOST || type == RGL_RESULT_BUFFER_HOST_PINNED || type == RGL_RESULT_BUFFER_DEVICE);
+		bindGraphResultBuffer(Node::validatePtr(node), field, buffer, capacity_bytes, type);
+	});
+	TAPE_HOOK(node, field, buffer, capacity_bytes, type);
+	return status;
+}
+
+void TapePlay::tape_graph_bind_result_buffer(const YAML::Node& yamlNode)
+{
+	// Buffers belong to the recording process; replayed graphs provide results through rgl_graph_get_result_data
+	RGL_WARN("tape_graph_bind_result_buffer: user buffers are not replayed");
+}
+
+RGL_API rgl_status_t
+rgl_graph_wait_result_buffer(rgl_node_t node, rgl_field_t field, int32_t* out_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_wait_result_buffer(node={}, field={}, out_count={})", repr(node), field, (void*) out_count);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(out_count != nullptr);
+		auto nodeSafe = Node::validatePtr(node);
+		CHECK_CUDA(cudaEventSynchronize(getGraphResultBufferEvent(nodeSafe, field)));
+		*out_count = getGraphResultBufferPointCount(nodeSafe, field);
+	});
+	TAPE_HOOK(node, field, out_count);
+	return status;
+}
+
+void TapePlay::tape_graph_wait_result_buffer(const YAML::Node& yamlNode)
+{
+	// Buffers are not bound when replaying, see tape_graph_bind_result_buffer
+}
+
+RGL_API rgl_status_t
+rgl_graph_get_result_buffer_event(rgl_node_t node, rgl_field_t field, void** out_cuda_event)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_graph_get_result_buffer_event(node={}, field={}, out_cuda_event={})", repr(node), field, (void*) out_cuda_event);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(out_cuda_event != nullptr);
+		*out_cuda_event = getGraphResultBufferEvent(Node::validatePtr(node), field);
+	});
+	TAPE_HOOK(node, field, (void*) out_cuda_event);
+	return status;
+}
+
+void TapePlay::tape_graph_get_result_buffer_event(const YAML::Node& yamlNode)
+{
+	// Buffers are not bound when replaying, see tape_graph_bind_result_buffer
+}
+
 RGL_API rgl_status_t
 rgl_graph_node_set_active(rgl_node_t node, bool active)
 {
@@ -566,7 +1139,9 @@ rgl_graph_node_set_active(rgl_node_t node, bool active)
 		RGL_API_LOG("rgl_graph_node_set_active(node={}, active={})", repr(node), active);
 		CHECK_ARG(node != nullptr);
 
-		node->setActive(active);
+		auto nodeSafe = Node::validatePtr(node);
+		waitForGraph(nodeSafe);
+		nodeSafe->setActive(active);
 	});
 	TAPE_HOOK(node, active);
 	return status;
@@ -585,7 +1160,11 @@ rgl_graph_node_add_child(rgl_node_t parent, rgl_node_t child)
 		CHECK_ARG(parent != nullptr);
 		CHECK_ARG(child != nullptr);
 
-		parent->addChild(Node::validatePtr(child));
+		auto parentSafe = Node::validatePtr(parent);
+		auto childSafe = Node::validatePtr(child);
+		waitForGraph(parentSafe);
+		waitForGraph(childSafe);
+		parentSafe->addChild(childSafe);
 	});
 	TAPE_HOOK(parent, child);
 	return status;
@@ -604,7 +1183,9 @@ rgl_graph_node_remove_child(rgl_node_t parent, rgl_node_t child)
 		CHECK_ARG(parent != nullptr);
 		CHECK_ARG(child != nullptr);
 
-		parent->removeChild(Node::validatePtr(child));
+		auto parentSafe = Node::validatePtr(parent);
+		waitForGraph(parentSafe);
+		parentSafe->removeChild(Node::validatePtr(child));
 	});
 	TAPE_HOOK(parent, child);
 	return status;
@@ -661,6 +1242,29 @@ void TapePlay::tape_node_rays_set_ring_ids(const YAML::Node& yamlNode)
 	tapeNodes.insert(std::make_pair(nodeId, node));
 }
 
+RGL_API rgl_status_t
+rgl_node_rays_set_time_offsets(rgl_node_t* node, const float* time_offsets, int32_t time_offsets_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_node_rays_set_time_offsets(node={}, time_offsets={})", repr(node), repr(time_offsets, time_offsets_count));
+		CHECK_ARG(time_offsets != nullptr);
+		CHECK_ARG(time_offsets_count > 0);
+		createOrUpdateNode<SetTimeOffsetsRaysNode>(node, time_offsets, (size_t)time_offsets_count);
+	});
+	TAPE_HOOK(node, TAPE_ARRAY(time_offsets, time_offsets_count), time_offsets_count);
+	return status;
+}
+
+void TapePlay::tape_node_rays_set_time_offsets(const YAML::Node& yamlNode)
+{
+	size_t nodeId = yamlNode[0].as<size_t>();
+	rgl_node_t node = tapeNodes.contains(nodeId) ? tapeNodes[nodeId] : nullptr;
+	rgl_node_rays_set_time_offsets(&node,
+		reinterpret_cast<const float*>(fileMmap + yamlNode[1].as<size_t>()),
+		yamlNode[2].as<int>());
+	tapeNodes.insert(std::make_pair(nodeId, node));
+}
+
 RGL_API rgl_status_t
 rgl_node_rays_transform(rgl_node_t* node, const rgl_mat3x4f* transform)
 {
@@ -731,6 +1335,52 @@ void TapePlay::tape_node_raytrace(const YAML::Node& yamlNode)
 	tapeNodes.insert(std::make_pair(nodeId, node));
 }
 
+RGL_API rgl_status_t
+rgl_node_raytrace_set_backend(rgl_node_t node, rgl_raytrace_backend_t backend)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_node_raytrace_set_backend(node={}, backend={})", repr(node), static_cast<int>(backend));
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(backend == RGL_RAYTRACE_BACKEND_OPTIX || backend == RGL_RAYTRACE_BACKEND_CPU);
+
+		auto raytraceNode = Node::validatePtr<RaytraceNode>(node);
+		waitForGraph(raytraceNode);
+		raytraceNode->setBackend(backend);
+		raytraceNode->invalidateExecutionPlan();  // Raytrace nodes are batched by backend
+	});
+	TAPE_HOOK(node, backend);
+	return status;
+}
+
+void TapePlay::tape_node_raytrace_set_backend(const YAML::Node& yamlNode)
+{
+	rgl_node_raytrace_set_backend(tapeNodes[yamlNode[0].as<size_t>()],
+		static_cast<rgl_raytrace_backend_t>(yamlNode[1].as<int>()));
+}
+
+RGL_API rgl_status_t
+rgl_node_raytrace_set_return_count(rgl_node_t node, int32_t return_count)
+{
+	auto status = rglSafeCall([&]() {
+		RGL_API_LOG("rgl_node_raytrace_set_return_count(node={}, return_count={})", repr(node), return_count);
+		CHECK_ARG(node != nullptr);
+		CHECK_ARG(return_count >= 1 && return_count <= MAX_RETURN_COUNT);
+
+		auto raytraceNode = Node::validatePtr<RaytraceNode>(node);
+		waitForGraph(raytraceNode);
+		raytraceNode->setReturnCount(return_count);
+		raytraceNode->invalidateExecutionPlan();  // Width of the node's output changes
+	});
+	TAPE_HOOK(node, return_count);
+	return status;
+}
+
+void TapePlay::tape_node_raytrace_set_return_count(const YAML::Node& yamlNode)
+{
+	rgl_node_raytrace_set_return_count(tapeNodes[yamlNode[0].as<size_t>()],
+		yamlNode[1].as<int32_t>());
+}
+
 RGL_API rgl_status_t
 rgl_node_points_format(rgl_node_t* node, const rgl_field_t* fields, int32_t field_count)
 {
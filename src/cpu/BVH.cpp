@@ -0,0 +1,146 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cpu/BVH.hpp>
+
+#include <array>
+#include <numeric>
+
+static constexpr int SAH_BIN_COUNT = 16;
+static constexpr uint32_t MAX_LEAF_SIZE = 4;      // Nodes this small are not split
+static constexpr uint32_t MAX_SAH_LEAF_SIZE = 16; // Nodes bigger than this are split even if SAH prefers a leaf
+static constexpr float TRAVERSAL_COST = 1.0f;     // Relative to the cost of intersecting a primitive
+
+struct SplitCandidate
+{
+	int axis {-1};
+	float position {0.0f};
+	float cost {std::numeric_limits<float>::max()};
+};
+
+static SplitCandidate findSAHSplit(const std::vector<AABB>& primBounds, const std::vector<Vec3f>& centroids,
+                                   const uint32_t* prims, uint32_t count, const AABB& centroidBounds)
+{
+	struct Bin
+	{
+		AABB bounds;
+		uint32_t count {0};
+	};
+
+	SplitCandidate best;
+	for (int axis = 0; axis < 3; ++axis) {
+		float extentMin = centroidBounds.min[axis];
+		float extent = centroidBounds.max[axis] - extentMin;
+		if (extent <= 0.0f) {
+			continue;
+		}
+		float binScale = SAH_BIN_COUNT / extent;
+
+		std::array<Bin, SAH_BIN_COUNT> bins;
+		for (uint32_t i = 0; i < count; ++i) {
+			int bin = std::min(static_cast<int>((centroids[prims[i]][axis] - extentMin) * binScale), SAH_BIN_COUNT - 1);
+			bins[bin].bounds.grow(primBounds[prims[i]]);
+			bins[bin].count += 1;
+		}
+
+		// Sweep from the right to get costs of the right sides of all planes, then from the left to combine them
+		std::array<float, SAH_BIN_COUNT - 1> rightCost;
+		AABB rightBounds;
+		uint32_t rightCount = 0;
+		for (int plane = SAH_BIN_COUNT - 1; plane > 0; --plane) {
+			rightBounds.grow(bins[plane].bounds);
+			rightCount += bins[plane].count;
+			rightCost[plane - 1] = rightBounds.surfaceArea() * static_cast<float>(rightCount);
+		}
+		AABB leftBounds;
+		uint32_t leftCount = 0;
+		for (int plane = 1; plane < SAH_BIN_COUNT; ++plane) {
+			leftBounds.grow(bins[plane - 1].bounds);
+			leftCount += bins[plane - 1].count;
+			if (leftCount == 0 || leftCount == count) {
+				continue;
+			}
+			float cost = leftBounds.surfaceArea() * static_cast<float>(leftCount) + rightCost[plane - 1];
+			if (cost < best.cost) {
+				best = {.axis = axis, .position = extentMin + plane / binScale, .cost = cost};
+			}
+		}
+	}
+	return best;
+}
+
+BVH BVH::build(const std::vector<AABB>& primBounds)
+{
+	BVH bvh;
+	if (primBounds.empty()) {
+		return bvh;
+	}
+	std::vector<Vec3f> centroids;
+	centroids.reserve(primBounds.size());
+	for (auto&& bounds : primBounds) {
+		centroids.push_back(bounds.centroid());
+	}
+	bvh.primIndices.resize(primBounds.size());
+	std::iota(bvh.primIndices.begin(), bvh.primIndices.end(), 0);
+
+	// A binary tree with one primitive per leaf at most has that many nodes, so references to nodes are not invalidated
+	bvh.nodes.reserve(2 * primBounds.size() - 1);
+	bvh.nodes.push_back({.first = 0, .count = static_cast<uint32_t>(primBounds.size())});
+
+	struct Task
+	{
+		uint32_t nodeIdx;
+		int depth;
+	};
+	std::vector<Task> tasks = {{.nodeIdx = 0, .depth = 0}};
+	while (!tasks.empty()) {
+		Task task = tasks.back();
+		tasks.pop_back();
+		Node& node = bvh.nodes[task.nodeIdx];
+		uint32_t* prims = bvh.primIndices.data() + node.first;
+
+		AABB centroidBounds;
+		for (uint32_t i = 0; i < node.count; ++i) {
+			node.bounds.grow(primBounds[prims[i]]);
+			centroidBounds.grow(centroids[prims[i]]);
+		}
+		if (node.count <= MAX_LEAF_SIZE || task.depth == MAX_DEPTH) {
+			continue;
+		}
+
+		uint32_t leftCount = 0;
+		SplitCandidate split = findSAHSplit(primBounds, centroids, prims, node.count, centroidBounds);
+		if (split.axis >= 0) {
+			float splitCost = TRAVERSAL_COST + split.cost / node.bounds.surfaceArea();
+			if (splitCost >= static_cast<float>(node.count) && node.count <= MAX_SAH_LEAF_SIZE) {
+				continue;
+			}
+			auto isLeft = [&](uint32_t prim) { return centroids[prim][split.axis] < split.position; };
+			leftCount = static_cast<uint32_t>(std::partition(prims, prims + node.count, isLeft) - prims);
+		}
+		if (leftCount == 0 || leftCount == node.count) {
+			// Centroids are not separable (e.g. all equal), fall back to halving the range
+			leftCount = node.count / 2;
+		}
+
+		auto leftIdx = static_cast<uint32_t>(bvh.nodes.size());
+		bvh.nodes.push_back({.first = node.first, .count = leftCount});
+		bvh.nodes.push_back({.first = node.first + leftCount, .count = node.count - leftCount});
+		node.first = leftIdx;
+		node.count = 0;
+		tasks.push_back({.nodeIdx = leftIdx, .depth = task.depth + 1});
+		tasks.push_back({.nodeIdx = leftIdx + 1, .depth = task.depth + 1});
+	}
+	return bvh;
+}
@@ -0,0 +1,88 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <cpu/RayPacket.hpp>
+
+/**
+ * Bounding volume hierarchy built on the host using binned surface area heuristic.
+ * It is agnostic of the primitive type - it indexes both mesh triangles and scene instances.
+ * Traversal is done for packets of rays, visiting a node if any ray of the packet may hit it.
+ */
+struct BVH
+{
+	static constexpr int MAX_DEPTH = 64;
+
+	struct Node
+	{
+		AABB bounds;
+		uint32_t first;  // Index of the left child (the right one follows it) or of the first primitive in primIndices
+		uint32_t count;  // Number of primitives, 0 for inner nodes
+		bool isLeaf() const { return count > 0; }
+	};
+
+	static BVH build(const std::vector<AABB>& primBounds);
+
+	bool isEmpty() const { return nodes.empty(); }
+	const std::vector<Node>& getNodes() const { return nodes; }
+
+	/**
+	 * Calls intersect(primIdx, packet) for every primitive in leaves which the packet may hit.
+	 * The callback is expected to shorten tMax of lanes that hit the primitive, which culls farther nodes.
+	 */
+	template<int N, typename IntersectPrimitive>
+	void traverse(RayPacket<N>& packet, IntersectPrimitive&& intersect) const
+	{
+		if (nodes.empty()) {
+			return;
+		}
+		uint32_t stack[MAX_DEPTH + 1];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (!packet.intersectsAny(node.bounds)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				for (uint32_t i = 0; i < node.count; ++i) {
+					intersect(primIndices[node.first + i], packet);
+				}
+				continue;
+			}
+			// Children are visited front to back for the first active ray; the nearer one is pushed last
+			int lane = packet.getFirstActiveLane();
+			if (lane < 0) {
+				return;
+			}
+			Vec3f origin = packet.getOrigin(lane);
+			Vec3f dir = packet.getDir(lane);
+			auto distanceAlongRay = [&](const Node& child) {
+				Vec3f toChild = child.bounds.centroid() - origin;
+				return toChild[0] * dir[0] + toChild[1] * dir[1] + toChild[2] * dir[2];
+			};
+			bool leftIsNearer = distanceAlongRay(nodes[node.first]) <= distanceAlongRay(nodes[node.first + 1]);
+			stack[stackSize++] = leftIsNearer ? node.first + 1 : node.first;
+			stack[stackSize++] = leftIsNearer ? node.first : node.first + 1;
+		}
+	}
+
+private:
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primIndices;
+};
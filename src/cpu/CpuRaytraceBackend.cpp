@@ -0,0 +1,238 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cpu/CpuRaytraceBackend.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <latch>
+#include <thread>
+
+#include <scene/Scene.hpp>
+#include <scene/Entity.hpp>
+#include <gpu/RayReturns.hpp>
+#include <ThreadPool.hpp>
+
+// Mirrors saveRayResult() of the OptiX programs
+template<bool isFinite>
+static void saveRayResult(const RaytraceRequestContext& ctx, std::size_t rayIdx, int returnIdx, const Vec3f* xyz=nullptr, const Vec3f* origin=nullptr, float retro=DEFAULT_LASER_RETRO)
+{
+	std::size_t pointIdx = rayIdx * ctx.returnCount + returnIdx;
+	if (ctx.xyz != nullptr) {
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		ctx.xyz[pointIdx] = isFinite ? *xyz : Vec3f{inf, inf, inf};
+	}
+	if (ctx.isHit != nullptr) {
+		ctx.isHit[pointIdx] = isFinite;
+	}
+	if (ctx.rayIdx != nullptr) {
+		ctx.rayIdx[pointIdx] = rayIdx;
+	}
+	if (ctx.ringIdx != nullptr && ctx.ringIds != nullptr) {
+		ctx.ringIdx[pointIdx] = ctx.ringIds[rayIdx % ctx.ringIdsCount];
+	}
+	if (ctx.distance != nullptr) {
+		ctx.distance[pointIdx] = isFinite ? (*xyz - *origin).length() : std::numeric_limits<float>::infinity();
+	}
+	if (ctx.intensity != nullptr) {
+		ctx.intensity[pointIdx] = 100;
+	}
+	if (ctx.laserRetro != nullptr) {
+		ctx.laserRetro[pointIdx] = isFinite ? retro : 0.0f;
+	}
+	if (ctx.timeStamp != nullptr && ctx.timeOffsets != nullptr) {
+		ctx.timeStamp[pointIdx] = ctx.timeOffsets[rayIdx];
+	}
+	if (ctx.returnType != nullptr) {
+		ctx.returnType[pointIdx] = returnIdx;
+	}
+}
+
+void CpuRaytraceBackend::launch(Scene& scene, const std::vector<RaytraceRequestContext>& requests, cudaStream_t stream)
+{
+	prepareInstances(scene);
+
+	// Packets of all requests are numbered consecutively, so that workers are shared by all sensors
+	std::vector<std::size_t> firstPacketOfRequest;
+	std::size_t packetCount = 0;
+	for (auto&& request : requests) {
+		firstPacketOfRequest.push_back(packetCount);
+		packetCount += (request.rayCount + PACKET_SIZE - 1) / PACKET_SIZE;
+	}
+	std::size_t threadCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, std::max<std::size_t>(packetCount, 1));
+
+	// Packets are handed out dynamically, since their cost varies a lot (e.g. rays missing the scene are cheap).
+	// Helpers run in the ThreadPool, which may be busy (e.g. with branches launching as well), so the launching thread
+	// traces packets too; helpers starting after all packets are taken return without touching the launch's state.
+	struct Progress
+	{
+		explicit Progress(std::size_t packetCount) : finishedPackets(static_cast<std::ptrdiff_t>(packetCount)) {}
+		std::atomic<std::size_t> nextPacket {0};
+		std::latch finishedPackets;
+	};
+	auto progress = std::make_shared<Progress>(packetCount);
+	auto traceAvailablePackets = [this, progress, packetCount, &requests, &firstPacketOfRequest]() {
+		for (std::size_t packet = progress->nextPacket++; packet < packetCount; packet = progress->nextPacket++) {
+			auto requestIdx = std::upper_bound(firstPacketOfRequest.begin(), firstPacketOfRequest.end(), packet) - firstPacketOfRequest.begin() - 1;
+			tracePacket(requests[requestIdx], (packet - firstPacketOfRequest[requestIdx]) * PACKET_SIZE);
+			progress->finishedPackets.count_down();
+		}
+	};
+	for (std::size_t i = 1; i < threadCount; ++i) {
+		ThreadPool::instance().enqueue(traceAvailablePackets);
+	}
+	traceAvailablePackets();
+	progress->finishedPackets.wait();
+	// Instances hold geometries, which must not be kept alive until the next launch
+	instances.clear();
+}
+
+void CpuRaytraceBackend::prepareInstances(Scene& scene)
+{
+	std::vector<Instance> entities;
+	{
+		// API calls may modify entities while they are traced
+		auto sceneLock = scene.lock();
+		for (auto&& entity : scene.getEntities()) {
+			entities.push_back({
+				.geometry = entity->mesh->getGeometry(),
+				.pose = entity->getPose(),
+				.laserRetro = entity->getLaserRetro(),
+			});
+		}
+	}
+
+	instances.clear();
+	std::vector<AABB> instanceBounds;
+	for (auto&& instance : entities) {
+		instance.vertices = instance.geometry->getHostVertices();
+		instance.indices = &instance.geometry->getHostIndices();
+		instance.bvh = &getMeshBVH(instance.geometry, instance.vertices);
+		if (instance.bvh->isEmpty()) {
+			continue;
+		}
+		// Interpolated transforms move each point along a segment, so bounds at both keys enclose the whole motion
+		const AABB& objectBounds = instance.bvh->getNodes()[0].bounds;
+		AABB worldBounds;
+		for (auto&& transform : instance.pose.getTransformKeys()) {
+			for (int corner = 0; corner < 8; ++corner) {
+				Vec3f point {
+					(corner & 1) ? objectBounds.max[0] : objectBounds.min[0],
+					(corner & 2) ? objectBounds.max[1] : objectBounds.min[1],
+					(corner & 4) ? objectBounds.max[2] : objectBounds.min[2],
+				};
+				worldBounds.grow(transform * point);
+			}
+		}
+		instance.objectToWorld = instance.pose.getTransformKeys()[0];
+		instance.worldToObject = instance.objectToWorld.inverse();
+		instances.push_back(std::move(instance));
+		instanceBounds.push_back(worldBounds);
+	}
+	instanceBVH = BVH::build(instanceBounds);
+
+	// Forget BVHs of destroyed geometries
+	std::erase_if(meshBVHs, [](auto&& entry) { return entry.second.geometry.expired(); });
+}
+
+const BVH& CpuRaytraceBackend::getMeshBVH(const std::shared_ptr<MeshGeometry>& geometry, const std::shared_ptr<const std::vector<Vec3f>>& vertices)
+{
+	// Address of a destroyed geometry may be reused by a new one, hence the weak pointer is compared as well
+	auto it = meshBVHs.find(geometry.get());
+	if (it != meshBVHs.end() && it->second.geometry.lock() == geometry && it->second.vertices == vertices) {
+		return it->second.bvh;
+	}
+	const auto& indices = geometry->getHostIndices();
+	std::vector<AABB> triangleBounds(indices.size());
+	for (std::size_t i = 0; i < indices.size(); ++i) {
+		for (int corner = 0; corner < 3; ++corner) {
+			triangleBounds[i].grow((*vertices)[indices[i][corner]]);
+		}
+	}
+	auto& entry = meshBVHs[geometry.get()];
+	entry = {
+		.geometry = geometry,
+		.vertices = vertices,
+		.bvh = BVH::build(triangleBounds),
+	};
+	return entry.bvh;
+}
+
+void CpuRaytraceBackend::tracePacket(const RaytraceRequestContext& ctx, std::size_t firstRay) const
+{
+	int laneCount = static_cast<int>(std::min<std::size_t>(PACKET_SIZE, ctx.rayCount - firstRay));
+	RayPacket<PACKET_SIZE> packet;
+	float time[PACKET_SIZE] = {};
+	for (int lane = 0; lane < laneCount; ++lane) {
+		const Mat3x4f& ray = ctx.rays[firstRay + lane];
+		Vec3f origin = ray * Vec3f{0, 0, 0};
+		Vec3f dir = ray * Vec3f{0, 0, 1} - origin;
+		packet.setRay(lane, origin, dir, ctx.rayRange);
+		time[lane] = ctx.timeOffsets != nullptr ? ctx.timeOffsets[firstRay + lane] : 0.0f;
+	}
+
+	RayReturns returns[PACKET_SIZE];
+	instanceBVH.traverse(packet, [&](uint32_t instanceIdx, RayPacket<PACKET_SIZE>& worldRays) {
+		const Instance& instance = instances[instanceIdx];
+		RayPacket<PACKET_SIZE> objectRays;
+		Mat3x4f objectToWorld[PACKET_SIZE];
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			if (!worldRays.active[lane]) {
+				continue;
+			}
+			objectToWorld[lane] = instance.pose.isMoving() ? instance.pose.getTransformAt(time[lane]) : instance.objectToWorld;
+			Mat3x4f worldToObject = instance.pose.isMoving() ? objectToWorld[lane].inverse() : instance.worldToObject;
+			Vec3f origin = worldToObject * worldRays.getOrigin(lane);
+			Vec3f dir = worldToObject * (worldRays.getOrigin(lane) + worldRays.getDir(lane)) - origin;
+			objectRays.setRay(lane, origin, dir, worldRays.tMax[lane]);
+		}
+		// Affine transform preserves the ray parameter, so hit distances are comparable between instances
+		instance.bvh->traverse(objectRays, [&](uint32_t primitive, RayPacket<PACKET_SIZE>& rays) {
+			const Vec3i& index = (*instance.indices)[primitive];
+			const auto& vertices = *instance.vertices;
+			bool hit[PACKET_SIZE];
+			float t[PACKET_SIZE], u[PACKET_SIZE], v[PACKET_SIZE];
+			rays.intersectTriangle(vertices[index.x()], vertices[index.y()], vertices[index.z()], hit, t, u, v);
+			for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+				if (!hit[lane]) {
+					continue;
+				}
+				Vec3f hitObject = (1 - u[lane] - v[lane]) * vertices[index.x()] + u[lane] * vertices[index.y()] + v[lane] * vertices[index.z()];
+				returns[lane].insert(t[lane], RayReturns::makePrimitiveKey(instanceIdx, primitive), objectToWorld[lane] * hitObject,
+				                     instance.laserRetro, ctx.returnCount);
+				// Once enough returns are collected, only hits nearer than the farthest of them matter
+				if (returns[lane].isFull(ctx.returnCount)) {
+					rays.tMax[lane] = returns[lane].getFarthestDistance();
+				}
+			}
+		});
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			worldRays.tMax[lane] = objectRays.tMax[lane];
+		}
+	});
+
+	for (int lane = 0; lane < laneCount; ++lane) {
+		std::size_t rayIdx = firstRay + lane;
+		Vec3f origin = packet.getOrigin(lane);
+		for (int returnIdx = 0; returnIdx < ctx.returnCount; ++returnIdx) {
+			if (returnIdx < returns[lane].count) {
+				saveRayResult<true>(ctx, rayIdx, returnIdx, &returns[lane].xyz[returnIdx], &origin, returns[lane].laserRetro[returnIdx]);
+			}
+			else {
+				saveRayResult<false>(ctx, rayIdx, returnIdx);
+			}
+		}
+	}
+}
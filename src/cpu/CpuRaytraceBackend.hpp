@@ -0,0 +1,71 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <cpu/BVH.hpp>
+#include <graph/RaytraceBackend.hpp>
+#include <math/Mat3x4f.hpp>
+#include <scene/Entity.hpp>
+
+struct MeshGeometry;
+
+/**
+ * Reference raytracing on the host, producing the same outputs as the OptiX backend.
+ * Meshes are indexed by per-geometry BVHs, cached until their vertices change; instances are indexed by a BVH rebuilt per launch.
+ * Instances are snapshots of entities taken under the lock of the scene, kept only for the duration of a launch.
+ * Rays are traced in packets of consecutive rays of a single request, which are distributed among threads of the ThreadPool.
+ * Results do not depend on the number of threads.
+ */
+struct CpuRaytraceBackend : RaytraceBackend
+{
+	static constexpr int PACKET_SIZE = 8;
+
+	MemLoc getMemLoc() const override { return MemLoc::Host; }
+	void launch(Scene& scene, const std::vector<RaytraceRequestContext>& requests, cudaStream_t stream) override;
+
+private:
+	struct MeshBVH
+	{
+		std::weak_ptr<MeshGeometry> geometry;
+		std::shared_ptr<const std::vector<Vec3f>> vertices; // Snapshot the BVH was built for
+		BVH bvh;
+	};
+
+	struct Instance
+	{
+		std::shared_ptr<MeshGeometry> geometry; // Keeps host indices referenced below alive
+		std::shared_ptr<const std::vector<Vec3f>> vertices;
+		const std::vector<Vec3i>* indices;
+		const BVH* bvh;
+		Entity::Pose pose;
+		Mat3x4f objectToWorld; // Static entities only, moving ones are transformed per ray
+		Mat3x4f worldToObject;
+		float laserRetro;
+	};
+
+	void prepareInstances(Scene& scene);
+	const BVH& getMeshBVH(const std::shared_ptr<MeshGeometry>& geometry, const std::shared_ptr<const std::vector<Vec3f>>& vertices);
+	void tracePacket(const RaytraceRequestContext& ctx, std::size_t firstRay) const;
+
+private:
+	std::unordered_map<const MeshGeometry*, MeshBVH> meshBVHs;
+	std::vector<Instance> instances;
+	BVH instanceBVH;
+};
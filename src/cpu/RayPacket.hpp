@@ -0,0 +1,166 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <math/Vector.hpp>
+
+/**
+ * Axis-aligned bounding box. Default-constructed box is empty.
+ */
+struct AABB
+{
+	Vec3f min {std::numeric_limits<float>::max()};
+	Vec3f max {-std::numeric_limits<float>::max()};
+
+	bool isEmpty() const { return min[0] > max[0]; }
+
+	void grow(const Vec3f& point)
+	{
+		for (int i = 0; i < 3; ++i) {
+			min[i] = std::min(min[i], point[i]);
+			max[i] = std::max(max[i], point[i]);
+		}
+	}
+
+	void grow(const AABB& other)
+	{
+		if (!other.isEmpty()) {
+			grow(other.min);
+			grow(other.max);
+		}
+	}
+
+	Vec3f centroid() const { return (min + max).half(); }
+
+	float surfaceArea() const
+	{
+		if (isEmpty()) {
+			return 0.0f;
+		}
+		Vec3f d = max - min;
+		return 2.0f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+	}
+};
+
+/**
+ * Packet of N rays laid out as structure of arrays.
+ * Operations on packets are written as loops over lanes, which compilers turn into SIMD code.
+ * Inactive lanes are never reported as hits.
+ */
+template<int N>
+struct RayPacket
+{
+	static constexpr int SIZE = N;
+
+	float originX[N], originY[N], originZ[N];
+	float dirX[N], dirY[N], dirZ[N];
+	float invDirX[N], invDirY[N], invDirZ[N];
+	float tMax[N];
+	bool active[N];
+
+	RayPacket()
+	{
+		for (int lane = 0; lane < N; ++lane) {
+			deactivate(lane);
+		}
+	}
+
+	void setRay(int lane, const Vec3f& origin, const Vec3f& dir, float maxDistance)
+	{
+		originX[lane] = origin[0];
+		originY[lane] = origin[1];
+		originZ[lane] = origin[2];
+		dirX[lane] = dir[0];
+		dirY[lane] = dir[1];
+		dirZ[lane] = dir[2];
+		invDirX[lane] = 1.0f / dir[0];
+		invDirY[lane] = 1.0f / dir[1];
+		invDirZ[lane] = 1.0f / dir[2];
+		tMax[lane] = maxDistance;
+		active[lane] = true;
+	}
+
+	void deactivate(int lane)
+	{
+		setRay(lane, Vec3f {0.0f}, Vec3f {1.0f}, 0.0f);
+		active[lane] = false;
+	}
+
+	Vec3f getOrigin(int lane) const { return {originX[lane], originY[lane], originZ[lane]}; }
+	Vec3f getDir(int lane) const { return {dirX[lane], dirY[lane], dirZ[lane]}; }
+
+	int getFirstActiveLane() const
+	{
+		for (int lane = 0; lane < N; ++lane) {
+			if (active[lane]) {
+				return lane;
+			}
+		}
+		return -1;
+	}
+
+	// Slab test; true if any active lane enters the box before its tMax.
+	bool intersectsAny(const AABB& box) const
+	{
+		bool anyHit = false;
+		for (int lane = 0; lane < N; ++lane) {
+			float tx0 = (box.min[0] - originX[lane]) * invDirX[lane];
+			float tx1 = (box.max[0] - originX[lane]) * invDirX[lane];
+			float ty0 = (box.min[1] - originY[lane]) * invDirY[lane];
+			float ty1 = (box.max[1] - originY[lane]) * invDirY[lane];
+			float tz0 = (box.min[2] - originZ[lane]) * invDirZ[lane];
+			float tz1 = (box.max[2] - originZ[lane]) * invDirZ[lane];
+			float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+			float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tMax[lane]));
+			anyHit |= active[lane] && tNear <= tFar;
+		}
+		return anyHit;
+	}
+
+	/**
+	 * Moller-Trumbore test of all lanes against a double-sided triangle.
+	 * Lanes hitting the triangle closer than their tMax get hit[lane] set, along with distance and barycentrics.
+	 */
+	void intersectTriangle(const Vec3f& a, const Vec3f& b, const Vec3f& c, bool (&hit)[N], float (&t)[N], float (&u)[N], float (&v)[N]) const
+	{
+		Vec3f e1 = b - a;
+		Vec3f e2 = c - a;
+		for (int lane = 0; lane < N; ++lane) {
+			// p = dir x e2
+			float px = dirY[lane] * e2[2] - dirZ[lane] * e2[1];
+			float py = dirZ[lane] * e2[0] - dirX[lane] * e2[2];
+			float pz = dirX[lane] * e2[1] - dirY[lane] * e2[0];
+			float det = e1[0] * px + e1[1] * py + e1[2] * pz;
+			float invDet = 1.0f / det;
+			float sx = originX[lane] - a[0];
+			float sy = originY[lane] - a[1];
+			float sz = originZ[lane] - a[2];
+			u[lane] = (sx * px + sy * py + sz * pz) * invDet;
+			// q = s x e1
+			float qx = sy * e1[2] - sz * e1[1];
+			float qy = sz * e1[0] - sx * e1[2];
+			float qz = sx * e1[1] - sy * e1[0];
+			v[lane] = (dirX[lane] * qx + dirY[lane] * qy + dirZ[lane] * qz) * invDet;
+			t[lane] = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * invDet;
+			hit[lane] = active[lane] && det != 0.0f
+			         && u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f
+			         && t[lane] >= 0.0f && t[lane] < tMax[lane];
+		}
+	}
+};
@@ -193,12 +193,12 @@ void Optix::initializeStaticOptixStructures()
 	};
 
 	OptixPipelineCompileOptions pipelineCompileOptions = {
-		.usesMotionBlur = false,
+		.usesMotionBlur = true,  // Moving entities are intersected at the firing time of each ray
 		.traversableGraphFlags = OPTIX_TRAVERSABLE_GRAPH_FLAG_ALLOW_ANY,
-		.numPayloadValues = 3,  // Ray origin: X, Y, Z
+		.numPayloadValues = 5,  // Ray origin: X, Y, Z; pointer to RayReturns in multi-return mode
 		.numAttributeValues = 2,  // Triangle barycentrics: X, Y
 		.exceptionFlags = OPTIX_EXCEPTION_FLAG_NONE,
-		.pipelineLaunchParamsVariableName = "ctx",
+		.pipelineLaunchParamsVariableName = "launchParams",
 	};
 
 	OptixPipelineLinkOptions pipelineLinkOptions = {
@@ -0,0 +1,91 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gpu/OptixRaytraceBackend.hpp>
+#include <gpu/Optix.hpp>
+#include <scene/Scene.hpp>
+#include <macros/optix.hpp>
+#include <graph/GraphRunner.hpp>
+
+#include <cstring>
+
+// Slot of the oldest frame that may still be in flight is reused only after the runner waited for it
+OptixRaytraceBackend::OptixRaytraceBackend() : hostStaging(GraphRunner::MAX_PIPELINE_DEPTH + 1) {}
+
+void OptixRaytraceBackend::launch(Scene& scene, const std::vector<RaytraceRequestContext>& requests, cudaStream_t stream)
+{
+	if (requests.empty()) {
+		return;
+	}
+	// Scene updates are enqueued in the same stream as the launch below, no synchronization is needed in between.
+	// The scene stays locked until the launch is enqueued, so that updates by other graphs are ordered after it.
+	auto sceneLock = scene.lock();
+	OptixTraversableHandle sceneAS = scene.getAS(stream);
+	auto sceneSBT = scene.getSBT(stream);
+
+	// Launch grid is sized for the sensor with the most rays, raygen discards indices past the ray count of other sensors
+	std::size_t maxRayCount = 0;
+	for (auto&& request : requests) {
+		maxRayCount = std::max(maxRayCount, request.rayCount);
+	}
+	if (maxRayCount == 0) {
+		return;
+	}
+	dim3 launchDims = {static_cast<unsigned int>(maxRayCount), static_cast<unsigned int>(requests.size()), 1};
+
+	HostStaging& staging = hostStaging[nextHostStaging];
+	nextHostStaging = (nextHostStaging + 1) % hostStaging.size();
+
+	const RaytraceRequestContext* deviceRequests = upload(requests, staging.requestCtxs, requestCtxs, stream);
+	std::vector<RaytraceLaunchParams> params = {{
+		.scene = sceneAS,
+		.requests = deviceRequests,
+		.requestCount = static_cast<int>(requests.size()),
+	}};
+	RaytraceLaunchParams* deviceParams = upload(params, staging.launchParams, launchParams, stream);
+
+	CUdeviceptr pipelineArgsPtr = reinterpret_cast<CUdeviceptr>(deviceParams);
+	std::size_t pipelineArgsSize = sizeof(RaytraceLaunchParams);
+	CHECK_OPTIX(optixLaunch(Optix::getOrCreate().pipeline, stream, pipelineArgsPtr, pipelineArgsSize, &sceneSBT, launchDims.x, launchDims.y, launchDims.z));
+	launchedAS = sceneAS;
+	launchedSBT = sceneSBT;
+}
+
+bool OptixRaytraceBackend::prepareReplay(Scene& scene, cudaStream_t stream)
+{
+	auto sceneLock = scene.lock();
+	scene.prepare(stream);
+	if (!launchedAS.has_value() || !launchedSBT.has_value()) {
+		return false;
+	}
+	// Refits and in-place uploads keep the handle and SBT, recorded launches see their results
+	OptixShaderBindingTable sbt = scene.getSBT(stream);
+	return scene.getAS(stream) == *launchedAS && std::memcmp(&sbt, &*launchedSBT, sizeof(sbt)) == 0;
+}
+
+template<typename T>
+T* OptixRaytraceBackend::upload(const std::vector<T>& src, const typename VArrayProxy<T>::Ptr& hostBuffer,
+                                const typename VArrayProxy<T>::Ptr& deviceBuffer, cudaStream_t stream)
+{
+	// Host buffer must stay intact until the copy is executed, which for recorded launches means until they are re-recorded
+	hostBuffer->getWritePtr(MemLoc::Host);  // Moves the buffer to pinned host memory, if it is not there yet
+	hostBuffer->resize(src.size(), false, false);
+	T* hostPtr = hostBuffer->getWritePtr(MemLoc::Host);
+	std::copy(src.begin(), src.end(), hostPtr);
+	deviceBuffer->resize(src.size(), false, false);
+	T* devicePtr = deviceBuffer->getWritePtr(MemLoc::Device);
+	CHECK_CUDA(cudaMemcpyAsync(devicePtr, hostPtr, src.size() * sizeof(T), cudaMemcpyHostToDevice, stream));
+	return devicePtr;
+}
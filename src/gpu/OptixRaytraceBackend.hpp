@@ -0,0 +1,59 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <VArrayProxy.hpp>
+#include <graph/RaytraceBackend.hpp>
+
+/**
+ * Traces rays with OptiX against acceleration structures and SBT maintained by the Scene.
+ * All requests are traced by a single launch, see RaytraceLaunchParams.
+ * Launch parameters are uploaded asynchronously from pinned host buffers owned by the backend, hence launches can be recorded.
+ */
+struct OptixRaytraceBackend : RaytraceBackend
+{
+	OptixRaytraceBackend();
+
+	MemLoc getMemLoc() const override { return MemLoc::Device; }
+	void launch(Scene& scene, const std::vector<RaytraceRequestContext>& requests, cudaStream_t stream) override;
+	bool canFuseRayTransforms() const override { return true; }
+	bool isCapturable() const override { return true; }
+	bool prepareReplay(Scene& scene, cudaStream_t stream) override;
+
+private:
+	template<typename T>
+	T* upload(const std::vector<T>& src, const typename VArrayProxy<T>::Ptr& hostBuffer, const typename VArrayProxy<T>::Ptr& deviceBuffer, cudaStream_t stream);
+
+private:
+	// Pinned host sources of the uploads; copies of pipelined frames may be pending, hence each launch uses the next slot
+	struct HostStaging
+	{
+		VArrayProxy<RaytraceRequestContext>::Ptr requestCtxs = VArrayProxy<RaytraceRequestContext>::create();
+		VArrayProxy<RaytraceLaunchParams>::Ptr launchParams = VArrayProxy<RaytraceLaunchParams>::create();
+	};
+	std::vector<HostStaging> hostStaging;
+	std::size_t nextHostStaging {0};
+
+	VArrayProxy<RaytraceRequestContext>::Ptr requestCtxs = VArrayProxy<RaytraceRequestContext>::create();
+	VArrayProxy<RaytraceLaunchParams>::Ptr launchParams = VArrayProxy<RaytraceLaunchParams>::create();
+
+	// Scene as seen by the last launch
+	std::optional<OptixTraversableHandle> launchedAS;
+	std::optional<OptixShaderBindingTable> launchedSBT;
+};
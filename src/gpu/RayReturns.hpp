@@ -0,0 +1,66 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstdint>
+
+#include <math/Vector.hpp>
+
+// Upper bound of hits recorded per ray in multi-return mode
+static constexpr int MAX_RETURN_COUNT = 4;
+
+/**
+ * Nearest hits along a ray, sorted by distance; filled during a single traversal in multi-return mode.
+ * Shared by the OptiX programs and the CPU backend.
+ */
+struct RayReturns
+{
+	int count {0};
+	float distance[MAX_RETURN_COUNT];
+	Vec3f xyz[MAX_RETURN_COUNT];
+	float laserRetro[MAX_RETURN_COUNT];
+	uint64_t primitiveKey[MAX_RETURN_COUNT]; // Instance and primitive id; traversal may report an intersection more than once
+
+	static HostDevFn uint64_t makePrimitiveKey(uint32_t instanceId, uint32_t primitiveId)
+	{ return (static_cast<uint64_t>(instanceId) << 32) | primitiveId; }
+
+	HostDevFn bool isFull(int capacity) const { return count == capacity; }
+	HostDevFn float getFarthestDistance() const { return distance[count - 1]; }
+
+	// Records the hit if it is one of the `capacity` nearest ones reported so far.
+	HostDevFn void insert(float hitDistance, uint64_t key, const Vec3f& hitXYZ, float hitLaserRetro, int capacity)
+	{
+		for (int i = 0; i < count; ++i) {
+			if (primitiveKey[i] == key) {
+				return;
+			}
+		}
+		if (isFull(capacity) && hitDistance >= getFarthestDistance()) {
+			return;
+		}
+		int i = isFull(capacity) ? capacity - 1 : count++;
+		for (; i > 0 && distance[i - 1] > hitDistance; --i) {
+			distance[i] = distance[i - 1];
+			xyz[i] = xyz[i - 1];
+			laserRetro[i] = laserRetro[i - 1];
+			primitiveKey[i] = primitiveKey[i - 1];
+		}
+		distance[i] = hitDistance;
+		xyz[i] = hitXYZ;
+		laserRetro[i] = hitLaserRetro;
+		primitiveKey[i] = key;
+	}
+};
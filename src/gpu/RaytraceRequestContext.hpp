@@ -15,21 +15,32 @@
 #pragma once
 
 #include <optix.h>
+#include <math/Mat3x4f.hpp>
 #include <RGLFields.hpp>
 
+// Length of the chain of TransformRaysNodes that can be folded into a launch, see RaytraceRequestContext::rayTransforms
+static constexpr int MAX_FUSED_RAY_TRANSFORMS = 4;
+
+// Rays of a single sensor (RaytraceNode) and outputs for their results
 struct RaytraceRequestContext
 {
 	// Input
 	const Mat3x4f* rays;
 	size_t rayCount;
 
+	// Applied to each ray in order before tracing, instead of materializing rays of the fused TransformRaysNodes
+	Mat3x4f rayTransforms[MAX_FUSED_RAY_TRANSFORMS];
+	int rayTransformCount;
+
 	Mat3x4f rayOriginToWorld;
 	float rayRange;
 
 	const int* ringIds;
 	size_t ringIdsCount;
 
-	OptixTraversableHandle scene;
+	const float* timeOffsets;  // Optional, firing time of each ray; rays without it are traced at time 0
+
+	int returnCount;  // Hits recorded per ray; output point of the k-th return of ray r has index r * returnCount + k
 
 	// Output
 	Field<XYZ_F32>::type* xyz;
@@ -39,5 +50,19 @@ struct RaytraceRequestContext
 	Field<DISTANCE_F32>::type* distance;
 	Field<INTENSITY_F32>::type* intensity;
 	Field<LASER_RETRO_F32>::type* laserRetro;
+	Field<TIME_STAMP_F64>::type* timeStamp;
+	Field<RETURN_TYPE_U8>::type* returnType;
 };
 static_assert(std::is_trivially_copyable<RaytraceRequestContext>::value);
+
+/**
+ * Parameters of a single OptiX launch tracing requests of many sensors at once.
+ * The launch grid is (max ray count) x (request count): launch index y selects the request, x the ray within it.
+ */
+struct RaytraceLaunchParams
+{
+	OptixTraversableHandle scene;
+	const RaytraceRequestContext* requests;
+	int requestCount;
+};
+static_assert(std::is_trivially_copyable<RaytraceLaunchParams>::value);
@@ -17,8 +17,7 @@
 #include <macros/cuda.hpp>
 #include <vector>
 
-#include <thrust/device_ptr.h>
-#include <thrust/scan.h>
+#include <cub/device/device_scan.cuh>
 
 #define LIMIT(count) const int tid = (blockIdx.x * blockDim.x + threadIdx.x); do {if (tid >= count) { return; }} while(false)
 
@@ -40,6 +39,20 @@ __global__ void kFormat(size_t pointCount, size_t pointSize, size_t fieldCount,
 	}
 }
 
+// Formats only the points that should be written, at positions given by the inclusive prefix sum of shouldWrite
+__global__ void kFormatCompacted(size_t pointCount, size_t pointSize, size_t fieldCount, const GPUFieldDesc* fields,
+                                 const Field<IS_HIT_I32>::type* shouldWrite, const CompactionIndexType* writeIndex, char* out)
+{
+	LIMIT(pointCount);
+	if (!shouldWrite[tid]) {
+		return;
+	}
+	int wIdx = writeIndex[tid] - 1;
+	for (size_t i = 0; i < fieldCount; ++i) {
+		memcpy(out + pointSize * wIdx + fields[i].dstOffset, fields[i].data + fields[i].size * tid, fields[i].size);
+	}
+}
+
 __global__ void kTransformRays(size_t rayCount, const Mat3x4f* inRays, Mat3x4f* outRays, Mat3x4f transform)
 {
 	LIMIT(rayCount);
@@ -75,21 +88,29 @@ __global__ void kFilter(size_t count, const Field<RAY_IDX_U32>::type* indices, c
 	memcpy(dst + tid * fieldSize, src + indices[tid] * fieldSize, fieldSize);
 }
 
-void gpuFindCompaction(cudaStream_t stream, size_t pointCount, const Field<IS_HIT_I32>::type* isHit, CompactionIndexType* hitCountInclusive, size_t* outHitCount)
+std::size_t gpuFindCompactionStorageSize(size_t pointCount)
 {
-	// beg and end could be used as const pointers, however thrust does not support it
-	auto beg = thrust::device_ptr<const int32_t>(isHit);
-	auto end = thrust::device_ptr<const int32_t>(isHit + pointCount);
-	auto dst = thrust::device_ptr<int32_t>(hitCountInclusive);
+	std::size_t storageSize = 0;
+	CompactionIndexType* none = nullptr;
+	CHECK_CUDA(cub::DeviceScan::InclusiveSum(nullptr, storageSize, none, none, static_cast<int>(pointCount)));
+	return storageSize;
+}
 
-	// Note: this will compile only in a .cu file
-	thrust::inclusive_scan(thrust::cuda::par.on(stream), beg, end, dst);
+void gpuFindCompaction(cudaStream_t stream, size_t pointCount, const Field<IS_HIT_I32>::type* isHit, CompactionIndexType* hitCountInclusive,
+                       CompactionIndexType* outHitCount, void* storage, size_t storageSize)
+{
+	// Unlike thrust, cub neither allocates temporary memory nor synchronizes the stream, hence the scan can be captured
+	CHECK_CUDA(cub::DeviceScan::InclusiveSum(storage, storageSize, isHit, hitCountInclusive, static_cast<int>(pointCount), stream));
 	CHECK_CUDA(cudaMemcpyAsync(outHitCount, hitCountInclusive + pointCount - 1, sizeof(*hitCountInclusive), cudaMemcpyDefault, stream));
 }
 
 void gpuFormat(cudaStream_t stream, size_t pointCount, size_t pointSize, size_t fieldCount, const GPUFieldDesc *fields, char *out)
 { run(kFormat, stream, pointCount, pointSize, fieldCount, fields, out); }
 
+void gpuFormatCompacted(cudaStream_t stream, size_t pointCount, size_t pointSize, size_t fieldCount, const GPUFieldDesc *fields,
+                        const Field<IS_HIT_I32>::type* shouldWrite, const CompactionIndexType* writeIndex, char *out)
+{ run(kFormatCompacted, stream, pointCount, pointSize, fieldCount, fields, shouldWrite, writeIndex, out); }
+
 void gpuTransformRays(cudaStream_t stream, size_t rayCount, const Mat3x4f* inRays, Mat3x4f* outRays, Mat3x4f transform)
 { run(kTransformRays, stream, rayCount, inRays, outRays, transform); };
 
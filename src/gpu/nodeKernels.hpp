@@ -29,8 +29,12 @@
 // This could be defined in CompactNode, however such include here causes mess because nvcc does not support C++20.
 using CompactionIndexType = int32_t;
 
-void gpuFindCompaction(cudaStream_t, size_t pointCount, const Field<IS_HIT_I32>::type* isHit, CompactionIndexType* hitCountInclusive, size_t* outHitCount);
+std::size_t gpuFindCompactionStorageSize(size_t pointCount);  // Size of the temporary storage needed by gpuFindCompaction
+void gpuFindCompaction(cudaStream_t, size_t pointCount, const Field<IS_HIT_I32>::type* isHit, CompactionIndexType* hitCountInclusive,
+                       CompactionIndexType* outHitCount, void* storage, size_t storageSize);
 void gpuFormat(cudaStream_t, size_t pointCount, size_t pointSize, size_t fieldCount, const GPUFieldDesc *fields, char *out);
+void gpuFormatCompacted(cudaStream_t, size_t pointCount, size_t pointSize, size_t fieldCount, const GPUFieldDesc *fields,
+                        const Field<IS_HIT_I32>::type* shouldWrite, const CompactionIndexType* writeIndex, char *out);
 void gpuTransformRays(cudaStream_t, size_t rayCount, const Mat3x4f* inRays, Mat3x4f* outRays, Mat3x4f transform);
 void gpuApplyCompaction(cudaStream_t, size_t pointCount, size_t fieldSize, const Field<IS_HIT_I32>::type* shouldWrite, const CompactionIndexType* writeIndex, char* dst, const char* src);
 void gpuTransformPoints(cudaStream_t, size_t pointCount, const Field<XYZ_F32>::type* inPoints, Field<XYZ_F32>::type* outPoints, Mat3x4f transform);
@@ -21,11 +21,19 @@
 #include <cassert>
 
 #include <gpu/RaytraceRequestContext.hpp>
+#include <gpu/RayReturns.hpp>
 #include <gpu/ShaderBindingTableTypes.h>
 
 #define DEFAULT_LASER_RETRO 100.0
 
-extern "C" static __constant__ RaytraceRequestContext ctx;
+extern "C" static __constant__ RaytraceLaunchParams launchParams;
+
+// Request of the sensor which fired the current ray
+__forceinline__ __device__
+const RaytraceRequestContext& getRequest()
+{
+	return launchParams.requests[optixGetLaunchIndex().y];
+}
 
 struct Vec3fPayload
 {
@@ -54,26 +62,44 @@ Vec3f decodePayloadVec3f(const Vec3fPayload& src)
 	};
 }
 
+__forceinline__ __device__
+void encodePayloadPointer(void* ptr, unsigned& p0, unsigned& p1)
+{
+	const unsigned long long raw = reinterpret_cast<unsigned long long>(ptr);
+	p0 = static_cast<unsigned>(raw >> 32);
+	p1 = static_cast<unsigned>(raw & 0xFFFFFFFF);
+}
+
+template<typename T>
+__forceinline__ __device__
+T* decodePayloadPointer(unsigned p0, unsigned p1)
+{
+	return reinterpret_cast<T*>((static_cast<unsigned long long>(p0) << 32) | p1);
+}
+
+// Writes the point of the given return of the current ray; in single-return mode the point index equals the ray index.
 template<bool isFinite>
 __forceinline__ __device__
-void saveRayResult(const Vec3f* xyz=nullptr, const Vec3f* origin=nullptr, const float retro = DEFAULT_LASER_RETRO)
+void saveRayResult(int returnIdx, const Vec3f* xyz=nullptr, const Vec3f* origin=nullptr, const float retro = DEFAULT_LASER_RETRO)
 {
+	const RaytraceRequestContext& ctx = getRequest();
 	const int rayIdx = optixGetLaunchIndex().x;
+	const int pointIdx = rayIdx * ctx.returnCount + returnIdx;
 	if (ctx.xyz != nullptr) {
 		// Return actual XYZ of the hit point or infinity vector.
-		ctx.xyz[rayIdx] = isFinite ? *xyz : Vec3f{CUDART_INF_F, CUDART_INF_F, CUDART_INF_F};
+		ctx.xyz[pointIdx] = isFinite ? *xyz : Vec3f{CUDART_INF_F, CUDART_INF_F, CUDART_INF_F};
 	}
 	if (ctx.isHit != nullptr) {
-		ctx.isHit[rayIdx] = isFinite;
+		ctx.isHit[pointIdx] = isFinite;
 	}
 	if (ctx.rayIdx != nullptr) {
-		ctx.rayIdx[rayIdx] = rayIdx;
+		ctx.rayIdx[pointIdx] = rayIdx;
 	}
 	if (ctx.ringIdx != nullptr && ctx.ringIds != nullptr) {
-		ctx.ringIdx[rayIdx] = ctx.ringIds[rayIdx % ctx.ringIdsCount];
+		ctx.ringIdx[pointIdx] = ctx.ringIds[rayIdx % ctx.ringIdsCount];
 	}
 	if (ctx.distance != nullptr) {
-		ctx.distance[rayIdx] = isFinite
+		ctx.distance[pointIdx] = isFinite
 		                        ? sqrt(
 		                            pow((*xyz)[0] - (*origin)[0], 2) +
 		                            pow((*xyz)[1] - (*origin)[1], 2) +
@@ -81,35 +107,22 @@ void saveRayResult(const Vec3f* xyz=nullptr, const Vec3f* origin=nullptr, const
 		                        : CUDART_INF_F;
 	}
 	if (ctx.intensity != nullptr) {
-		ctx.intensity[rayIdx] = 100;
+		ctx.intensity[pointIdx] = 100;
 	}
 	if (ctx.laserRetro != nullptr) {
-		ctx.laserRetro[rayIdx] = isFinite? retro : 0.0;
+		ctx.laserRetro[pointIdx] = isFinite? retro : 0.0;
 	}
-}
-
-extern "C" __global__ void __raygen__()
-{
-	if (ctx.scene == 0) {
-		saveRayResult<false>();
-		return;
+	if (ctx.timeStamp != nullptr && ctx.timeOffsets != nullptr) {
+		ctx.timeStamp[pointIdx] = ctx.timeOffsets[rayIdx];
+	}
+	if (ctx.returnType != nullptr) {
+		ctx.returnType[pointIdx] = returnIdx;
 	}
-
-	Mat3x4f ray = ctx.rays[optixGetLaunchIndex().x];
-
-	Vec3f origin = ray * Vec3f{0, 0, 0};
-	Vec3f dir = ray * Vec3f{0, 0, 1} - origin;
-
-	unsigned int flags = OPTIX_RAY_FLAG_DISABLE_ANYHIT;
-	Vec3fPayload originPayload = encodePayloadVec3f(origin);
-	optixTrace(ctx.scene, origin, dir, 0.0f, ctx.rayRange, 0.0f, OptixVisibilityMask(255), flags, 0, 1, 0,
-	           originPayload.p0, originPayload.p1, originPayload.p2);
 }
 
-extern "C" __global__ void __closesthit__()
+__forceinline__ __device__
+Vec3f getHitPointInWorld(const TriangleMeshSBTData& sbtData)
 {
-	const TriangleMeshSBTData& sbtData = *(const TriangleMeshSBTData*) optixGetSbtDataPointer();
-
 	const int primID = optixGetPrimitiveIndex();
 	assert(primID < sbtData.index_count);
 	const Vec3i index = sbtData.index[primID];
@@ -124,7 +137,67 @@ extern "C" __global__ void __closesthit__()
 	const Vec3f& C = sbtData.vertex[index.z()];
 
 	Vec3f hitObject = Vec3f((1 - u - v) * A + u * B + v * C);
-	Vec3f hitWorld = optixTransformPointFromObjectToWorldSpace(hitObject);
+	return optixTransformPointFromObjectToWorldSpace(hitObject);
+}
+
+extern "C" __global__ void __raygen__()
+{
+	const RaytraceRequestContext& ctx = getRequest();
+	if (optixGetLaunchIndex().x >= ctx.rayCount) {
+		return;  // Requests of other sensors have more rays
+	}
+
+	if (launchParams.scene == 0) {
+		for (int returnIdx = 0; returnIdx < ctx.returnCount; ++returnIdx) {
+			saveRayResult<false>(returnIdx);
+		}
+		return;
+	}
+
+	Mat3x4f ray = ctx.rays[optixGetLaunchIndex().x];
+	for (int i = 0; i < ctx.rayTransformCount; ++i) {
+		ray = ctx.rayTransforms[i] * ray;
+	}
+	float rayTime = ctx.timeOffsets != nullptr ? ctx.timeOffsets[optixGetLaunchIndex().x] : 0.0f;
+
+	Vec3f origin = ray * Vec3f{0, 0, 0};
+	Vec3f dir = ray * Vec3f{0, 0, 1} - origin;
+
+	Vec3fPayload originPayload = encodePayloadVec3f(origin);
+	if (ctx.returnCount == 1) {
+		// Closest hit is reported by __closesthit__ / __miss__
+		unsigned int flags = OPTIX_RAY_FLAG_DISABLE_ANYHIT;
+		optixTrace(launchParams.scene, origin, dir, 0.0f, ctx.rayRange, rayTime, OptixVisibilityMask(255), flags, 0, 1, 0,
+		           originPayload.p0, originPayload.p1, originPayload.p2);
+		return;
+	}
+
+	// Multi-return: __anyhit__ collects the nearest hits of the whole traversal
+	RayReturns returns;
+	unsigned returnsPayload0, returnsPayload1;
+	encodePayloadPointer(&returns, returnsPayload0, returnsPayload1);
+	unsigned int flags = OPTIX_RAY_FLAG_ENFORCE_ANYHIT;
+	optixTrace(launchParams.scene, origin, dir, 0.0f, ctx.rayRange, rayTime, OptixVisibilityMask(255), flags, 0, 1, 0,
+	           originPayload.p0, originPayload.p1, originPayload.p2, returnsPayload0, returnsPayload1);
+	for (int returnIdx = 0; returnIdx < ctx.returnCount; ++returnIdx) {
+		if (returnIdx < returns.count) {
+			saveRayResult<true>(returnIdx, &returns.xyz[returnIdx], &origin, returns.laserRetro[returnIdx]);
+		}
+		else {
+			saveRayResult<false>(returnIdx);
+		}
+	}
+}
+
+extern "C" __global__ void __closesthit__()
+{
+	const RaytraceRequestContext& ctx = getRequest();
+	// In multi-return mode results are saved by __raygen__
+	if (ctx.returnCount > 1) {
+		return;
+	}
+	const TriangleMeshSBTData& sbtData = *(const TriangleMeshSBTData*) optixGetSbtDataPointer();
+	Vec3f hitWorld = getHitPointInWorld(sbtData);
 
 	float retro = sbtData.laser_retro;
 
@@ -133,12 +206,32 @@ extern "C" __global__ void __closesthit__()
 		optixGetPayload_1(),
 		optixGetPayload_2()
 	});
-	saveRayResult<true>(&hitWorld, &origin, retro);
+	saveRayResult<true>(0, &hitWorld, &origin, retro);
 }
 
 extern "C" __global__ void __miss__()
 {
-	saveRayResult<false>();
+	const RaytraceRequestContext& ctx = getRequest();
+	// In multi-return mode results are saved by __raygen__
+	if (ctx.returnCount == 1) {
+		saveRayResult<false>(0);
+	}
 }
 
-extern "C" __global__ void __anyhit__(){}
+extern "C" __global__ void __anyhit__()
+{
+	// Called only in multi-return mode
+	const RaytraceRequestContext& ctx = getRequest();
+	const TriangleMeshSBTData& sbtData = *(const TriangleMeshSBTData*) optixGetSbtDataPointer();
+	RayReturns& returns = *decodePayloadPointer<RayReturns>(optixGetPayload_3(), optixGetPayload_4());
+	returns.insert(optixGetRayTmax(),
+	               RayReturns::makePrimitiveKey(optixGetInstanceId(), optixGetPrimitiveIndex()),
+	               getHitPointInWorld(sbtData),
+	               sbtData.laser_retro,
+	               ctx.returnCount);
+	// Accepting the farthest of the collected hits shortens the ray, so that farther geometry is culled
+	bool isFarthestCollected = returns.isFull(ctx.returnCount) && returns.getFarthestDistance() == optixGetRayTmax();
+	if (!isFarthestCollected) {
+		optixIgnoreIntersection();
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <graph/BranchPlan.hpp>
+
+#include <optional>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+BranchPlan BranchPlan::build(const std::vector<std::vector<std::size_t>>& parents)
+{
+	BranchPlan plan;
+	std::size_t nodeCount = parents.size();
+	plan.branchOf.resize(nodeCount);
+	plan.waitedFor.assign(nodeCount, false);
+
+	// A node is the open end of its branch until one of its children continues that branch
+	std::vector<bool> isContinued(nodeCount, false);
+	for (std::size_t node = 0; node < nodeCount; ++node) {
+		std::optional<std::size_t> branch;
+		for (auto&& parent : parents[node]) {
+			if (parent >= node) {
+				auto msg = fmt::format("node {} precedes its parent {} in execution order", node, parent);
+				throw std::logic_error(msg);
+			}
+			if (!branch.has_value() && !isContinued[parent]) {
+				isContinued[parent] = true;
+				branch = plan.branchOf[parent];
+			}
+		}
+		if (!branch.has_value()) {
+			// Root or a fork: all parents are already continued by their other children
+			branch = plan.branches.size();
+			plan.branches.emplace_back();
+		}
+
+		Step step {.node = node};
+		for (auto&& parent : parents[node]) {
+			if (plan.branchOf[parent] != *branch) {
+				step.waitFor.push_back(parent);
+				plan.waitedFor[parent] = true;
+			}
+		}
+		plan.branchOf[node] = *branch;
+		plan.branches[*branch].push_back(std::move(step));
+	}
+	return plan;
+}
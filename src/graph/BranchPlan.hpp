@@ -0,0 +1,49 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Splits a DAG of nodes into branches - chains of nodes executed one after another in a single stream.
+ * Different branches may execute concurrently; dependencies between them exist only at fork and join points,
+ * and are listed explicitly, so that they can be enforced with events.
+ * Nodes are identified by their position in a topological order.
+ */
+struct BranchPlan
+{
+	struct Step
+	{
+		std::size_t node;
+		std::vector<std::size_t> waitFor;  // Parents executed in other branches
+	};
+
+	// Parents of each node; all of them have to precede the node.
+	static BranchPlan build(const std::vector<std::vector<std::size_t>>& parents);
+
+	std::size_t getBranchCount() const { return branches.size(); }
+	const std::vector<Step>& getBranch(std::size_t branch) const { return branches.at(branch); }
+	std::size_t getBranchOf(std::size_t node) const { return branchOf.at(node); }
+
+	// True if a node of another branch waits for the given one, so its completion has to be signaled.
+	bool isWaitedFor(std::size_t node) const { return waitedFor.at(node); }
+
+private:
+	std::vector<std::vector<Step>> branches;
+	std::vector<std::size_t> branchOf;
+	std::vector<bool> waitedFor;
+};
@@ -14,11 +14,20 @@
 
 #include <graph/Nodes.hpp>
 #include <gpu/nodeKernels.hpp>
+#include <graph/GraphProfiler.hpp>
 #include <RGLFields.hpp>
 #include <repr.hpp>
 
-// TODO: WritePCD triggers cudaSynchronizeStream in its indirect input CompactNode
-// TODO: This can be alleviated with a stream-aware VArray :)
+CompactPointsNode::~CompactPointsNode()
+{
+	// Not checked, destructors must not throw
+	if (finishedEvent != nullptr) {
+		cudaEventDestroy(finishedEvent);
+	}
+	if (width != nullptr) {
+		cudaFreeHost(width);
+	}
+}
 
 void CompactPointsNode::validate()
 {
@@ -27,42 +36,62 @@ void CompactPointsNode::validate()
 		unsigned flags = cudaEventDisableTiming;  // Provides better performance
 		CHECK_CUDA(cudaEventCreate(&finishedEvent, flags));
 	}
+	if (width == nullptr) {
+		CHECK_CUDA(cudaMallocHost(&width, sizeof(*width)));
+		*width = 0;
+	}
 }
 
 void CompactPointsNode::schedule(cudaStream_t stream)
 {
 	cacheManager.trigger();
-	inclusivePrefixSum->resize(input->getHeight() * input->getWidth(), false, false);
 	size_t pointCount = input->getWidth() * input->getHeight();
-	const auto* isHit = input->getFieldDataTyped<IS_HIT_I32>(stream)->getDevicePtr();
-	gpuFindCompaction(stream, pointCount, isHit, inclusivePrefixSum->getDevicePtr(), &width);
-	CHECK_CUDA(cudaEventRecord(finishedEvent, stream));
+	inclusivePrefixSum->resizeAsync(pointCount, stream, false, false);
+	scanStorage->resizeAsync(gpuFindCompactionStorageSize(pointCount), stream, false, false);
+	const auto* isHit = input->getFieldDataTyped<IS_HIT_I32>(stream)->getReadPtr(MemLoc::Device, stream);
+	gpuFindCompaction(stream, pointCount, isHit, inclusivePrefixSum->getWritePtr(MemLoc::Device, stream), width,
+	                  scanStorage->getWritePtr(MemLoc::Device, stream), scanStorage->getElemCount());
+	// Recorded also by replays of the CUDA graph, so that getWidth() waits for them
+	CHECK_CUDA(cudaEventRecordWithFlags(finishedEvent, stream, cudaEventRecordExternal));
 }
 
 VArray::ConstPtr CompactPointsNode::getFieldData(rgl_field_t field, cudaStream_t stream) const
 {
+	std::lock_guard lock {cacheMutex};
 	if (!cacheManager.contains(field)) {
-		auto fieldData = VArray::create(field, width);
+		auto fieldData = VArray::create(field);
 		cacheManager.insert(field, fieldData, true);
 	}
 
 	if (!cacheManager.isLatest(field)) {
+		GraphProfiler::Measurement measurement {this, RGL_PROFILE_PHASE_FIELD_DATA, stream};
 		auto fieldData = cacheManager.getValue(field);
-		fieldData->resize(width, false, false);
-		char* outPtr = static_cast<char *>(fieldData->getWritePtr(MemLoc::Device));
-		const char* inputPtr = static_cast<const char *>(input->getFieldData(field, stream)->getReadPtr(MemLoc::Device));
-		const auto* isHitPtr = input->getFieldDataTyped<IS_HIT_I32>(stream)->getDevicePtr();
-		const CompactionIndexType * indices = inclusivePrefixSum->getDevicePtr();
+		fieldData->resizeAsync(getOutputCount(stream), stream, false, false);
+		char* outPtr = static_cast<char *>(fieldData->getWritePtr(MemLoc::Device, stream));
+		const char* inputPtr = static_cast<const char *>(input->getFieldData(field, stream)->getReadPtr(MemLoc::Device, stream));
+		const auto* isHitPtr = input->getFieldDataTyped<IS_HIT_I32>(stream)->getReadPtr(MemLoc::Device, stream);
+		const CompactionIndexType * indices = inclusivePrefixSum->getReadPtr(MemLoc::Device, stream);
 		gpuApplyCompaction(stream, input->getPointCount(), getFieldSize(field), isHitPtr, indices, outPtr, inputPtr);
-		CHECK_CUDA(cudaStreamSynchronize(stream));
 		cacheManager.setUpdated(field);
 	}
 
-	return std::const_pointer_cast<const VArray>(cacheManager.getValue(field));
+	// Callers in other streams (e.g. other branches) wait for the compaction done by the first one, without blocking the host
+	auto fieldData = cacheManager.getValue(field);
+	fieldData->getReadPtr(MemLoc::Device, stream);
+	return std::const_pointer_cast<const VArray>(fieldData);
+}
+
+size_t CompactPointsNode::getOutputCount(cudaStream_t stream) const
+{
+	cudaStreamCaptureStatus captureStatus = cudaStreamCaptureStatusNone;
+	if (stream != nullptr) {
+		CHECK_CUDA(cudaStreamIsCapturing(stream, &captureStatus));
+	}
+	return captureStatus == cudaStreamCaptureStatusNone ? getWidth() : input->getPointCount();
 }
 
 size_t CompactPointsNode::getWidth() const
 {
 	CHECK_CUDA(cudaEventSynchronize(finishedEvent));
-	return width;
+	return *width;
 }
@@ -14,6 +14,7 @@
 
 #include <graph/Nodes.hpp>
 #include <gpu/nodeKernels.hpp>
+#include <graph/GraphProfiler.hpp>
 
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/impl/point_types.hpp>
@@ -81,12 +82,14 @@ size_t DownSamplePointsNode::getWidth() const
 
 VArray::ConstPtr DownSamplePointsNode::getFieldData(rgl_field_t field, cudaStream_t stream) const
 {
+	std::lock_guard lock {cacheMutex};
 	if (!cacheManager.contains(field)) {
 		auto fieldData = VArray::create(field, filteredIndices->getCount());
 		cacheManager.insert(field, fieldData, true);
 	}
 
 	if (!cacheManager.isLatest(field)) {
+		GraphProfiler::Measurement measurement {this, RGL_PROFILE_PHASE_FIELD_DATA, stream};
 		auto fieldData = cacheManager.getValue(field);
 		fieldData->resize(filteredIndices->getCount(), false, false);
 		char* outPtr = static_cast<char *>(fieldData->getWritePtr(MemLoc::Device));
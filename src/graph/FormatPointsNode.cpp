@@ -29,11 +29,26 @@ void FormatPointsNode::setParameters(const std::vector<rgl_field_t>& fields)
 void FormatPointsNode::validate()
 {
 	input = getValidInput<IPointsNode>();
+	fusedCompaction = nullptr;
 }
 
 void FormatPointsNode::schedule(cudaStream_t stream)
 {
-	formatAsync(output, input, fields, stream);
+	std::size_t pointSize = getPointSize(fields);
+	if (fusedCompaction == nullptr) {
+		formatAsync(output, input, fields, stream);
+	}
+	else {
+		// Hits are written at their compacted positions, without compacting each field first
+		IPointsNode::Ptr uncompacted = fusedCompaction->getUncompactedInput();
+		output->resizeAsync(fusedCompaction->getOutputCount(stream) * pointSize, stream, false, false);
+		auto gpuFields = makeGPUFieldDesc(uncompacted, fields, stream);
+		const auto* isHit = uncompacted->getFieldDataTyped<IS_HIT_I32>(stream)->getReadPtr(MemLoc::Device, stream);
+		char* outputPtr = static_cast<char*>(output->getWritePtr(MemLoc::Device, stream));
+		gpuFormatCompacted(stream, uncompacted->getPointCount(), pointSize, fields.size(), gpuFields->getReadPtr(MemLoc::Device, stream),
+		                   isHit, fusedCompaction->getCompactionIndices(), outputPtr);
+	}
+	resultBindings.write(RGL_FIELD_DYNAMIC_FORMAT, output, pointSize, stream);
 }
 
 void FormatPointsNode::formatAsync(const VArray::Ptr& output, const IPointsNode::Ptr& input,
@@ -41,16 +56,17 @@ void FormatPointsNode::formatAsync(const VArray::Ptr& output, const IPointsNode:
 {
 	std::size_t pointSize = getPointSize(fields);
 	std::size_t pointCount = input->getPointCount();
-	output->resize(pointCount * pointSize, false, false);
+	output->resizeAsync(pointCount * pointSize, stream, false, false);
 	auto gpuFields = makeGPUFieldDesc(input, fields, stream);
-	char* outputPtr = static_cast<char*>(output->getWritePtr(MemLoc::Device));
-	gpuFormat(stream, pointCount, pointSize, fields.size(), gpuFields->getDevicePtr(), outputPtr);
+	char* outputPtr = static_cast<char*>(output->getWritePtr(MemLoc::Device, stream));
+	gpuFormat(stream, pointCount, pointSize, fields.size(), gpuFields->getReadPtr(MemLoc::Device, stream), outputPtr);
 }
 
 VArray::ConstPtr FormatPointsNode::getFieldData(rgl_field_t field, cudaStream_t stream) const
 {
 	if (field == RGL_FIELD_DYNAMIC_FORMAT) {
-		CHECK_CUDA(cudaStreamSynchronize(stream));
+		// Callers in other streams wait for the formatting, without blocking the host
+		output->getReadPtr(MemLoc::Device, stream);
 		return output;
 	}
 	return input->getFieldData(field, stream);
@@ -65,22 +81,23 @@ std::size_t FormatPointsNode::getFieldPointSize(rgl_field_t field) const
 }
 
 // Constructor for GPUFieldDesc, implemented here to avoid polluting gpu-visible header.
+// Descriptors are uploaded in the stream, so that their (pooled) memory is released without waiting for the kernel.
 static VArrayProxy<GPUFieldDesc>::Ptr makeGPUFieldDesc(IPointsNode::Ptr input, const std::vector<rgl_field_t> &fields, cudaStream_t stream)
 {
-	auto gpuFields = VArrayProxy<GPUFieldDesc>::create(fields.size());
+	std::vector<GPUFieldDesc> hostFields;
 	std::size_t offset = 0;
-	std::size_t gpuFieldIdx = 0;
 	for (size_t i = 0; i < fields.size(); ++i) {
 		if (!isDummy(fields[i])) {
-			(*gpuFields)[gpuFieldIdx] = GPUFieldDesc {
+			hostFields.push_back(GPUFieldDesc {
 			// TODO(prybicki): distinguish between read / write fields here
-			.data = static_cast<const char*>(input->getFieldData(fields[i], stream)->getReadPtr(MemLoc::Device)),
+			.data = static_cast<const char*>(input->getFieldData(fields[i], stream)->getReadPtr(MemLoc::Device, stream)),
 			.size = getFieldSize(fields[i]),
 			.dstOffset = offset,
-			};
-			gpuFieldIdx += 1;
+			});
 		}
 		offset += getFieldSize(fields[i]);
 	}
+	auto gpuFields = VArrayProxy<GPUFieldDesc>::create(fields.size());
+	gpuFields->copyAsync(hostFields.data(), hostFields.size(), stream);
 	return gpuFields;
 }
@@ -17,6 +17,7 @@
 void FromMat3x4fRaysNode::setParameters(const Mat3x4f *raysRaw, size_t rayCount)
 {
 	rays->setData(raysRaw, rayCount);
+	markOutputChanged();
 }
 
 void FromMat3x4fRaysNode::validate()
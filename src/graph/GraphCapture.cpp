@@ -0,0 +1,115 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <graph/GraphCapture.hpp>
+#include <Logger.hpp>
+
+GraphCapture::Mode GraphCapture::decide(const State& state)
+{
+	if (!state.enabled || !state.capturable) {
+		return Mode::Eager;
+	}
+	if (state.hasRecording && state.sameNodes) {
+		return state.samePlan && state.inputsUpToDate ? Mode::Replay : Mode::Update;
+	}
+	// Nodes executed at least once have their buffers allocated, which must not happen during the capture
+	return state.eagerRunCount > 0 ? Mode::Capture : Mode::Eager;
+}
+
+void GraphCapture::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled) {
+		forgetRecording();
+	}
+}
+
+GraphCapture::Mode GraphCapture::run(const Run& run, cudaStream_t stream)
+{
+	if (run.nodes != lastNodes) {
+		lastNodes = run.nodes;
+		eagerRunCount = 0;
+	}
+	bool capturable = run.capturable && failedPlanId != run.planId;
+	bool inputsUpToDate = true;
+	if (enabled && capturable) {
+		inputsUpToDate = run.prepare();
+	}
+	Mode mode = decide({
+		.enabled = enabled,
+		.capturable = capturable,
+		.hasRecording = executor->hasExecutable(),
+		.sameNodes = recordedNodes == run.nodes,
+		.samePlan = recordedPlanId == run.planId,
+		.inputsUpToDate = inputsUpToDate,
+		.eagerRunCount = eagerRunCount,
+	});
+
+	if (mode == Mode::Eager && executor->hasExecutable() && recordedNodes != run.nodes) {
+		forgetRecording();  // Recording of other nodes will not be used anymore
+	}
+	if ((mode == Mode::Capture || mode == Mode::Update) && !record(run, stream)) {
+		mode = Mode::Eager;
+	}
+	switch (mode) {
+		case Mode::Eager:
+			run.schedule();
+			eagerRunCount += 1;
+			break;
+		case Mode::Capture:
+		case Mode::Update:
+		case Mode::Replay:
+			executor->launch(stream);
+			eagerRunCount = 0;
+			break;
+	}
+	return mode;
+}
+
+bool GraphCapture::record(const Run& run, cudaStream_t stream)
+{
+	try {
+		executor->beginCapture(stream);
+		try {
+			run.schedule();
+		}
+		catch (...) {
+			executor->abortCapture(stream);
+			throw;
+		}
+		executor->endCapture(stream);
+	}
+	catch (std::exception& e) {
+		RGL_WARN("Failed to record graph into a CUDA graph, executing it eagerly: {}", e.what());
+		// Work recorded so far is lost, as well as the previous executable graph, which may refer to freed buffers
+		forgetRecording();
+		// Failing right after an eager run means that some node is not capturable, rather than that buffers had to grow
+		if (eagerRunCount > 0) {
+			failedPlanId = run.planId;
+		}
+		eagerRunCount = 0;
+		return false;
+	}
+	recordedPlanId = run.planId;
+	recordedNodes = run.nodes;
+	return true;
+}
+
+void GraphCapture::forgetRecording()
+{
+	executor->reset();
+	recordedPlanId.reset();
+	recordedNodes.clear();
+}
@@ -0,0 +1,89 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <graph/GraphExecutor.hpp>
+
+/**
+ * Replays steady-state graphs from a CUDA graph instead of scheduling their nodes one by one.
+ * Each run is executed in one of the modes below:
+ * - Eager: nodes are scheduled as usual; always the case for disabled capture or graphs with nodes that are not capturable.
+ * - Capture: scheduling is recorded into a new CUDA graph, which is then launched; done on the second run of given nodes,
+ *   so that buffers have already been allocated by the first, eager one.
+ * - Update: as above, but the recording updates the existing executable graph (e.g. after a change of node parameters or scene).
+ * - Replay: nodes are not scheduled, the executable graph is launched instead.
+ * If recording fails (e.g. a buffer has to grow, which synchronizes the device), the run falls back to eager execution
+ * and the next one records again. Plans failing to record right after an eager run are executed eagerly until they change.
+ */
+struct GraphCapture
+{
+	enum class Mode
+	{
+		Eager,
+		Capture,
+		Update,
+		Replay,
+	};
+
+	struct State
+	{
+		bool enabled;
+		bool capturable;            // All nodes are capturable and recording the plan has not failed repeatedly
+		bool hasRecording;          // Executable graph exists
+		bool sameNodes;             // Recording has been made for the same nodes, in the same order
+		bool samePlan;              // Recording has been made for the same plan, i.e. nodes did not change parameters since
+		bool inputsUpToDate;        // External state used by the recording (e.g. scene) did not change since
+		std::size_t eagerRunCount;  // Consecutive eager runs of the same nodes
+	};
+
+	// Describes the graph to be run
+	struct Run
+	{
+		std::size_t planId;                // Changes whenever the graph changes, including node parameters
+		std::vector<const void*> nodes;    // Nodes in execution order
+		bool capturable;                   // All nodes are capturable
+		std::function<bool()> prepare;     // Updates external state outside the capture; returns false if it changed since the last run
+		std::function<void()> schedule;    // Schedules all nodes; work must be enqueued in (or joined to) the stream passed to run()
+	};
+
+	static Mode decide(const State& state);
+
+	explicit GraphCapture(GraphExecutor::Ptr executor) : executor(std::move(executor)) {}
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return enabled; }
+
+	// Executes the run in the given stream; returns the mode it has been executed in.
+	Mode run(const Run& run, cudaStream_t stream);
+
+private:
+	bool record(const Run& run, cudaStream_t stream);
+	void forgetRecording();
+
+private:
+	GraphExecutor::Ptr executor;
+	bool enabled {false};
+	std::optional<std::size_t> recordedPlanId;
+	std::vector<const void*> recordedNodes;
+	std::optional<std::size_t> failedPlanId;  // Plan which failed to record right after an eager run
+	std::vector<const void*> lastNodes;
+	std::size_t eagerRunCount {0};
+};
@@ -0,0 +1,86 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <graph/GraphExecutor.hpp>
+#include <macros/cuda.hpp>
+#include <Logger.hpp>
+
+CudaGraphExecutor::~CudaGraphExecutor()
+{
+	if (executable != nullptr) {
+		cudaGraphExecDestroy(executable);
+	}
+}
+
+void CudaGraphExecutor::beginCapture(cudaStream_t stream)
+{
+	// Relaxed mode, since other threads (API, other graphs) keep using CUDA during the capture
+	CHECK_CUDA(cudaStreamBeginCapture(stream, cudaStreamCaptureModeRelaxed));
+}
+
+void CudaGraphExecutor::endCapture(cudaStream_t stream)
+{
+	cudaGraph_t graph = nullptr;
+	CHECK_CUDA(cudaStreamEndCapture(stream, &graph));
+	if (executable != nullptr) {
+		// Cheap compared to instantiation; succeeds if only parameters of the recorded work have changed
+#if CUDART_VERSION >= 12000
+		cudaGraphExecUpdateResultInfo updateInfo;
+		cudaError_t updateStatus = cudaGraphExecUpdate(executable, graph, &updateInfo);
+		cudaGraphExecUpdateResult updateResult = updateInfo.result;
+#else
+		cudaGraphNode_t errorNode = nullptr;
+		cudaGraphExecUpdateResult updateResult;
+		cudaError_t updateStatus = cudaGraphExecUpdate(executable, graph, &errorNode, &updateResult);
+#endif
+		if (updateStatus == cudaSuccess) {
+			CHECK_CUDA(cudaGraphDestroy(graph));
+			return;
+		}
+		cudaGetLastError();  // Clear the error of the failed update
+		RGL_DEBUG("CUDA graph cannot be updated in place (result {}), instantiating it anew", static_cast<int>(updateResult));
+		reset();
+	}
+#if CUDART_VERSION >= 12000
+	cudaError_t status = cudaGraphInstantiate(&executable, graph, 0);
+#else
+	cudaError_t status = cudaGraphInstantiate(&executable, graph, nullptr, nullptr, 0);
+#endif
+	cudaGraphDestroy(graph);
+	CHECK_CUDA(status);
+}
+
+void CudaGraphExecutor::abortCapture(cudaStream_t stream)
+{
+	cudaGraph_t graph = nullptr;
+	// Fails if the capture has been invalidated, which is likely the reason of aborting it
+	if (cudaStreamEndCapture(stream, &graph) == cudaSuccess && graph != nullptr) {
+		cudaGraphDestroy(graph);
+	}
+	cudaGetLastError();
+}
+
+void CudaGraphExecutor::launch(cudaStream_t stream)
+{
+	CHECK_CUDA(cudaGraphLaunch(executable, stream));
+}
+
+void CudaGraphExecutor::reset()
+{
+	if (executable != nullptr) {
+		CHECK_CUDA(cudaGraphExecDestroy(executable));
+		executable = nullptr;
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <memory>
+
+#include <cuda_runtime_api.h>
+
+/**
+ * Records work enqueued in a stream into a CUDA graph and launches it.
+ * Abstracts CUDA graph API away from GraphCapture, so that its decisions can be tested with a mock.
+ */
+struct GraphExecutor
+{
+	using Ptr = std::unique_ptr<GraphExecutor>;
+	virtual ~GraphExecutor() = default;
+
+	// Starts recording work enqueued in the stream and in the streams joined to it with events.
+	virtual void beginCapture(cudaStream_t stream) = 0;
+
+	// Ends the recording; the executable graph is updated with it in place if topology allows, otherwise instantiated anew.
+	virtual void endCapture(cudaStream_t stream) = 0;
+
+	// Ends the recording after a failure, discarding recorded work.
+	virtual void abortCapture(cudaStream_t stream) = 0;
+
+	virtual void launch(cudaStream_t stream) = 0;
+
+	virtual bool hasExecutable() const = 0;
+
+	// Releases the executable graph.
+	virtual void reset() = 0;
+};
+
+struct CudaGraphExecutor : GraphExecutor
+{
+	~CudaGraphExecutor() override;
+
+	void beginCapture(cudaStream_t stream) override;
+	void endCapture(cudaStream_t stream) override;
+	void abortCapture(cudaStream_t stream) override;
+	void launch(cudaStream_t stream) override;
+	bool hasExecutable() const override { return executable != nullptr; }
+	void reset() override;
+
+private:
+	cudaGraphExec_t executable {nullptr};
+};
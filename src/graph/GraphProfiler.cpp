@@ -0,0 +1,276 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include <graph/GraphProfiler.hpp>
+#include <graph/Node.hpp>
+#include <macros/cuda.hpp>
+#include <RGLExceptions.hpp>
+#include <Logger.hpp>
+
+thread_local GraphProfiler* GraphProfiler::active = nullptr;
+
+GraphProfiler::Activation::Activation(GraphProfiler* profiler) : previous(active)
+{
+	active = profiler;
+}
+
+GraphProfiler::Activation::~Activation()
+{
+	active = previous;
+}
+
+GraphProfiler::Measurement::Measurement(const Node* node, rgl_profile_phase_t phase, cudaStream_t stream)
+: profiler(active), node(node), phase(phase), stream(stream)
+{
+	if (profiler == nullptr) {
+		return;
+	}
+	begin = profiler->acquireEvent();
+	CHECK_CUDA(cudaEventRecord(begin, stream));
+	hostBeginMs = profiler->nowMs();
+}
+
+GraphProfiler::Measurement::~Measurement()
+{
+	if (profiler == nullptr) {
+		return;
+	}
+	double hostEndMs = profiler->nowMs();
+	cudaEvent_t end = profiler->acquireEvent();
+	profiler->record({
+		.node = node,
+		.phase = phase,
+		.hostBeginMs = hostBeginMs,
+		.hostDurationMs = hostEndMs - hostBeginMs,
+		.begin = begin,
+		.end = end,
+	}, stream);
+}
+
+GraphProfiler::GraphProfiler() = default;
+
+GraphProfiler::~GraphProfiler()
+{
+	if (currentFrame.has_value()) {
+		pendingFrames.push_back(std::move(*currentFrame));
+	}
+	for (auto&& frame : pendingFrames) {
+		releaseFrame(frame);
+	}
+	for (auto&& event : freeEvents) {
+		cudaEventDestroy(event);
+	}
+}
+
+void GraphProfiler::configure(bool enabled, std::size_t windowSize)
+{
+	std::lock_guard lock {mutex};
+	for (auto&& frame : pendingFrames) {
+		releaseFrame(frame);
+	}
+	pendingFrames.clear();
+	series.clear();
+	this->enabled = enabled;
+	this->windowSize = windowSize;
+}
+
+void GraphProfiler::beginFrame(int64_t frameId, cudaStream_t stream)
+{
+	if (!enabled) {
+		return;
+	}
+	cudaEvent_t begin = acquireEvent();
+	CHECK_CUDA(cudaEventRecord(begin, stream));
+	std::lock_guard lock {mutex};
+	currentFrame = PendingFrame {.id = frameId, .hostBeginMs = nowMs(), .begin = begin};
+}
+
+void GraphProfiler::endFrame()
+{
+	std::lock_guard lock {mutex};
+	if (currentFrame.has_value()) {
+		pendingFrames.push_back(std::move(*currentFrame));
+		currentFrame.reset();
+	}
+}
+
+void GraphProfiler::collect()
+{
+	std::lock_guard lock {mutex};
+	while (!pendingFrames.empty() && isFinished(pendingFrames.front())) {
+		PendingFrame& frame = pendingFrames.front();
+		for (auto&& measurement : frame.measurements) {
+			float gpuOffsetMs = 0.0f, gpuDurationMs = 0.0f;
+			CHECK_CUDA(cudaEventElapsedTime(&gpuOffsetMs, frame.begin, measurement.begin));
+			CHECK_CUDA(cudaEventElapsedTime(&gpuDurationMs, measurement.begin, measurement.end));
+			Series& nodeSeries = series[{measurement.node, measurement.phase}];
+			nodeSeries.samples.push_back({
+				.frameId = frame.id,
+				.hostBeginMs = measurement.hostBeginMs,
+				.hostDurationMs = measurement.hostDurationMs,
+				.gpuBeginMs = frame.hostBeginMs + gpuOffsetMs,
+				.gpuDurationMs = gpuDurationMs,
+				.hostLane = measurement.hostLane,
+				.gpuLane = measurement.gpuLane,
+			});
+			while (nodeSeries.samples.size() > windowSize) {
+				nodeSeries.samples.pop_front();
+			}
+		}
+		releaseFrame(frame);
+		pendingFrames.pop_front();
+	}
+}
+
+std::vector<GraphProfiler::Profile> GraphProfiler::getProfiles()
+{
+	collect();
+	std::lock_guard lock {mutex};
+	std::vector<Profile> profiles;
+	for (auto&& [key, nodeSeries] : series) {
+		std::vector<double> hostDurations, gpuDurations;
+		for (auto&& sample : nodeSeries.samples) {
+			hostDurations.push_back(sample.hostDurationMs);
+			gpuDurations.push_back(sample.gpuDurationMs);
+		}
+		profiles.push_back({
+			.node = key.first,
+			.phase = key.second,
+			.host = computeStats(std::move(hostDurations)),
+			.gpu = computeStats(std::move(gpuDurations)),
+		});
+	}
+	return profiles;
+}
+
+void GraphProfiler::writeChromeTrace(const std::filesystem::path& path)
+{
+	collect();
+	std::ofstream file {path};
+	if (!file.is_open()) {
+		throw InvalidFilePath(fmt::format("could not open profile trace file '{}' for writing", path.string()));
+	}
+
+	// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU (Trace Event Format)
+	static constexpr int HOST_PID = 0;
+	static constexpr int GPU_PID = 1;
+	std::lock_guard lock {mutex};
+	std::vector<std::string> events = {
+		fmt::format(R"({{"name": "process_name", "ph": "M", "pid": {}, "args": {{"name": "Host"}}}})", HOST_PID),
+		fmt::format(R"({{"name": "process_name", "ph": "M", "pid": {}, "args": {{"name": "GPU"}}}})", GPU_PID),
+	};
+	for (auto&& [key, nodeSeries] : series) {
+		for (auto&& sample : nodeSeries.samples) {
+			auto makeEvent = [&](int pid, int lane, double beginMs, double durationMs) {
+				return fmt::format(R"({{"name": "{}", "ph": "X", "pid": {}, "tid": {}, "ts": {:.3f}, "dur": {:.3f}, "args": {{"frame": {}}}}})",
+				                   nodeSeries.name, pid, lane, beginMs * 1000.0, durationMs * 1000.0, sample.frameId);
+			};
+			events.push_back(makeEvent(HOST_PID, sample.hostLane, sample.hostBeginMs, sample.hostDurationMs));
+			events.push_back(makeEvent(GPU_PID, sample.gpuLane, sample.gpuBeginMs, sample.gpuDurationMs));
+		}
+	}
+	file << "{\"traceEvents\": [\n";
+	for (std::size_t i = 0; i < events.size(); ++i) {
+		file << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+	}
+	file << "]}\n";
+}
+
+GraphProfiler::Stats GraphProfiler::computeStats(std::vector<double> durationsMs)
+{
+	if (durationsMs.empty()) {
+		return {};
+	}
+	std::sort(durationsMs.begin(), durationsMs.end());
+	double sum = 0.0;
+	for (auto&& duration : durationsMs) {
+		sum += duration;
+	}
+	auto p99Rank = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(durationsMs.size())));
+	return {
+		.sampleCount = durationsMs.size(),
+		.minMs = durationsMs.front(),
+		.avgMs = sum / static_cast<double>(durationsMs.size()),
+		.p99Ms = durationsMs[p99Rank - 1],
+	};
+}
+
+double GraphProfiler::nowMs() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+cudaEvent_t GraphProfiler::acquireEvent()
+{
+	{
+		std::lock_guard lock {mutex};
+		if (!freeEvents.empty()) {
+			cudaEvent_t event = freeEvents.back();
+			freeEvents.pop_back();
+			return event;
+		}
+	}
+	cudaEvent_t event = nullptr;
+	CHECK_CUDA(cudaEventCreate(&event));  // Timing has to be enabled
+	return event;
+}
+
+void GraphProfiler::record(PendingMeasurement measurement, cudaStream_t stream)
+{
+	// Called from a destructor, hence errors are not thrown; they are reported by the stream anyway
+	if (cudaEventRecord(measurement.end, stream) != cudaSuccess) {
+		RGL_WARN("Profiler failed to record event of node {}", measurement.node->getName());
+	}
+	std::lock_guard lock {mutex};
+	if (!currentFrame.has_value()) {
+		freeEvents.push_back(measurement.begin);
+		freeEvents.push_back(measurement.end);
+		return;
+	}
+	measurement.hostLane = hostLanes.try_emplace(std::this_thread::get_id(), static_cast<int>(hostLanes.size())).first->second;
+	measurement.gpuLane = gpuLanes.try_emplace(stream, static_cast<int>(gpuLanes.size())).first->second;
+	auto [nodeSeries, isNew] = series.try_emplace({measurement.node, measurement.phase});
+	if (isNew) {
+		std::string name = measurement.node->getName();
+		nodeSeries->second.name = measurement.phase == RGL_PROFILE_PHASE_SCHEDULE ? name : fmt::format("{}::getFieldData", name);
+	}
+	currentFrame->measurements.push_back(measurement);
+}
+
+bool GraphProfiler::isFinished(const PendingFrame& frame) const
+{
+	for (auto&& measurement : frame.measurements) {
+		cudaError_t status = cudaEventQuery(measurement.end);
+		if (status == cudaErrorNotReady) {
+			return false;
+		}
+		CHECK_CUDA(status);
+	}
+	return true;
+}
+
+void GraphProfiler::releaseFrame(PendingFrame& frame)
+{
+	freeEvents.push_back(frame.begin);
+	for (auto&& measurement : frame.measurements) {
+		freeEvents.push_back(measurement.begin);
+		freeEvents.push_back(measurement.end);
+	}
+	frame.measurements.clear();
+}
@@ -0,0 +1,169 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include <rgl/api/core.h>
+
+struct Node;
+
+/**
+ * Measures host and GPU time of scheduling nodes of a single graph, and of lazy computations in their getFieldData().
+ * Host time is wall time of the call. GPU time is measured between events recorded in the node's stream around the call,
+ * hence it does not include waiting for its parents, but it does include gaps caused by host synchronization within the call.
+ * GPU times are read once the frame is finished (see collect()). Statistics are computed over a sliding window
+ * of the last samples of each node and phase; the same samples can be dumped in Chrome trace format.
+ * Measurements are made by the threads scheduling the graph, which activate the profiler (see Activation).
+ */
+struct GraphProfiler
+{
+	struct Stats
+	{
+		std::size_t sampleCount {0};
+		double minMs {0.0};
+		double avgMs {0.0};
+		double p99Ms {0.0};  // Nearest-rank percentile
+	};
+
+	struct Profile
+	{
+		const Node* node;
+		rgl_profile_phase_t phase;
+		Stats host;
+		Stats gpu;
+	};
+
+	// Makes the profiler (or none, if nullptr) active on the calling thread for the lifetime of the object.
+	struct Activation
+	{
+		explicit Activation(GraphProfiler* profiler);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+
+	private:
+		GraphProfiler* previous;
+	};
+
+	// Measures its lifetime with the profiler active on the calling thread; no-op if there is none.
+	struct Measurement
+	{
+		Measurement(const Node* node, rgl_profile_phase_t phase, cudaStream_t stream);
+		~Measurement();
+		Measurement(const Measurement&) = delete;
+		Measurement& operator=(const Measurement&) = delete;
+
+	private:
+		GraphProfiler* profiler;
+		const Node* node;
+		rgl_profile_phase_t phase;
+		cudaStream_t stream;
+		double hostBeginMs {0.0};
+		cudaEvent_t begin {nullptr};
+	};
+
+	GraphProfiler();
+	~GraphProfiler();
+	GraphProfiler(const GraphProfiler&) = delete;
+	GraphProfiler& operator=(const GraphProfiler&) = delete;
+
+	// Must not be called while the graph is running; discards collected samples.
+	void configure(bool enabled, std::size_t windowSize);
+	bool isEnabled() const { return enabled; }
+
+	// Called by the runner around scheduling of each frame.
+	void beginFrame(int64_t frameId, cudaStream_t stream);
+	void endFrame();
+
+	// Reads GPU times of finished frames, in order; stops at the first one still in flight.
+	void collect();
+
+	std::vector<Profile> getProfiles();
+	void writeChromeTrace(const std::filesystem::path& path);
+
+	static Stats computeStats(std::vector<double> durationsMs);
+
+private:
+	struct Sample
+	{
+		int64_t frameId;
+		double hostBeginMs;
+		double hostDurationMs;
+		double gpuBeginMs;  // Relative to the host timeline, assuming the frame started on the GPU as it was scheduled
+		double gpuDurationMs;
+		int hostLane;
+		int gpuLane;
+	};
+
+	struct PendingMeasurement
+	{
+		const Node* node;
+		rgl_profile_phase_t phase;
+		double hostBeginMs;
+		double hostDurationMs;
+		int hostLane;
+		int gpuLane;
+		cudaEvent_t begin;
+		cudaEvent_t end;
+	};
+
+	struct PendingFrame
+	{
+		int64_t id;
+		double hostBeginMs;
+		cudaEvent_t begin;
+		std::vector<PendingMeasurement> measurements;
+	};
+
+	struct Series
+	{
+		std::string name;
+		std::deque<Sample> samples;
+	};
+
+	double nowMs() const;
+	cudaEvent_t acquireEvent();
+	void record(PendingMeasurement measurement, cudaStream_t stream);
+	bool isFinished(const PendingFrame& frame) const;
+	void releaseFrame(PendingFrame& frame);
+
+private:
+	bool enabled {false};
+	std::size_t windowSize {0};
+	const std::chrono::steady_clock::time_point epoch {std::chrono::steady_clock::now()};
+
+	std::mutex mutex;  // Measurements are made by threads of all branches
+	std::vector<cudaEvent_t> freeEvents;
+	std::optional<PendingFrame> currentFrame;
+	std::deque<PendingFrame> pendingFrames;
+	std::map<std::pair<const Node*, rgl_profile_phase_t>, Series> series;
+	std::map<std::thread::id, int> hostLanes;
+	std::map<cudaStream_t, int> gpuLanes;
+
+	static thread_local GraphProfiler* active;
+};
@@ -0,0 +1,379 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <graph/GraphRunner.hpp>
+#include <graph/graph.hpp>
+#include <graph/Nodes.hpp>
+#include <scene/Scene.hpp>
+#include <macros/cuda.hpp>
+#include <Logger.hpp>
+#include <ThreadPool.hpp>
+
+// Progress of a single run, shared by threads executing its branches
+struct GraphRunner::RunState
+{
+	explicit RunState(std::size_t nodeCount) : isNodeScheduled(nodeCount, false) {}
+
+	std::mutex mutex;
+	std::condition_variable progress;
+	std::vector<bool> isNodeScheduled;
+	std::size_t finishedBranchCount {0};
+	std::exception_ptr error;
+};
+
+std::mutex GraphRunner::registryMutex;
+std::set<GraphRunner*> GraphRunner::registry;
+std::atomic<std::size_t> GraphRunner::totalRunCount {0};
+std::mutex GraphRunner::streamPoolMutex;
+std::vector<cudaStream_t> GraphRunner::idleStreams;
+std::vector<cudaStream_t> GraphRunner::idleReadbackStreams;
+
+GraphRunner::GraphRunner()
+{
+	reserveBranchResources(1, 0);
+	CHECK_CUDA(cudaEventCreateWithFlags(&forkEvent, cudaEventDisableTiming));
+	CHECK_CUDA(cudaEventCreateWithFlags(&finishedEvent, cudaEventDisableTiming));
+	// Unlike the streams executing the graph, it is not synchronized with the legacy default stream
+	readbackStream = acquireStream(cudaStreamNonBlocking);
+	for (int slot = 0; slot < MAX_PIPELINE_DEPTH; ++slot) {
+		cudaEvent_t event = nullptr;
+		CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+		frameFinishedEvents.push_back(event);
+	}
+	worker = std::thread(&GraphRunner::workerLoop, this);
+	std::lock_guard registryLock {registryMutex};
+	registry.insert(this);
+}
+
+GraphRunner::~GraphRunner()
+{
+	{
+		std::lock_guard registryLock {registryMutex};
+		registry.erase(this);
+	}
+	{
+		std::lock_guard lock {mutex};
+		quit = true;
+	}
+	stateChanged.notify_all();
+	worker.join();
+	for (auto&& stream : streams) {
+		releaseStream(stream, cudaStreamDefault);
+	}
+	releaseStream(readbackStream, cudaStreamNonBlocking);
+	cudaEventDestroy(finishedEvent);
+	for (auto&& event : frameFinishedEvents) {
+		cudaEventDestroy(event);
+	}
+	cudaEventDestroy(forkEvent);
+	for (auto&& event : nodeFinishedEvents) {
+		cudaEventDestroy(event);
+	}
+	for (auto&& event : branchFinishedEvents) {
+		cudaEventDestroy(event);
+	}
+}
+
+cudaStream_t GraphRunner::acquireStream(unsigned flags)
+{
+	{
+		std::lock_guard poolLock {streamPoolMutex};
+		auto& idle = flags == cudaStreamNonBlocking ? idleReadbackStreams : idleStreams;
+		if (!idle.empty()) {
+			cudaStream_t stream = idle.back();
+			idle.pop_back();
+			return stream;
+		}
+	}
+	cudaStream_t stream = nullptr;
+	CHECK_CUDA(cudaStreamCreateWithFlags(&stream, flags));
+	return stream;
+}
+
+void GraphRunner::releaseStream(cudaStream_t stream, unsigned flags)
+{
+	// Work of the stream is finished, so neither scenes nor later users of the stream have to wait for it
+	cudaStreamSynchronize(stream);
+	Scene::forgetStream(stream);
+	std::lock_guard poolLock {streamPoolMutex};
+	auto& idle = flags == cudaStreamNonBlocking ? idleReadbackStreams : idleStreams;
+	idle.push_back(stream);
+}
+
+int64_t GraphRunner::run(std::shared_ptr<ExecutionPlan> plan)
+{
+	std::unique_lock lock {mutex};
+	waitForScheduling(lock);
+	if (pipelineDepth == 1) {
+		CHECK_CUDA(cudaEventSynchronize(finishedEvent));
+	}
+	else if (nextFrameId - pipelineDepth >= firstFrameOfDepth) {
+		// The new frame reuses resources of the frame depth runs ago
+		CHECK_CUDA(cudaEventSynchronize(frameFinishedEvents[(nextFrameId - pipelineDepth) % pipelineDepth]));
+	}
+	profiler.collect();
+	pendingPlan = std::move(plan);
+	pendingFrameId = nextFrameId++;
+	totalRunCount += 1;
+	busy = true;
+	lock.unlock();
+	stateChanged.notify_all();
+	return pendingFrameId;
+}
+
+void GraphRunner::wait()
+{
+	std::unique_lock lock {mutex};
+	waitForScheduling(lock);
+	CHECK_CUDA(cudaEventSynchronize(finishedEvent));
+}
+
+void GraphRunner::waitForScheduling()
+{
+	std::unique_lock lock {mutex};
+	waitForScheduling(lock);
+}
+
+void GraphRunner::waitForScheduling(std::unique_lock<std::mutex>& lock)
+{
+	stateChanged.wait(lock, [this]() { return !busy; });
+	if (error != nullptr) {
+		std::exception_ptr runError = error;
+		error = nullptr;
+		std::rethrow_exception(runError);
+	}
+}
+
+void GraphRunner::setPipelineDepth(int depth)
+{
+	if (depth < 1 || depth > MAX_PIPELINE_DEPTH) {
+		throw std::invalid_argument(fmt::format("pipeline depth must be in range [1, {}], got {}", MAX_PIPELINE_DEPTH, depth));
+	}
+	wait();
+	std::lock_guard lock {mutex};
+	pipelineDepth = depth;
+	firstFrameOfDepth = nextFrameId;
+}
+
+int64_t GraphRunner::getLastFrameId() const
+{
+	std::lock_guard lock {mutex};
+	return nextFrameId - 1;
+}
+
+void GraphRunner::waitForFrame(int64_t frameId)
+{
+	std::unique_lock lock {mutex};
+	if (frameId >= nextFrameId) {
+		throw std::invalid_argument(fmt::format("frame {} has not been run yet", frameId));
+	}
+	if (frameId < firstFrameOfDepth) {
+		throw std::invalid_argument(fmt::format("results of frame {} were discarded by change of pipeline depth", frameId));
+	}
+	if (frameId + pipelineDepth < nextFrameId) {
+		throw std::invalid_argument(fmt::format("results of frame {} were overwritten by frame {}", frameId, frameId + pipelineDepth));
+	}
+	if (frameId == pendingFrameId) {
+		waitForScheduling(lock);
+	}
+	CHECK_CUDA(cudaEventSynchronize(frameFinishedEvents[frameId % pipelineDepth]));
+}
+
+bool GraphRunner::isDone()
+{
+	std::lock_guard lock {mutex};
+	if (busy) {
+		return false;
+	}
+	cudaError_t status = cudaEventQuery(finishedEvent);
+	if (status == cudaErrorNotReady) {
+		return false;
+	}
+	CHECK_CUDA(status);
+	return true;
+}
+
+void GraphRunner::waitForAll()
+{
+	std::lock_guard registryLock {registryMutex};
+	for (auto&& runner : registry) {
+		// Errors are left to be reported to the owner of the graph
+		std::unique_lock lock {runner->mutex};
+		runner->stateChanged.wait(lock, [runner]() { return !runner->busy; });
+		CHECK_CUDA(cudaEventSynchronize(runner->finishedEvent));
+	}
+}
+
+void GraphRunner::workerLoop()
+{
+	std::unique_lock lock {mutex};
+	while (true) {
+		stateChanged.wait(lock, [this]() { return busy || quit; });
+		if (quit) {
+			return;
+		}
+		std::shared_ptr<ExecutionPlan> plan = std::move(pendingPlan);
+		int64_t frameId = pendingFrameId;
+		lock.unlock();
+		std::exception_ptr runError = nullptr;
+		try {
+			execute(*plan, frameId);
+		}
+		catch (...) {
+			runError = std::current_exception();
+		}
+		profiler.endFrame();
+		// Plan must not outlive the API call destroying the graph, which waits for this run
+		plan.reset();
+		lock.lock();
+		error = runError;
+		busy = false;
+		stateChanged.notify_all();
+	}
+}
+
+void GraphRunner::execute(const ExecutionPlan& plan, int64_t frameId)
+{
+	reserveBranchResources(plan.branchPlan.getBranchCount(), plan.nodesInExecOrder.size());
+	for (auto&& node : plan.nodesInExecOrder) {
+		if (auto yieldNode = std::dynamic_pointer_cast<YieldPointsNode>(node)) {
+			yieldNode->setFrame(frameId, pipelineDepth);
+		}
+	}
+
+	profiler.beginFrame(frameId, streams[0]);
+	memoryTracker->beginFrame();
+	std::vector<const void*> nodes;
+	bool capturable = !profiler.isEnabled();  // Measurements are made while scheduling
+	for (auto&& node : plan.nodesInExecOrder) {
+		nodes.push_back(node.get());
+		capturable = capturable && node->isCapturable();
+	}
+	auto prepare = [&]() {
+		bool upToDate = true;
+		for (auto&& node : plan.nodesInExecOrder) {
+			upToDate = node->prepareCapture(streams[0]) && upToDate;
+		}
+		return upToDate;
+	};
+	GraphCapture::Mode mode = capture.run({
+		.planId = plan.id,
+		.nodes = nodes,
+		.capturable = capturable,
+		.prepare = prepare,
+		.schedule = [&]() { scheduleNodes(plan); },
+	}, streams[0]);
+	RGL_DEBUG("Frame {} executed in mode {}", frameId, static_cast<int>(mode));
+	CHECK_CUDA(cudaEventRecord(frameFinishedEvents[frameId % pipelineDepth], streams[0]));
+	CHECK_CUDA(cudaEventRecord(finishedEvent, streams[0]));
+}
+
+void GraphRunner::scheduleNodes(const ExecutionPlan& plan)
+{
+	std::size_t branchCount = plan.branchPlan.getBranchCount();
+
+	// Branches start after the work preceding the run in the main stream, which also joins them to its capture
+	CHECK_CUDA(cudaEventRecord(forkEvent, streams[0]));
+	for (std::size_t branch = 1; branch < branchCount; ++branch) {
+		CHECK_CUDA(cudaStreamWaitEvent(streams[branch], forkEvent));
+	}
+
+	RunState state {plan.nodesInExecOrder.size()};
+	for (std::size_t branch = 1; branch < branchCount; ++branch) {
+		ThreadPool::instance().enqueue([this, &plan, &state, branch]() { executeBranch(plan, branch, state); });
+	}
+	executeBranch(plan, 0, state);
+	{
+		// State must outlive all branches
+		std::unique_lock lock {state.mutex};
+		state.progress.wait(lock, [&]() { return state.finishedBranchCount == branchCount; });
+	}
+	if (state.error != nullptr) {
+		std::rethrow_exception(state.error);
+	}
+	RGL_DEBUG("Node scheduling done");  // This also logs the time diff for the last one
+
+	// Join all branches in the main stream
+	for (std::size_t branch = 1; branch < branchCount; ++branch) {
+		CHECK_CUDA(cudaEventRecord(branchFinishedEvents[branch], streams[branch]));
+		CHECK_CUDA(cudaStreamWaitEvent(streams[0], branchFinishedEvents[branch]));
+	}
+}
+
+void GraphRunner::executeBranch(const ExecutionPlan& plan, std::size_t branch, RunState& state)
+{
+	cudaStream_t stream = streams[branch];
+	GraphProfiler::Activation profiling {profiler.isEnabled() ? &profiler : nullptr};
+	MemoryTracker::Activation memoryTracking {memoryTracker.get()};
+	try {
+		bool otherBranchFailed = false;
+		for (auto&& step : plan.branchPlan.getBranch(branch)) {
+			for (auto&& parent : step.waitFor) {
+				{
+					std::unique_lock lock {state.mutex};
+					state.progress.wait(lock, [&]() { return state.isNodeScheduled[parent] || state.error != nullptr; });
+					otherBranchFailed = state.error != nullptr;
+				}
+				if (otherBranchFailed) {
+					break;
+				}
+				CHECK_CUDA(cudaStreamWaitEvent(stream, nodeFinishedEvents[parent]));
+			}
+			if (otherBranchFailed) {
+				break;  // The rest of the graph is not executed
+			}
+			const Node::Ptr& node = plan.nodesInExecOrder[step.node];
+			RGL_DEBUG("Scheduling node: {} (branch {})", *node, branch);
+			{
+				GraphProfiler::Measurement measurement {node.get(), RGL_PROFILE_PHASE_SCHEDULE, stream};
+				node->schedule(stream);
+			}
+			if (!node->tracksOutputGeneration()) {
+				node->markOutputChanged();
+			}
+			if (plan.branchPlan.isWaitedFor(step.node)) {
+				CHECK_CUDA(cudaEventRecord(nodeFinishedEvents[step.node], stream));
+			}
+			std::lock_guard lock {state.mutex};
+			state.isNodeScheduled[step.node] = true;
+			state.progress.notify_all();
+		}
+	}
+	catch (...) {
+		std::lock_guard lock {state.mutex};
+		if (state.error == nullptr) {
+			state.error = std::current_exception();
+		}
+	}
+	std::lock_guard lock {state.mutex};
+	state.finishedBranchCount += 1;
+	state.progress.notify_all();
+}
+
+void GraphRunner::reserveBranchResources(std::size_t branchCount, std::size_t nodeCount)
+{
+	while (streams.size() < branchCount) {
+		// Blocking streams, so that work enqueued in the legacy default stream (e.g. scene updates) is ordered with graph execution
+		streams.push_back(acquireStream(cudaStreamDefault));
+		cudaEvent_t event = nullptr;
+		CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+		branchFinishedEvents.push_back(event);
+	}
+	while (nodeFinishedEvents.size() < nodeCount) {
+		cudaEvent_t event = nullptr;
+		CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+		nodeFinishedEvents.push_back(event);
+	}
+}
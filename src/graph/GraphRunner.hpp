@@ -0,0 +1,147 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include <graph/GraphCapture.hpp>
+#include <graph/GraphProfiler.hpp>
+#include <MemoryTracker.hpp>
+
+struct ExecutionPlan;
+
+/**
+ * Executes a graph asynchronously to the API caller.
+ * Nodes are scheduled by a worker thread into streams owned by the runner; rgl_graph_run returns immediately.
+ * The first branch of the graph (see BranchPlan) is executed by the worker thread in the main stream,
+ * other branches by the ThreadPool, each in its own stream. Streams are synchronized with events at fork and join points.
+ * Each graph has its own runner, so that different graphs execute concurrently.
+ * If enabled, steady-state runs are replayed from a CUDA graph instead (see GraphCapture).
+ * If enabled, scheduling of each node is measured by the GraphProfiler; profiled runs are not replayed.
+ * Arrays resized while scheduling nodes are accounted by the runner's MemoryTracker, which also counts frames for their shrinking.
+ * Any API call reading or modifying state used by a running graph has to wait() for it first;
+ * scenes, meshes and entities are locked instead (see Scene).
+ *
+ * Runs are numbered frames. With pipeline depth above one, run() does not wait for the GPU part of the previous frames,
+ * only for the frame whose resources the new one reuses, so that up to depth frames are in flight.
+ * GPU work of consecutive frames stays ordered; host scheduling of the next frame and readback of the previous ones overlap it.
+ * Results of frames in flight are kept by YieldPointsNodes in rings of depth slots, see waitForFrame().
+ */
+struct GraphRunner
+{
+	using Ptr = std::shared_ptr<GraphRunner>;
+	static constexpr int MAX_PIPELINE_DEPTH = 3;
+
+	GraphRunner();
+	~GraphRunner();
+	GraphRunner(const GraphRunner&) = delete;
+	GraphRunner& operator=(const GraphRunner&) = delete;
+
+	// Waits for the previous run (or the frame pipeline depth runs ago) and starts scheduling nodes of the plan.
+	// Returns id of the started frame.
+	int64_t run(std::shared_ptr<ExecutionPlan> plan);
+
+	// Blocks until work of the last run is finished, including the GPU part; rethrows error raised by it.
+	void wait();
+
+	// Blocks until nodes of the last run are scheduled, without waiting for their GPU work; rethrows error raised by it.
+	void waitForScheduling();
+
+	// Non-blocking variant of wait(); errors are reported by wait().
+	bool isDone();
+
+	// Blocks until work of all runners is finished; errors raised by their runs are left to be rethrown by their wait().
+	static void waitForAll();
+
+	// Number of runs of all graphs so far; e.g. scenes count how long their meshes have been stable in runs.
+	static std::size_t getTotalRunCount() { return totalRunCount; }
+
+	// Must not be called while the graph is running.
+	void setCaptureEnabled(bool enabled) { capture.setEnabled(enabled); }
+
+	// Must not be called while the graph is running; results of the previous frames become unavailable.
+	void setPipelineDepth(int depth);
+	int getPipelineDepth() const { return pipelineDepth; }
+
+	// Id of the frame started by the last run, -1 if the graph was never run.
+	int64_t getLastFrameId() const;
+
+	// Blocks until the given frame is finished; throws if results of the frame are no longer (or not yet) available.
+	void waitForFrame(int64_t frameId);
+
+	// Configuration must not be done while the graph is running.
+	GraphProfiler& getProfiler() { return profiler; }
+	MemoryTracker& getMemoryTracker() { return *memoryTracker; }
+
+	// Copies of results of finished frames in this stream do not wait for frames still in flight.
+	cudaStream_t getReadbackStream() const { return readbackStream; }
+
+private:
+	struct RunState;
+
+	void workerLoop();
+	void waitForScheduling(std::unique_lock<std::mutex>& lock);
+	void execute(const ExecutionPlan& plan, int64_t frameId);
+	void scheduleNodes(const ExecutionPlan& plan);
+	void executeBranch(const ExecutionPlan& plan, std::size_t branch, RunState& state);
+	void reserveBranchResources(std::size_t branchCount, std::size_t nodeCount);
+
+	// Streams are pooled instead of destroyed, since arrays of nodes may outlive the runner (e.g. when graphs are merged)
+	// and keep referring to the stream of their last work (see VArray).
+	static cudaStream_t acquireStream(unsigned flags);
+	static void releaseStream(cudaStream_t stream, unsigned flags);
+
+private:
+	std::vector<cudaStream_t> streams;  // One per branch, the first one is the main stream
+	std::vector<cudaEvent_t> branchFinishedEvents;
+	std::vector<cudaEvent_t> nodeFinishedEvents;
+	cudaEvent_t forkEvent {nullptr};
+	cudaEvent_t finishedEvent {nullptr};
+	cudaStream_t readbackStream {nullptr};
+	std::vector<cudaEvent_t> frameFinishedEvents;  // Indexed by frame id modulo pipeline depth
+	int pipelineDepth {1};
+	GraphCapture capture {std::make_unique<CudaGraphExecutor>()};
+	GraphProfiler profiler;
+	MemoryTracker::Ptr memoryTracker {std::make_shared<MemoryTracker>()};  // Shared with arrays attributed to it
+
+	mutable std::mutex mutex;
+	std::condition_variable stateChanged;
+	std::shared_ptr<ExecutionPlan> pendingPlan;
+	int64_t pendingFrameId {-1};
+	int64_t nextFrameId {0};
+	int64_t firstFrameOfDepth {0};  // Frames before the last depth change are not available
+	bool busy {false};
+	bool quit {false};
+	std::exception_ptr error;
+	std::thread worker;
+
+	static std::mutex registryMutex;
+	static std::set<GraphRunner*> registry;
+	static std::atomic<std::size_t> totalRunCount;
+	static std::mutex streamPoolMutex;
+	static std::vector<cudaStream_t> idleStreams;  // Blocking, for execution of graphs
+	static std::vector<cudaStream_t> idleReadbackStreams;  // Non-blocking
+};
@@ -28,6 +28,7 @@ struct IRaysNode
 	virtual std::size_t getRayCount() const = 0;
 	virtual std::optional<VArrayProxy<int>::ConstPtr> getRingIds() const = 0;
 	virtual std::optional<std::size_t> getRingIdsCount() const = 0;
+	virtual std::optional<VArrayProxy<float>::ConstPtr> getTimeOffsets() const = 0;
 };
 
 struct IRaysNodeSingleInput : IRaysNode
@@ -41,6 +42,7 @@ struct IRaysNodeSingleInput : IRaysNode
 	// Data getters
 	virtual VArrayProxy<Mat3x4f>::ConstPtr getRays() const { return input->getRays(); };
 	std::optional<VArrayProxy<int>::ConstPtr> getRingIds() const override { return input->getRingIds(); }
+	std::optional<VArrayProxy<float>::ConstPtr> getTimeOffsets() const override { return input->getTimeOffsets(); }
 
 protected:
 	IRaysNode::Ptr input;
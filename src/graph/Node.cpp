@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <graph/Node.hpp>
+#include <graph/graph.hpp>
 
 API_OBJECT_INSTANCE(Node);
 
@@ -29,6 +30,8 @@ void Node::addParent(Node::Ptr parent)
 	}
 	this->inputs.push_back(parent);
 	parent->outputs.push_back(shared_from_this());
+	invalidateExecutionPlan();
+	parent->invalidateExecutionPlan();
 }
 
 void Node::addChild(Node::Ptr child)
@@ -44,6 +47,8 @@ void Node::addChild(Node::Ptr child)
 	}
 	this->outputs.push_back(child);
 	child->inputs.push_back(shared_from_this());
+	invalidateExecutionPlan();
+	child->invalidateExecutionPlan();
 }
 
 void Node::removeChild(Node::Ptr child)
@@ -69,6 +74,28 @@ void Node::removeChild(Node::Ptr child)
 	}
 	// Remove us as a parent of that child
 	child->inputs.erase(thisIt);
+	invalidateExecutionPlan();
+	child->invalidateExecutionPlan();
+}
+
+bool Node::hasStaleOutput(uint64_t externalVersion)
+{
+	std::vector<uint64_t> generations {parametersGeneration, externalVersion};
+	for (auto&& input : inputs) {
+		generations.push_back(input->getOutputGeneration());
+	}
+	if (generations == lastSeenGenerations) {
+		return false;
+	}
+	lastSeenGenerations = std::move(generations);
+	return true;
+}
+
+void Node::invalidateExecutionPlan()
+{
+	if (executionPlan != nullptr) {
+		executionPlan->invalidate();
+	}
 }
 
 void Node::prependNode(Node::Ptr node)
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -22,6 +23,9 @@
 #include <APIObject.hpp>
 #include <RGLFields.hpp>
 
+struct ExecutionPlan;
+struct GraphRunner;
+
 struct Node : APIObject<Node>, std::enable_shared_from_this<Node>
 {
 	using Ptr = std::shared_ptr<Node>;
@@ -49,13 +53,41 @@ struct Node : APIObject<Node>, std::enable_shared_from_this<Node>
 	 */
 	virtual void schedule(cudaStream_t stream) = 0;
 
+	/**
+	 * Capturable node's schedule() and data getters only enqueue work in the stream, without synchronizing it,
+	 * so that scheduling can be recorded into a CUDA graph and replayed (see GraphCapture).
+	 */
+	virtual bool isCapturable() const { return false; }
+
+	/**
+	 * Called before recording or replaying the graph, outside of the capture, to bring external state (e.g. scene) up to date.
+	 * Returns false if the state has changed since the last schedule(), which invalidates its recording.
+	 */
+	virtual bool prepareCapture(cudaStream_t stream) { return true; }
+
+	/**
+	 * Output generation changes whenever the node's output may have changed, i.e. each time it is recomputed.
+	 * Children compare generations of their inputs with the ones seen by their last schedule() to skip recomputing
+	 * unchanged results (see hasStaleOutput()). Nodes which do not track it themselves get a new generation on every run.
+	 */
+	virtual bool tracksOutputGeneration() const { return false; }
+	uint64_t getOutputGeneration() const { return outputGeneration; }
+	void markOutputChanged() { outputGeneration = nextGeneration++; }
+
 	inline std::string getName() const { return name(typeid(*this)); }
 
 	const std::vector<Node::Ptr>& getInputs() const { return inputs; }
 	const std::vector<Node::Ptr>& getOutputs() const { return outputs; }
 
 	bool isActive() const { return active; }
-	void setActive(bool active) { this->active = active; }
+	void setActive(bool active) { this->active = active; invalidateExecutionPlan(); }
+
+	/**
+	 * Discards execution plan cached for the graph containing this node.
+	 * Must be called whenever the node gets connected, disconnected, (de)activated or its parameters change.
+	 */
+	void invalidateExecutionPlan();
+	const std::shared_ptr<ExecutionPlan>& getExecutionPlan() const { return executionPlan; }
 
 protected:
 	template<template<typename _1, typename _2> typename Container>
@@ -108,14 +140,33 @@ protected:
 
 	void prependNode(Node::Ptr node);
 
+	// Must be called by nodes tracking output generation when a parameter affecting the output changes.
+	void markParametersChanged() { parametersGeneration = nextGeneration++; }
+
+	/**
+	 * Returns true if parameters, generations of inputs or the given external state version (e.g. scene's)
+	 * have changed since the previous call, which means the output computed by the previous schedule() is stale.
+	 */
+	bool hasStaleOutput(uint64_t externalVersion = 0);
+
 protected:
 	bool active {true};
 	std::vector<Node::Ptr> inputs {};
 	std::vector<Node::Ptr> outputs {};
+	std::shared_ptr<ExecutionPlan> executionPlan {};  // Shared by all nodes of the graph
 
 	friend void runGraph(Node::Ptr);
+	friend std::shared_ptr<ExecutionPlan> buildExecutionPlan(Node::Ptr);
 	friend void destroyGraph(Node::Ptr);
+	friend GraphRunner& getGraphRunner(const Node::Ptr&);
 	friend struct fmt::formatter<Node>;
+
+private:
+	// Generations are unique among all nodes, so that replacing an input is detected as well
+	static inline std::atomic<uint64_t> nextGeneration {1};
+	uint64_t outputGeneration {nextGeneration++};
+	uint64_t parametersGeneration {nextGeneration++};
+	std::vector<uint64_t> lastSeenGenerations;  // Parameters, external version, inputs
 };
 
 #ifndef __CUDACC__
@@ -17,10 +17,13 @@
 #include <vector>
 #include <set>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 #include <graph/Node.hpp>
 #include <graph/Interfaces.hpp>
+#include <graph/RaytraceBackend.hpp>
+#include <graph/ResultBindings.hpp>
 #include <gpu/RaytraceRequestContext.hpp>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
@@ -46,6 +49,8 @@
 // TODO(prybicki): Consider templatizing IPointCloudNode with its InputInterface type.
 // TODO(prybicki): This would implement automatic getValidInput() and method forwarding.
 
+struct CompactPointsNode;
+
 struct FormatPointsNode : Node, IPointsNodeSingleInput
 {
 	using Ptr = std::shared_ptr<FormatPointsNode>;
@@ -54,6 +59,7 @@ struct FormatPointsNode : Node, IPointsNodeSingleInput
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override { return resultBindings.isEmpty(); }  // Written point count is tracked on the host
 
 	// Node requirements
 	std::vector<rgl_field_t> getRequiredFieldList() const override { return fields; }
@@ -69,19 +75,29 @@ struct FormatPointsNode : Node, IPointsNodeSingleInput
 	static void formatAsync(const VArray::Ptr& output, const IPointsNode::Ptr& input,
 	                        const std::vector<rgl_field_t>& fields, cudaStream_t stream);
 
+	// Input compaction is applied while formatting, packing hits from the uncompacted fields. Reset by validate().
+	void setFusedCompaction(std::shared_ptr<CompactPointsNode> compaction) { fusedCompaction = std::move(compaction); }
+
+	// Formatted points (RGL_FIELD_DYNAMIC_FORMAT) are written to the bound user buffer.
+	ResultBindings& getResultBindings() { return resultBindings; }
+
 private:
 	std::vector<rgl_field_t> fields;
 	VArray::Ptr output = VArray::create<char>();
+	std::shared_ptr<CompactPointsNode> fusedCompaction;
+	ResultBindings resultBindings;
 };
 
 struct CompactPointsNode : Node, IPointsNodeSingleInput
 {
 	using Ptr = std::shared_ptr<CompactPointsNode>;
 	void setParameters() {}
+	~CompactPointsNode() override;
 
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override { return true; }
 
 	// Point cloud description
 	bool isDense() const override { return true; }
@@ -91,11 +107,21 @@ struct CompactPointsNode : Node, IPointsNodeSingleInput
 	// Data getters
 	VArray::ConstPtr getFieldData(rgl_field_t field, cudaStream_t stream) const override;
 
+	// Used by the fused FormatPointsNode; indices are valid in the stream after schedule().
+	IPointsNode::Ptr getUncompactedInput() const { return input; }
+	const CompactionIndexType* getCompactionIndices() const { return inclusivePrefixSum->getDevicePtr(); }
+
+	// Point count of outputs scheduled in the stream. While recording a CUDA graph, the hit count is not known on the host,
+	// so outputs are sized for all input points instead; getWidth() gives the number of valid ones after the run.
+	size_t getOutputCount(cudaStream_t stream) const;
+
 private:
-	size_t width;
+	CompactionIndexType* width = nullptr;  // Pinned, so that copying it from the device can be captured
 	cudaEvent_t finishedEvent = nullptr;
 	VArrayProxy<CompactionIndexType>::Ptr inclusivePrefixSum = VArrayProxy<CompactionIndexType>::create();
+	VArray::Ptr scanStorage = VArray::create<char>();
 	mutable CacheManager<rgl_field_t, VArray::Ptr> cacheManager;
+	mutable std::mutex cacheMutex;  // Children in different branches may request fields concurrently
 };
 
 struct DownSamplePointsNode : Node, IPointsNodeSingleInput
@@ -125,6 +151,7 @@ private:
 	VArrayProxy<Field<RAY_IDX_U32>::type>::Ptr filteredIndices = VArrayProxy<Field<RAY_IDX_U32>::type>::create();
 	VArray::Ptr filteredPoints = VArray::create<pcl::PointXYZL>();
 	mutable CacheManager<rgl_field_t, VArray::Ptr> cacheManager;
+	mutable std::mutex cacheMutex;  // Children in different branches may request fields concurrently
 };
 
 struct RaytraceNode : Node, IPointsNode
@@ -135,11 +162,14 @@ struct RaytraceNode : Node, IPointsNode
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override;
+	bool prepareCapture(cudaStream_t stream) override;
+	bool tracksOutputGeneration() const override { return true; }  // Launch is skipped if rays and scene are unchanged
 
 	// Point cloud description
 	bool isDense() const override { return false; }
 	bool hasField(rgl_field_t field) const override { return fields.contains(field); }
-	size_t getWidth() const override { return raysNode->getRays()->getCount(); }
+	size_t getWidth() const override { return raysNode->getRayCount() * returnCount; }
 	size_t getHeight() const override { return 1; }  // TODO: implement height in use_rays
 
 	// Data getters
@@ -148,16 +178,45 @@ struct RaytraceNode : Node, IPointsNode
 
 
 	void setFields(const std::set<rgl_field_t>& fields);
+	void setBackend(rgl_raytrace_backend_t backendType);
+	void setReturnCount(int returnCount) { this->returnCount = returnCount; markParametersChanged(); }
+
+	/**
+	 * Nodes tracing the same scene with the same backend are traced together by a single launch of the first of them.
+	 * Members must be kept alive by the caller (execution plan) as long as the batch is used.
+	 * Valid after validate().
+	 */
+	void setBatch(RaytraceNode* leader, std::vector<RaytraceNode*> members);
+	const Scene* getScene() const { return scene.get(); }
+	rgl_raytrace_backend_t getBackendType() const { return backendType.value(); }
+
+	/**
+	 * Traces rays of the source transformed in the launch, instead of rays materialized by the input chain of TransformRaysNodes.
+	 * Transforms are given in order of application. Reset by validate().
+	 */
+	void setFusedRayTransforms(IRaysNode::Ptr source, std::vector<Mat3x4f> transforms);
+	bool canFuseRayTransforms() const { return backend->canFuseRayTransforms(); }
+	const IRaysNode::Ptr& getRaysInput() const { return raysNode; }
+
+private:
+	RaytraceRequestContext prepareRequest(MemLoc location);
+
 private:
 	float range;
+	int returnCount {1};
 	std::shared_ptr<Scene> scene;
 	std::set<rgl_field_t> fields;
 	IRaysNode::Ptr raysNode;
-	VArrayProxy<RaytraceRequestContext>::Ptr requestCtx = VArrayProxy<RaytraceRequestContext>::create(1);
+	IRaysNode::Ptr raysSource;  // Same as raysNode, unless ray transforms are fused
+	std::vector<Mat3x4f> fusedRayTransforms;
+	std::optional<rgl_raytrace_backend_t> backendType;
+	RaytraceBackend::Ptr backend;
 	std::unordered_map<rgl_field_t, VArray::Ptr> fieldData;
+	RaytraceNode* batchLeader {this};
+	std::vector<RaytraceNode*> batchMembers {this};  // Includes the leader; used only by the leader
 
 	template<rgl_field_t>
-	auto getPtrTo();
+	auto getPtrTo(MemLoc location);
 };
 
 struct TransformPointsNode : Node, IPointsNodeSingleInput
@@ -183,17 +242,25 @@ private:
 struct TransformRaysNode : Node, IRaysNodeSingleInput
 {
 	using Ptr = std::shared_ptr<TransformRaysNode>;
-	void setParameters(Mat3x4f transform) { this->transform = transform; }
+	void setParameters(Mat3x4f transform) { this->transform = transform; markParametersChanged(); }
 
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override { return true; }
+	bool tracksOutputGeneration() const override { return true; }  // Rays are transformed only if input or transform changed
 
 	// Data getters
-	VArrayProxy<Mat3x4f>::ConstPtr getRays() const override { return rays; }
+	VArrayProxy<Mat3x4f>::ConstPtr getRays() const override;
+
+	// Transform is applied by the child (RaytraceNode) instead, rays are not materialized. Reset by validate().
+	void setFusedIntoChild() { fusedIntoChild = true; }
+	const Mat3x4f& getTransform() const { return transform; }
+	const IRaysNode::Ptr& getRaysInput() const { return input; }
 
 private:
 	Mat3x4f transform;
+	bool fusedIntoChild {false};
 	VArrayProxy<Mat3x4f>::Ptr rays = VArrayProxy<Mat3x4f>::create();
 };
 
@@ -205,6 +272,8 @@ struct FromMat3x4fRaysNode : Node, IRaysNode
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override {}
+	bool isCapturable() const override { return true; }
+	bool tracksOutputGeneration() const override { return true; }  // Rays change only in setParameters()
 
 	// Rays description
 	size_t getRayCount() const override { return rays->getCount(); }
@@ -213,6 +282,7 @@ struct FromMat3x4fRaysNode : Node, IRaysNode
 	// Data getters
 	VArrayProxy<Mat3x4f>::ConstPtr getRays() const override { return rays; }
 	std::optional<VArrayProxy<int>::ConstPtr> getRingIds() const override { return std::nullopt; }
+	std::optional<VArrayProxy<float>::ConstPtr> getTimeOffsets() const override { return std::nullopt; }
 
 private:
 	VArrayProxy<Mat3x4f>::Ptr rays = VArrayProxy<Mat3x4f>::create();
@@ -225,7 +295,9 @@ struct SetRingIdsRaysNode : Node, IRaysNodeSingleInput
 
 	// Node
 	void validate() override;
-	void schedule(cudaStream_t stream) override {}
+	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override { return true; }
+	bool tracksOutputGeneration() const override { return true; }
 
 	// Rays description
 	std::optional<size_t> getRingIdsCount() const override { return ringIds->getCount(); }
@@ -237,6 +309,24 @@ private:
 	VArrayProxy<int>::Ptr ringIds = VArrayProxy<int>::create();
 };
 
+struct SetTimeOffsetsRaysNode : Node, IRaysNodeSingleInput
+{
+	using Ptr = std::shared_ptr<SetTimeOffsetsRaysNode>;
+	void setParameters(const float* timeOffsetsRaw, size_t timeOffsetsCount);
+
+	// Node
+	void validate() override;
+	void schedule(cudaStream_t stream) override;
+	bool isCapturable() const override { return true; }
+	bool tracksOutputGeneration() const override { return true; }
+
+	// Data getters
+	std::optional<VArrayProxy<float>::ConstPtr> getTimeOffsets() const override { return timeOffsets; }
+
+private:
+	VArrayProxy<float>::Ptr timeOffsets = VArrayProxy<float>::create();
+};
+
 struct WritePCDFilePointsNode : Node, IPointsNodeSingleInput
 {
 	using Ptr = std::shared_ptr<WritePCDFilePointsNode>;
@@ -266,6 +356,8 @@ struct YieldPointsNode : Node, IPointsNodeSingleInput
 	// Node
 	void validate() override;
 	void schedule(cudaStream_t stream) override;
+	// Copies to the ring depend on the frame; events of result buffers are recorded while scheduling
+	bool isCapturable() const override { return frames.size() == 1 && resultBindings.isEmpty(); }
 
 	// Node requirements
 	std::vector<rgl_field_t> getRequiredFieldList() const override { return fields; }
@@ -274,9 +366,30 @@ struct YieldPointsNode : Node, IPointsNodeSingleInput
 	VArray::ConstPtr getFieldData(rgl_field_t field, cudaStream_t stream) const override
 	{ return results.at(field); }
 
+	// Called by GraphRunner before scheduling the frame.
+	void setFrame(int64_t frameId, int pipelineDepth);
+
+	// Results of a frame still in the ring; the runner has to wait for the frame first.
+	VArray::ConstPtr getFrameFieldData(int64_t frameId, rgl_field_t field) const;
+
+	// Yielded fields are also written to the bound user buffers.
+	ResultBindings& getResultBindings() { return resultBindings; }
+
 private:
+	// Results of a pipelined frame; they are copies, since the next frame overwrites outputs of other nodes.
+	// Without pipelining, the single slot refers to the outputs of the input node, which are read before the next run.
+	struct Frame
+	{
+		int64_t id {-1};
+		std::unordered_map<rgl_field_t, VArray::ConstPtr> results;
+		std::unordered_map<rgl_field_t, VArray::Ptr> copies;
+	};
+
 	std::vector<rgl_field_t> fields;
 	std::unordered_map<rgl_field_t, VArray::ConstPtr> results;
+	std::vector<Frame> frames {1};  // Indexed by frame id modulo pipeline depth
+	int64_t currentFrameId {0};
+	ResultBindings resultBindings;
 };
 
 struct VisualizePointsNode : Node, IPointsNodeSingleInput
@@ -0,0 +1,48 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <VArray.hpp>
+#include <gpu/RaytraceRequestContext.hpp>
+
+struct Scene;
+
+/**
+ * Executes raytracing requested by RaytraceNodes.
+ * Pointers in request contexts refer to memory at the location reported by getMemLoc().
+ */
+struct RaytraceBackend
+{
+	using Ptr = std::shared_ptr<RaytraceBackend>;
+	virtual ~RaytraceBackend() = default;
+
+	virtual MemLoc getMemLoc() const = 0;
+
+	// Traces rays of all requests against the scene and fills their outputs; may complete asynchronously in the given stream.
+	virtual void launch(Scene& scene, const std::vector<RaytraceRequestContext>& requests, cudaStream_t stream) = 0;
+
+	// Whether launch() applies RaytraceRequestContext::rayTransforms with the same arithmetic as TransformRaysNode.
+	virtual bool canFuseRayTransforms() const { return false; }
+
+	// Whether launch() only enqueues work in the stream, so that it can be recorded into a CUDA graph.
+	virtual bool isCapturable() const { return false; }
+
+	// Brings the scene up to date outside of the capture; returns false if the scene has changed since the last launch.
+	virtual bool prepareReplay(Scene& scene, cudaStream_t stream) { return false; }
+};
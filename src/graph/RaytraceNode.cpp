@@ -14,58 +14,136 @@
 
 #include <graph/Nodes.hpp>
 #include <scene/Scene.hpp>
-#include <macros/optix.hpp>
+#include <gpu/OptixRaytraceBackend.hpp>
+#include <cpu/CpuRaytraceBackend.hpp>
 #include <RGLFields.hpp>
 
 void RaytraceNode::validate()
 {
 	raysNode = getValidInput<IRaysNode>();
+	raysSource = raysNode;
+	fusedRayTransforms.clear();
+	markParametersChanged();  // Fields, range, scene and fusion are (re)configured along with validation
+
+	if (backend == nullptr) {
+		setBackend(RGL_RAYTRACE_BACKEND_OPTIX);
+	}
 
 	if (fields.contains(RING_ID_U16) && !raysNode->getRingIds().has_value()) {
 		auto msg = fmt::format("requested for field RING_ID_U16, but RaytraceNode cannot get ring ids");
 		throw InvalidPipeline(msg);
 	}
+
+	if (fields.contains(TIME_STAMP_F64) && !raysNode->getTimeOffsets().has_value()) {
+		auto msg = fmt::format("requested for field TIME_STAMP_F64, but RaytraceNode cannot get time offsets");
+		throw InvalidPipeline(msg);
+	}
 }
 
 template<rgl_field_t field>
-auto RaytraceNode::getPtrTo()
+auto RaytraceNode::getPtrTo(MemLoc location)
 {
-	return fields.contains(field) ? fieldData.at(field)->getTypedProxy<typename Field<field>::type>()->getDevicePtr() : nullptr;
+	return fields.contains(field) ? fieldData.at(field)->getTypedProxy<typename Field<field>::type>()->getWritePtr(location) : nullptr;
 }
 
 void RaytraceNode::schedule(cudaStream_t stream)
+{
+	if (batchLeader != this) {
+		return;  // Outputs are filled by the launch of the batch leader, which precedes this node
+	}
+	// Static rigs trace the same rays in an unchanged scene, the results of the previous launch are still valid
+	bool anyStale = false;
+	for (auto&& member : batchMembers) {
+		anyStale |= member->hasStaleOutput(member->scene->getVersion());  // Evaluated for all, to remember the generations
+	}
+	if (!anyStale) {
+		return;
+	}
+	for (auto&& member : batchMembers) {
+		member->markOutputChanged();
+	}
+	MemLoc location = backend->getMemLoc();
+	if (location == MemLoc::Host) {
+		// Inputs may be produced by work enqueued before in the stream
+		CHECK_CUDA(cudaStreamSynchronize(stream));
+	}
+	std::vector<RaytraceRequestContext> requests;
+	for (auto&& member : batchMembers) {
+		requests.push_back(member->prepareRequest(location));
+	}
+	backend->launch(*scene, requests, stream);
+}
+
+bool RaytraceNode::isCapturable() const
+{
+	return backend != nullptr && backend->isCapturable();
+}
+
+bool RaytraceNode::prepareCapture(cudaStream_t stream)
+{
+	return batchLeader != this || backend->prepareReplay(*scene, stream);
+}
+
+void RaytraceNode::setBatch(RaytraceNode* leader, std::vector<RaytraceNode*> members)
+{
+	batchLeader = leader;
+	batchMembers = std::move(members);
+}
+
+RaytraceRequestContext RaytraceNode::prepareRequest(MemLoc location)
 {
 	for (auto&& field : fields) {
-		fieldData[field]->resize(raysNode->getRayCount(), false, false);
+		fieldData[field]->resize(raysNode->getRayCount() * returnCount, false, false);
 	}
-	auto rays = raysNode->getRays();
-	auto sceneAS = scene->getAS();
-	auto sceneSBT = scene->getSBT();
-	dim3 launchDims = {static_cast<unsigned int>(rays->getCount()), 1, 1};
+	auto rays = raysSource->getRays();
 
 	// Optional
 	auto ringIds = raysNode->getRingIds();
+	auto timeOffsets = raysNode->getTimeOffsets();
 
-	(*requestCtx)[0] = RaytraceRequestContext{
-		.rays = rays->getDevicePtr(),
+	RaytraceRequestContext ctx = {
+		.rays = rays->getReadPtr(location),
 		.rayCount = rays->getCount(),
+		.rayTransformCount = static_cast<int>(fusedRayTransforms.size()),
 		.rayRange = range,
-		.ringIds = ringIds.has_value() ? (*ringIds)->getDevicePtr() : nullptr,
+		.ringIds = ringIds.has_value() ? (*ringIds)->getReadPtr(location) : nullptr,
 		.ringIdsCount = ringIds.has_value() ? (*ringIds)->getCount() : 0,
-		.scene = sceneAS,
-		.xyz = getPtrTo<XYZ_F32>(),
-		.isHit = getPtrTo<IS_HIT_I32>(),
-		.rayIdx = getPtrTo<RAY_IDX_U32>(),
-		.ringIdx = getPtrTo<RING_ID_U16>(),
-		.distance = getPtrTo<DISTANCE_F32>(),
-		.intensity = getPtrTo<INTENSITY_F32>(),
-		.laserRetro = getPtrTo<LASER_RETRO_F32>(),
+		.timeOffsets = timeOffsets.has_value() ? (*timeOffsets)->getReadPtr(location) : nullptr,
+		.returnCount = returnCount,
+		.xyz = getPtrTo<XYZ_F32>(location),
+		.isHit = getPtrTo<IS_HIT_I32>(location),
+		.rayIdx = getPtrTo<RAY_IDX_U32>(location),
+		.ringIdx = getPtrTo<RING_ID_U16>(location),
+		.distance = getPtrTo<DISTANCE_F32>(location),
+		.intensity = getPtrTo<INTENSITY_F32>(location),
+		.laserRetro = getPtrTo<LASER_RETRO_F32>(location),
+		.timeStamp = getPtrTo<TIME_STAMP_F64>(location),
+		.returnType = getPtrTo<RETURN_TYPE_U8>(location),
 	};
+	std::copy(fusedRayTransforms.begin(), fusedRayTransforms.end(), ctx.rayTransforms);
+	return ctx;
+}
 
-	CUdeviceptr pipelineArgsPtr = requestCtx->getCUdeviceptr();
-	std::size_t pipelineArgsSize = requestCtx->getBytesInUse();
-	CHECK_OPTIX(optixLaunch(Optix::getOrCreate().pipeline, stream, pipelineArgsPtr, pipelineArgsSize, &sceneSBT, launchDims.x, launchDims.y, launchDims.y));
-	CHECK_CUDA(cudaStreamSynchronize(stream));
+void RaytraceNode::setFusedRayTransforms(IRaysNode::Ptr source, std::vector<Mat3x4f> transforms)
+{
+	if (transforms.size() > MAX_FUSED_RAY_TRANSFORMS) {
+		throw std::logic_error(fmt::format("at most {} ray transforms can be fused, got {}", MAX_FUSED_RAY_TRANSFORMS, transforms.size()));
+	}
+	raysSource = std::move(source);
+	fusedRayTransforms = std::move(transforms);
+}
+
+void RaytraceNode::setBackend(rgl_raytrace_backend_t backendType)
+{
+	if (this->backendType == backendType) {
+		return; // Keep data cached by the backend
+	}
+	switch (backendType) {
+		case RGL_RAYTRACE_BACKEND_OPTIX: backend = std::make_shared<OptixRaytraceBackend>(); break;
+		case RGL_RAYTRACE_BACKEND_CPU: backend = std::make_shared<CpuRaytraceBackend>(); break;
+		default: throw std::invalid_argument(fmt::format("unknown raytrace backend: {}", static_cast<int>(backendType)));
+	}
+	this->backendType = backendType;
 }
 
 void RaytraceNode::setFields(const std::set<rgl_field_t>& fields)
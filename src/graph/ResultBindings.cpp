@@ -0,0 +1,110 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <graph/ResultBindings.hpp>
+
+#include <RGLExceptions.hpp>
+#include <RGLFields.hpp>
+
+ResultBindings::~ResultBindings()
+{
+	for (auto&& [field, binding] : bindings) {
+		try {
+			release(binding);
+		}
+		catch (std::exception& e) {
+			RGL_WARN("Failed to release result buffer of field {}: {}", toString(field), e.what());
+		}
+	}
+}
+
+void ResultBindings::bind(rgl_field_t field, void* buffer, std::size_t capacityBytes, rgl_result_buffer_t type)
+{
+	std::lock_guard lock {mutex};
+	if (auto it = bindings.find(field); it != bindings.end()) {
+		release(it->second);
+		bindings.erase(it);
+	}
+	if (buffer == nullptr) {
+		return;
+	}
+	if (type == RGL_RESULT_BUFFER_HOST) {
+		CHECK_CUDA(cudaHostRegister(buffer, capacityBytes, cudaHostRegisterDefault));
+	}
+	cudaEvent_t written = nullptr;
+	CHECK_CUDA(cudaEventCreateWithFlags(&written, cudaEventDisableTiming));
+	bindings[field] = {.buffer = buffer, .capacityBytes = capacityBytes, .type = type, .written = written};
+}
+
+bool ResultBindings::isEmpty() const
+{
+	std::lock_guard lock {mutex};
+	return bindings.empty();
+}
+
+void ResultBindings::write(rgl_field_t field, const VArray::ConstPtr& data, std::size_t pointSize, cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	auto it = bindings.find(field);
+	if (it == bindings.end()) {
+		return;
+	}
+	Binding& binding = it->second;
+	std::size_t byteCount = data->getElemCount() * data->getElemSize();
+	if (byteCount > binding.capacityBytes) {
+		auto msg = fmt::format("result buffer of field {} is too small: {} bytes needed, {} bytes bound",
+		                       toString(field), byteCount, binding.capacityBytes);
+		throw std::invalid_argument(msg);
+	}
+	if (byteCount > 0) {
+		CHECK_CUDA(cudaMemcpyAsync(binding.buffer, data->getReadPtr(MemLoc::Device, stream), byteCount, cudaMemcpyDefault, stream));
+	}
+	CHECK_CUDA(cudaEventRecord(binding.written, stream));
+	binding.pointCount = static_cast<int32_t>(byteCount / pointSize);
+}
+
+cudaEvent_t ResultBindings::getWrittenEvent(rgl_field_t field) const
+{
+	std::lock_guard lock {mutex};
+	return getWrittenBinding(field).written;
+}
+
+int32_t ResultBindings::getWrittenPointCount(rgl_field_t field) const
+{
+	std::lock_guard lock {mutex};
+	return getWrittenBinding(field).pointCount;
+}
+
+const ResultBindings::Binding& ResultBindings::getWrittenBinding(rgl_field_t field) const
+{
+	auto it = bindings.find(field);
+	if (it == bindings.end()) {
+		throw InvalidAPIArgument(fmt::format("no result buffer is bound for field {}", toString(field)));
+	}
+	if (it->second.pointCount < 0) {
+		throw InvalidAPIArgument(fmt::format("result buffer of field {} has not been written since it was bound", toString(field)));
+	}
+	return it->second;
+}
+
+void ResultBindings::release(Binding& binding)
+{
+	// The last copy to the buffer may be still in flight
+	CHECK_CUDA(cudaEventSynchronize(binding.written));
+	CHECK_CUDA(cudaEventDestroy(binding.written));
+	if (binding.type == RGL_RESULT_BUFFER_HOST) {
+		CHECK_CUDA(cudaHostUnregister(binding.buffer));
+	}
+}
@@ -0,0 +1,67 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <map>
+#include <mutex>
+
+#include <cuda_runtime_api.h>
+
+#include <rgl/api/core.h>
+#include <VArray.hpp>
+
+/**
+ * User buffers registered as destinations of node's results, see rgl_graph_bind_result_buffer.
+ * Results are copied straight from the node's output to the buffer in the node's stream, right after they are produced;
+ * an event recorded after the copy lets the caller wait only for its buffer. Each run overwrites the buffer.
+ * Pageable host buffers are page-locked for the lifetime of the binding, so that the copies are asynchronous.
+ * Events are recorded while scheduling, hence nodes writing to bound buffers are not captured.
+ */
+struct ResultBindings
+{
+	ResultBindings() = default;
+	~ResultBindings();
+	ResultBindings(const ResultBindings&) = delete;
+	ResultBindings& operator=(const ResultBindings&) = delete;
+
+	// Replaces the previous binding of the field; nullptr buffer only removes it. Must not be called while the graph is running.
+	void bind(rgl_field_t field, void* buffer, std::size_t capacityBytes, rgl_result_buffer_t type);
+	bool isEmpty() const;
+
+	// Enqueues copy of the data to the field's buffer, if bound; throws if the buffer is too small.
+	void write(rgl_field_t field, const VArray::ConstPtr& data, std::size_t pointSize, cudaStream_t stream);
+
+	// Event marking completion of the last write; throws if the field was not written since bound.
+	cudaEvent_t getWrittenEvent(rgl_field_t field) const;
+	int32_t getWrittenPointCount(rgl_field_t field) const;
+
+private:
+	struct Binding
+	{
+		void* buffer;
+		std::size_t capacityBytes;
+		rgl_result_buffer_t type;
+		cudaEvent_t written;
+		int32_t pointCount {-1};  // Of the last write, -1 if none
+	};
+
+	const Binding& getWrittenBinding(rgl_field_t field) const;
+	static void release(Binding& binding);
+
+private:
+	mutable std::mutex mutex;  // Buffers are written by the scheduling thread and waited for by the API
+	std::map<rgl_field_t, Binding> bindings;
+};
@@ -17,6 +17,7 @@
 void SetRingIdsRaysNode::setParameters(const int* ringIdsRaw, size_t ringIdsCount)
 {
 	ringIds->setData(ringIdsRaw, ringIdsCount);
+	markParametersChanged();
 }
 
 void SetRingIdsRaysNode::validate()
@@ -29,3 +30,11 @@ void SetRingIdsRaysNode::validate()
 		throw InvalidPipeline(msg);
 	}
 }
+
+void SetRingIdsRaysNode::schedule(cudaStream_t stream)
+{
+	// Rays of the input are passed through, they are stale if the input's or ring ids are
+	if (hasStaleOutput()) {
+		markOutputChanged();
+	}
+}
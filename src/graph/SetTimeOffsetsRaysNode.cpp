@@ -0,0 +1,39 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <graph/Nodes.hpp>
+
+void SetTimeOffsetsRaysNode::setParameters(const float* timeOffsetsRaw, size_t timeOffsetsCount)
+{
+	timeOffsets->setData(timeOffsetsRaw, timeOffsetsCount);
+	markParametersChanged();
+}
+
+void SetTimeOffsetsRaysNode::validate()
+{
+	input = getValidInput<IRaysNode>();
+
+	if (input->getRayCount() != timeOffsets->getCount()) {
+		auto msg = fmt::format("time offsets don't match number of rays. "
+		    "RayCount({}) should be equal to TimeOffsetsCount({})", input->getRayCount(), timeOffsets->getCount());
+		throw InvalidPipeline(msg);
+	}
+}
+
+void SetTimeOffsetsRaysNode::schedule(cudaStream_t stream)
+{
+	if (hasStaleOutput()) {
+		markOutputChanged();
+	}
+}
@@ -18,10 +18,27 @@
 void TransformRaysNode::validate()
 {
 	input = getValidInput<IRaysNode>();
+	fusedIntoChild = false;
+	markParametersChanged();  // Rays may not be materialized, if they were fused before
 }
 
 void TransformRaysNode::schedule(cudaStream_t stream)
 {
-	rays->resize(getRayCount());
+	if (!hasStaleOutput()) {
+		return;  // Rays transformed by the previous run are still valid
+	}
+	markOutputChanged();  // Also when fused, so that the child notices the change
+	if (fusedIntoChild) {
+		return;
+	}
+	rays->resize(getRayCount(), false, false);
 	gpuTransformRays(stream, getRayCount(), input->getRays()->getDevicePtr(), rays->getDevicePtr(), transform);
 }
+
+VArrayProxy<Mat3x4f>::ConstPtr TransformRaysNode::getRays() const
+{
+	if (fusedIntoChild) {
+		throw std::logic_error("rays of TransformRaysNode fused into its child are not materialized");
+	}
+	return rays;
+}
@@ -26,7 +26,49 @@ void YieldPointsNode::schedule(cudaStream_t stream)
 {
 	for (auto&& field : fields) {
 		results[field] = input->getFieldData(field, stream);
+		resultBindings.write(field, results[field], getFieldSize(field), stream);
 	}
+
+	// Slots of the other frames in flight may be read by the API meanwhile, this one is not available until scheduled
+	Frame& frame = frames[currentFrameId % frames.size()];
+	frame.id = currentFrameId;
+	if (frames.size() == 1) {
+		frame.results = results;
+		return;
+	}
+	for (auto&& field : fields) {
+		VArray::Ptr& copy = frame.copies[field];
+		if (copy == nullptr) {
+			copy = VArray::create(field);
+		}
+		const VArray::ConstPtr& result = results.at(field);
+		copy->resize(result->getElemCount(), false, false);
+		std::size_t byteCount = result->getElemCount() * result->getElemSize();
+		CHECK_CUDA(cudaMemcpyAsync(copy->getWritePtr(MemLoc::Device), result->getReadPtr(MemLoc::Device), byteCount, cudaMemcpyDefault, stream));
+		frame.results[field] = copy;
+	}
+}
+
+void YieldPointsNode::setFrame(int64_t frameId, int pipelineDepth)
+{
+	if (frames.size() != static_cast<std::size_t>(pipelineDepth)) {
+		frames = std::vector<Frame>(pipelineDepth);
+	}
+	currentFrameId = frameId;
+}
+
+VArray::ConstPtr YieldPointsNode::getFrameFieldData(int64_t frameId, rgl_field_t field) const
+{
+	const Frame& frame = frames[frameId % frames.size()];
+	if (frame.id != frameId) {
+		auto msg = fmt::format("YieldPointsNode has no results of frame {}, it was not executed in that frame", frameId);
+		throw std::invalid_argument(msg);
+	}
+	if (!frame.results.contains(field)) {
+		auto msg = fmt::format("YieldPointsNode does not yield field {}", toString(field));
+		throw std::invalid_argument(msg);
+	}
+	return frame.results.at(field);
 }
 
 void YieldPointsNode::validate()
@@ -12,11 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <set>
-#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <unordered_map>
+
 #include <graph/graph.hpp>
 #include <graph/Nodes.hpp>
 #include <RGLFields.hpp>
+#include <macros/cuda.hpp>
 
 std::set<Node::Ptr> findConnectedNodes(Node::Ptr anyNode)
 {
@@ -67,14 +71,25 @@ static std::vector<Node::Ptr> findExecutionOrder(std::set<Node::Ptr> nodes)
 	return {reverseOrder.rbegin(), reverseOrder.rend()};
 }
 
-void runGraph(Node::Ptr userNode)
+static std::set<Node::Ptr> findDescendants(const Node::Ptr& node)
 {
-	std::vector<Node::Ptr> nodesInExecOrder = findExecutionOrder(findConnectedNodes(userNode));
-
-	RGL_DEBUG("Running graph with {} nodes", nodesInExecOrder.size());
+	std::set<Node::Ptr> descendants;
+	std::function<void(const Node::Ptr&)> dfsRec = [&](const Node::Ptr& current) {
+		for (auto&& output : current->getOutputs()) {
+			if (descendants.insert(output).second) {
+				dfsRec(output);
+			}
+		}
+	};
+	dfsRec(node);
+	return descendants;
+}
 
-	std::set<rgl_field_t> fieldsToCompute;
-	for (auto&& node : nodesInExecOrder) {
+// Fields which RaytraceNode has to compute for the nodes downstream of it
+static std::set<rgl_field_t> findFieldsToCompute(const std::set<Node::Ptr>& descendants)
+{
+	std::set<rgl_field_t> fieldsToCompute = {XYZ_F32};
+	for (auto&& node : descendants) {
 		if (auto pointNode = std::dynamic_pointer_cast<IPointsNode>(node)) {
 			for (auto&& field : pointNode->getRequiredFieldList()) {
 				if (!isDummy(field)) {
@@ -82,28 +97,333 @@ void runGraph(Node::Ptr userNode)
 				}
 			}
 		}
+		if (std::dynamic_pointer_cast<CompactPointsNode>(node) != nullptr) {
+			fieldsToCompute.insert(IS_HIT_I32);
+		}
+	}
+	return fieldsToCompute;
+}
+
+/**
+ * Groups RaytraceNodes which can be traced by a single launch and assigns them their batches.
+ * Returns additional dependencies, as (child, parent) pairs, which make each batch leader run after inputs of all its members,
+ * and the other members after the leader.
+ */
+static std::vector<std::pair<Node::Ptr, Node::Ptr>> batchRaytraceNodes(const std::vector<RaytraceNode::Ptr>& raytraceNodes,
+                                                                       const std::map<RaytraceNode::Ptr, std::set<Node::Ptr>>& descendants)
+{
+	std::vector<std::vector<RaytraceNode::Ptr>> batches;
+	for (auto&& node : raytraceNodes) {
+		auto canJoin = [&](const std::vector<RaytraceNode::Ptr>& batch) {
+			bool sameLaunch = batch[0]->getScene() == node->getScene() && batch[0]->getBackendType() == node->getBackendType();
+			// Nodes come in execution order, so the candidate may only be downstream of the members
+			bool independent = std::none_of(batch.begin(), batch.end(), [&](auto&& member) { return descendants.at(member).contains(node); });
+			return sameLaunch && independent;
+		};
+		auto batchIt = std::find_if(batches.begin(), batches.end(), canJoin);
+		if (batchIt == batches.end()) {
+			batches.push_back({node});
+		}
+		else {
+			batchIt->push_back(node);
+		}
+	}
+
+	std::vector<std::pair<Node::Ptr, Node::Ptr>> extraDependencies;
+	for (auto&& batch : batches) {
+		const RaytraceNode::Ptr& leader = batch[0];
+		std::vector<RaytraceNode*> members;
+		for (auto&& member : batch) {
+			members.push_back(member.get());
+			member->setBatch(leader.get(), {});
+			if (member == leader) {
+				continue;
+			}
+			for (auto&& input : member->getInputs()) {
+				extraDependencies.emplace_back(leader, input);
+			}
+			extraDependencies.emplace_back(member, leader);
+		}
+		leader->setBatch(leader.get(), members);
+		if (batch.size() > 1) {
+			RGL_DEBUG("Batched {} raytrace nodes into a single launch", batch.size());
+		}
+	}
+	return extraDependencies;
+}
+
+/**
+ * Fuses linear chains of nodes, so that their intermediate results are not materialized:
+ * - TransformRaysNodes feeding only a RaytraceNode are applied to rays by its launch,
+ * - CompactPointsNode is applied by its child FormatPointsNode while packing the points.
+ * Results are identical to the unfused execution. Fusion is reset by validation of the nodes.
+ */
+static void fuseNodeChains(const std::vector<Node::Ptr>& nodes)
+{
+	for (auto&& node : nodes) {
+		auto raytrace = std::dynamic_pointer_cast<RaytraceNode>(node);
+		if (raytrace != nullptr && raytrace->canFuseRayTransforms()) {
+			std::vector<Mat3x4f> transforms;  // Nearest to the raytrace node first
+			IRaysNode::Ptr source = raytrace->getRaysInput();
+			auto transformNode = std::dynamic_pointer_cast<TransformRaysNode>(source);
+			while (transformNode != nullptr && transformNode->getOutputs().size() == 1 && transforms.size() < MAX_FUSED_RAY_TRANSFORMS) {
+				transformNode->setFusedIntoChild();
+				transforms.push_back(transformNode->getTransform());
+				source = transformNode->getRaysInput();
+				transformNode = std::dynamic_pointer_cast<TransformRaysNode>(source);
+			}
+			if (!transforms.empty()) {
+				RGL_DEBUG("Fused {} ray transforms into {}", transforms.size(), *node);
+				std::reverse(transforms.begin(), transforms.end());
+				raytrace->setFusedRayTransforms(source, std::move(transforms));
+			}
+		}
+
+		auto format = std::dynamic_pointer_cast<FormatPointsNode>(node);
+		if (format != nullptr && format->getInputs().size() == 1) {
+			auto compaction = std::dynamic_pointer_cast<CompactPointsNode>(format->getInputs()[0]);
+			if (compaction != nullptr) {
+				RGL_DEBUG("Fused compaction into {}", *node);
+				format->setFusedCompaction(compaction);
+			}
+		}
 	}
+}
 
-	fieldsToCompute.insert(XYZ_F32);
+// Stable topological sort of the nodes, given the parents of each of them
+static std::vector<Node::Ptr> sortTopologically(const std::vector<Node::Ptr>& nodes, const std::map<Node::Ptr, std::vector<Node::Ptr>>& parents)
+{
+	std::map<Node::Ptr, std::size_t> unsortedParentCount;
+	for (auto&& node : nodes) {
+		unsortedParentCount[node] = parents.at(node).size();
+	}
+	std::vector<Node::Ptr> sorted;
+	while (sorted.size() < nodes.size()) {
+		auto next = std::find_if(nodes.begin(), nodes.end(), [&](auto&& node) { return unsortedParentCount.at(node) == 0; });
+		if (next == nodes.end()) {
+			throw std::logic_error("cyclic dependency between nodes");
+		}
+		unsortedParentCount[*next] = std::numeric_limits<std::size_t>::max();  // Mark as sorted
+		sorted.push_back(*next);
+		for (auto&& node : nodes) {
+			const auto& nodeParents = parents.at(node);
+			unsortedParentCount[node] -= std::count(nodeParents.begin(), nodeParents.end(), *next);
+		}
+	}
+	return sorted;
+}
 
-	if (!Node::filter<CompactPointsNode>(nodesInExecOrder).empty()) {
-		fieldsToCompute.insert(IS_HIT_I32);
+std::shared_ptr<ExecutionPlan> buildExecutionPlan(Node::Ptr userNode)
+{
+	std::set<Node::Ptr> connectedNodes = findConnectedNodes(userNode);
+	static std::atomic<std::size_t> nextPlanId {1};
+	auto plan = std::make_shared<ExecutionPlan>();
+	plan->id = nextPlanId++;
+	// Keep the worker thread, streams and settings of the previous plan, preferably of the node used to run the graph
+	plan->runner = userNode->executionPlan != nullptr ? userNode->executionPlan->runner : nullptr;
+	for (auto&& node : connectedNodes) {
+		if (plan->runner == nullptr && node->executionPlan != nullptr) {
+			plan->runner = node->executionPlan->runner;
+		}
 	}
+	if (plan->runner == nullptr) {
+		plan->runner = std::make_shared<GraphRunner>();
+	}
+	std::vector<Node::Ptr> nodesInExecOrder = findExecutionOrder(connectedNodes);
 
-	RaytraceNode::Ptr rt = Node::getExactlyOne<RaytraceNode>(nodesInExecOrder);
-	rt->setFields(fieldsToCompute);
+	// Each lidar computes only the fields needed downstream of it
+	auto raytraceNodes = Node::filter<RaytraceNode>(nodesInExecOrder);
+	if (raytraceNodes.empty()) {
+		auto msg = fmt::format("looked for RaytraceNode, but found none");
+		throw InvalidPipeline(msg);
+	}
+	std::map<RaytraceNode::Ptr, std::set<Node::Ptr>> raytraceDescendants;
+	for (auto&& rt : raytraceNodes) {
+		raytraceDescendants[rt] = findDescendants(rt);
+		rt->setFields(findFieldsToCompute(raytraceDescendants[rt]));
+	}
 
 	for (auto&& current : nodesInExecOrder) {
 		RGL_DEBUG("Validating node: {}", *current);
 		current->validate();
 	}
 	RGL_DEBUG("Node validation completed");  // This also logs the time diff for the last one.
+	fuseNodeChains(nodesInExecOrder);
 
+	std::map<Node::Ptr, std::vector<Node::Ptr>> parentNodes;
 	for (auto&& node : nodesInExecOrder) {
-		RGL_DEBUG("Scheduling node: {}", *node);
-		node->schedule(nullptr);
+		parentNodes[node] = node->getInputs();
+	}
+	for (auto&& [child, parent] : batchRaytraceNodes(raytraceNodes, raytraceDescendants)) {
+		parentNodes[child].push_back(parent);
+	}
+	plan->nodesInExecOrder = sortTopologically(nodesInExecOrder, parentNodes);
+
+	std::unordered_map<const Node*, std::size_t> execIndices;
+	std::vector<std::vector<std::size_t>> parents(plan->nodesInExecOrder.size());
+	for (std::size_t i = 0; i < plan->nodesInExecOrder.size(); ++i) {
+		execIndices[plan->nodesInExecOrder[i].get()] = i;
+		for (auto&& parent : parentNodes.at(plan->nodesInExecOrder[i])) {
+			parents[i].push_back(execIndices.at(parent.get()));
+		}
+	}
+	plan->branchPlan = BranchPlan::build(parents);
+	RGL_DEBUG("Graph split into {} branches", plan->branchPlan.getBranchCount());
+
+	// Inactive nodes share the plan as well, since activating them changes it
+	for (auto&& node : connectedNodes) {
+		node->executionPlan = plan;
+	}
+	return plan;
+}
+
+void runGraph(Node::Ptr userNode)
+{
+	std::shared_ptr<ExecutionPlan> plan = userNode->executionPlan;
+	if (plan == nullptr || !plan->isValid()) {
+		// Validation below may modify nodes, hence the previous run has to be finished
+		waitForGraph(userNode);
+		plan = buildExecutionPlan(userNode);
+	}
+
+	RGL_DEBUG("Running graph with {} nodes", plan->nodesInExecOrder.size());
+	plan->runner->run(plan);
+}
+
+void waitForGraph(const Node::Ptr& anyNode)
+{
+	if (anyNode->getExecutionPlan() != nullptr) {
+		anyNode->getExecutionPlan()->runner->wait();
 	}
-	RGL_DEBUG("Node scheduling done");  // This also logs the time diff for the last one
+}
+
+bool isGraphDone(const Node::Ptr& anyNode)
+{
+	return anyNode->getExecutionPlan() == nullptr || anyNode->getExecutionPlan()->runner->isDone();
+}
+
+void waitForAllGraphs()
+{
+	GraphRunner::waitForAll();
+}
+
+GraphRunner& getGraphRunner(const Node::Ptr& anyNode)
+{
+	waitForGraph(anyNode);
+	if (anyNode->executionPlan == nullptr) {
+		// Graph has never been run, an invalid plan carries its runner until the first run
+		auto plan = std::make_shared<ExecutionPlan>();
+		plan->runner = std::make_shared<GraphRunner>();
+		plan->invalidate();
+		for (auto&& node : findConnectedNodes(anyNode)) {
+			node->executionPlan = plan;
+		}
+	}
+	return *anyNode->executionPlan->runner;
+}
+
+void setGraphCaptureEnabled(const Node::Ptr& anyNode, bool enabled)
+{
+	getGraphRunner(anyNode).setCaptureEnabled(enabled);
+}
+
+void setGraphPipelineDepth(const Node::Ptr& anyNode, int depth)
+{
+	getGraphRunner(anyNode).setPipelineDepth(depth);
+}
+
+int64_t getGraphLastFrameId(const Node::Ptr& anyNode)
+{
+	return anyNode->getExecutionPlan() == nullptr ? -1 : anyNode->getExecutionPlan()->runner->getLastFrameId();
+}
+
+VArray::ConstPtr getGraphFrameResult(const YieldPointsNode::Ptr& yieldNode, int64_t frameId, rgl_field_t field)
+{
+	if (yieldNode->getExecutionPlan() == nullptr) {
+		throw std::invalid_argument(fmt::format("frame {} has not been run yet", frameId));
+	}
+	yieldNode->getExecutionPlan()->runner->waitForFrame(frameId);
+	return yieldNode->getFrameFieldData(frameId, field);
+}
+
+void setGraphProfilingEnabled(const Node::Ptr& anyNode, bool enabled, std::size_t windowSize)
+{
+	getGraphRunner(anyNode).getProfiler().configure(enabled, windowSize);
+}
+
+std::vector<GraphProfiler::Profile> getGraphProfile(const Node::Ptr& anyNode)
+{
+	return getGraphRunner(anyNode).getProfiler().getProfiles();
+}
+
+void writeGraphProfileTrace(const Node::Ptr& anyNode, const std::filesystem::path& path)
+{
+	getGraphRunner(anyNode).getProfiler().writeChromeTrace(path);
+}
+
+void setGraphCapacityPolicy(const Node::Ptr& anyNode, const MemoryTracker::CapacityPolicy& policy)
+{
+	getGraphRunner(anyNode).getMemoryTracker().setPolicy(policy);
+}
+
+MemoryTracker::Stats getGraphMemoryStats(const Node::Ptr& anyNode, MemLoc location)
+{
+	return getGraphRunner(anyNode).getMemoryTracker().getStats(location);
+}
+
+static ResultBindings& getResultBindings(const Node::Ptr& node, rgl_field_t field)
+{
+	if (auto yieldNode = std::dynamic_pointer_cast<YieldPointsNode>(node)) {
+		auto fields = yieldNode->getRequiredFieldList();
+		if (std::find(fields.begin(), fields.end(), field) == fields.end()) {
+			throw InvalidAPIArgument(fmt::format("YieldPointsNode does not yield field {}", toString(field)));
+		}
+		return yieldNode->getResultBindings();
+	}
+	if (auto formatNode = std::dynamic_pointer_cast<FormatPointsNode>(node)) {
+		if (field != RGL_FIELD_DYNAMIC_FORMAT) {
+			throw InvalidAPIArgument("FormatPointsNode writes only field RGL_FIELD_DYNAMIC_FORMAT to result buffers");
+		}
+		return formatNode->getResultBindings();
+	}
+	throw InvalidAPIArgument("result buffers can be bound only to YieldPointsNode or FormatPointsNode");
+}
+
+static void waitForGraphScheduling(const Node::Ptr& anyNode)
+{
+	if (anyNode->getExecutionPlan() != nullptr) {
+		anyNode->getExecutionPlan()->runner->waitForScheduling();
+	}
+}
+
+void bindGraphResultBuffer(const Node::Ptr& node, rgl_field_t field, void* buffer, std::size_t capacityBytes, rgl_result_buffer_t type)
+{
+	ResultBindings& bindings = getResultBindings(node, field);
+	waitForGraph(node);
+	bindings.bind(field, buffer, capacityBytes, type);
+}
+
+cudaEvent_t getGraphResultBufferEvent(const Node::Ptr& node, rgl_field_t field)
+{
+	ResultBindings& bindings = getResultBindings(node, field);
+	waitForGraphScheduling(node);
+	return bindings.getWrittenEvent(field);
+}
+
+int32_t getGraphResultBufferPointCount(const Node::Ptr& node, rgl_field_t field)
+{
+	ResultBindings& bindings = getResultBindings(node, field);
+	waitForGraphScheduling(node);
+	return bindings.getWrittenPointCount(field);
+}
+
+void copyGraphFrameResult(const YieldPointsNode::Ptr& yieldNode, int64_t frameId, rgl_field_t field, void* dst)
+{
+	VArray::ConstPtr result = getGraphFrameResult(yieldNode, frameId, field);
+	cudaStream_t stream = yieldNode->getExecutionPlan()->runner->getReadbackStream();
+	std::size_t byteCount = result->getElemCount() * result->getElemSize();
+	CHECK_CUDA(cudaMemcpyAsync(dst, result->getReadPtr(MemLoc::Device, stream), byteCount, cudaMemcpyDefault, stream));
+	CHECK_CUDA(cudaStreamSynchronize(stream));
 }
 
 void destroyGraph(Node::Ptr userNode)
@@ -114,6 +434,8 @@ void destroyGraph(Node::Ptr userNode)
 		Node::Ptr node = *graph.begin();
 		RGL_DEBUG("Destroying node {}", (void*) node.get());
 		graph.erase(node);
+		node->invalidateExecutionPlan();
+		node->executionPlan.reset();
 		node->inputs.clear();
 		node->outputs.clear();
 		Node::release(node.get());
@@ -12,8 +12,74 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#pragma once
+
+#include <set>
+#include <vector>
+
 #include <graph/Node.hpp>
+#include <graph/Nodes.hpp>
+#include <graph/GraphRunner.hpp>
+#include <graph/BranchPlan.hpp>
+
+/**
+ * Result of analysing and validating a connected graph, reused by runGraph() until the graph changes.
+ * Holds the nodes, so invalidation releases them to avoid a reference cycle.
+ */
+struct ExecutionPlan
+{
+	std::size_t id {0};  // Unique among built plans
+	std::vector<Node::Ptr> nodesInExecOrder;
+	BranchPlan branchPlan;  // Refers to nodes by their index in nodesInExecOrder
+	GraphRunner::Ptr runner;  // Outlives invalidation, so that the graph keeps its worker thread and stream
+
+	bool isValid() const { return valid; }
+	void invalidate() { valid = false; nodesInExecOrder.clear(); }
+
+private:
+	bool valid {true};
+};
 
 std::set<Node::Ptr> findConnectedNodes(Node::Ptr anyNode);
+std::shared_ptr<ExecutionPlan> buildExecutionPlan(Node::Ptr userNode);
+
+// Validates the graph if needed and starts its asynchronous execution.
 void runGraph(Node::Ptr userNode);
+
+// Blocks until the last run of the graph is finished; no-op for graphs that were never run.
+void waitForGraph(const Node::Ptr& anyNode);
+bool isGraphDone(const Node::Ptr& anyNode);
+
+// Must be called before releasing state which running graphs may use, e.g. on cleanup.
+void waitForAllGraphs();
+
+// Creates the runner of a graph that was never run, so that it can be configured beforehand.
+GraphRunner& getGraphRunner(const Node::Ptr& anyNode);
+
+// Enables recording the graph into a CUDA graph once it is stable, and replaying it afterwards (see GraphCapture).
+void setGraphCaptureEnabled(const Node::Ptr& anyNode, bool enabled);
+
+// Allows starting runs before the previous ones are finished, see GraphRunner.
+void setGraphPipelineDepth(const Node::Ptr& anyNode, int depth);
+int64_t getGraphLastFrameId(const Node::Ptr& anyNode);
+
+// Waits only for the given frame, hence results of older frames may be read while newer ones are in flight.
+VArray::ConstPtr getGraphFrameResult(const YieldPointsNode::Ptr& yieldNode, int64_t frameId, rgl_field_t field);
+void copyGraphFrameResult(const YieldPointsNode::Ptr& yieldNode, int64_t frameId, rgl_field_t field, void* dst);
+
+// Profiling settings and results are kept by the graph's runner, see GraphProfiler; these wait for the graph first.
+void setGraphProfilingEnabled(const Node::Ptr& anyNode, bool enabled, std::size_t windowSize);
+std::vector<GraphProfiler::Profile> getGraphProfile(const Node::Ptr& anyNode);
+void writeGraphProfileTrace(const Node::Ptr& anyNode, const std::filesystem::path& path);
+
+// Memory of arrays used by the graph is accounted by its runner's MemoryTracker; these wait for the graph first.
+void setGraphCapacityPolicy(const Node::Ptr& anyNode, const MemoryTracker::CapacityPolicy& policy);
+MemoryTracker::Stats getGraphMemoryStats(const Node::Ptr& anyNode, MemLoc location);
+
+// User buffers written by YieldPointsNodes and FormatPointsNodes, see ResultBindings. Binding waits for the graph first.
+// The event and the point count refer to the last run; they wait only for its scheduling.
+void bindGraphResultBuffer(const Node::Ptr& node, rgl_field_t field, void* buffer, std::size_t capacityBytes, rgl_result_buffer_t type);
+cudaEvent_t getGraphResultBufferEvent(const Node::Ptr& node, rgl_field_t field);
+int32_t getGraphResultBufferPointCount(const Node::Ptr& node, rgl_field_t field);
+
 void destroyGraph(Node::Ptr userNode);
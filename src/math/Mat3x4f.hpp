@@ -167,6 +167,25 @@ struct Mat3x4f
 		};
 	}
 
+	// Inverse of the affine transform; the 3x3 part is assumed to be invertible.
+	inline Mat3x4f inverse() const
+	{
+		// Inverse of the 3x3 part from cofactors, translation is transformed back by it
+		float c00 = rc[1][1] * rc[2][2] - rc[1][2] * rc[2][1];
+		float c01 = rc[1][2] * rc[2][0] - rc[1][0] * rc[2][2];
+		float c02 = rc[1][0] * rc[2][1] - rc[1][1] * rc[2][0];
+		float invDet = 1.0f / (rc[0][0] * c00 + rc[0][1] * c01 + rc[0][2] * c02);
+		Mat3x4f inv = {
+			c00 * invDet, (rc[0][2] * rc[2][1] - rc[0][1] * rc[2][2]) * invDet, (rc[0][1] * rc[1][2] - rc[0][2] * rc[1][1]) * invDet, 0,
+			c01 * invDet, (rc[0][0] * rc[2][2] - rc[0][2] * rc[2][0]) * invDet, (rc[0][2] * rc[1][0] - rc[0][0] * rc[1][2]) * invDet, 0,
+			c02 * invDet, (rc[0][1] * rc[2][0] - rc[0][0] * rc[2][1]) * invDet, (rc[0][0] * rc[1][1] - rc[0][1] * rc[1][0]) * invDet, 0
+		};
+		for (int y = 0; y < ROWS; ++y) {
+			inv.rc[y][3] = -(inv.rc[y][0] * rc[0][3] + inv.rc[y][1] * rc[1][3] + inv.rc[y][2] * rc[2][3]);
+		}
+		return inv;
+	}
+
 	inline Mat3x4f& operator=(const Mat3x4f& other) = default;
 
 	__host__ __device__ float& operator[](int i) {return rc[i/4][i%4];}
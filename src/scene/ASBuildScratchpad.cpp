@@ -22,29 +22,32 @@ bool ASBuildScratchpad::resizeToFit(OptixBuildInput input, OptixAccelBuildOption
 	OptixAccelBufferSizes bufferSizes;
 	CHECK_OPTIX(optixAccelComputeMemoryUsage(Optix::getOrCreate().context, &options, &input, 1, &bufferSizes));
 
+	// Refit (update) operation requires a different amount of temporary memory than the build
+	bool isUpdate = options.operation == OPTIX_BUILD_OPERATION_UPDATE;
+	std::size_t tempSizeInBytes = isUpdate ? bufferSizes.tempUpdateSizeInBytes : bufferSizes.tempSizeInBytes;
+
         // Short-circuit evaluation workaround
-        bool dTempResizeResult = dTemp.resizeToFit(bufferSizes.tempSizeInBytes);
+        bool dTempResizeResult = dTemp.resizeToFit(tempSizeInBytes);
         bool dFullResizeResult = dFull.resizeToFit(bufferSizes.outputSizeInBytes);
         bool dCompactedSizeResizeResult = dCompactedSize.resizeToFit(1);
 
 	return dTempResizeResult || dFullResizeResult || dCompactedSizeResizeResult;
 }
 
-void ASBuildScratchpad::doCompaction(OptixTraversableHandle &handle)
+void ASBuildScratchpad::doCompaction(OptixTraversableHandle &handle, cudaStream_t stream)
 {
 	throw std::runtime_error("AS compaction is disabled due to performance reasons");
 	// TODO(prybicki): Too many lines for getting a number from GPU :(
 	// TODO(prybicki): Some time later, it turns out that this communication (async cpy + sync) is killing perf
 	// TODO(prybicki): This should remain disabled, until a real-world memory management subsystem is implemented
-	// TODO(prybicki): Copy here should be not async...
 	HostPinnedBuffer<uint64_t> hCompactedSize;
-	hCompactedSize.copyFromDeviceAsync(dCompactedSize, nullptr); // TODO: stream
-	CHECK_CUDA(cudaStreamSynchronize(nullptr));
+	hCompactedSize.copyFromDeviceAsync(dCompactedSize, stream);
+	CHECK_CUDA(cudaStreamSynchronize(stream));
 	uint64_t compactedSize = *hCompactedSize.readHost();
 
 	dCompact.resizeToFit(compactedSize);
 	CHECK_OPTIX(optixAccelCompact(Optix::getOrCreate().context,
-	                              nullptr, // TODO: stream
+	                              stream,
 	                              handle,
 	                              dCompact.readDeviceRaw(),
 	                              dCompact.getByteSize(),
@@ -25,7 +25,7 @@
 struct ASBuildScratchpad
 {
 	bool resizeToFit(OptixBuildInput input, OptixAccelBuildOptions options);
-	void doCompaction(OptixTraversableHandle& handle);
+	void doCompaction(OptixTraversableHandle& handle, cudaStream_t stream);
 
 private:
 	DeviceBuffer<uint64_t> dCompactedSize;
@@ -33,7 +33,7 @@ private:
 	DeviceBuffer<std::byte> dFull;
 	DeviceBuffer<std::byte> dCompact;
 
-	friend struct Mesh;
+	friend struct MeshGeometry;
 	friend struct Object;
 	friend struct Scene;
 };
@@ -14,31 +14,84 @@
 
 #include <scene/Entity.hpp>
 
+#include <algorithm>
+
 API_OBJECT_INSTANCE(Entity);
 
 Entity::Entity(std::shared_ptr<Mesh> mesh, std::optional<std::string> name)
 : mesh(std::move(mesh))
-, transform(Mat3x4f::identity())
+, pose({.transform = Mat3x4f::identity()})
 , humanReadableName(std::move(name))
-, laser_retro(DEFAULT_LASER_RETRO) { }
+, laser_retro(DEFAULT_LASER_RETRO)
+{
+	this->mesh->attachEntity(this);
+}
+
+Entity::~Entity()
+{
+	mesh->detachEntity(this);
+}
 
 void Entity::setTransform(Mat3x4f newTransform)
 {
-	transform = newTransform;
-	if (auto activeScene = scene.lock()) {
-		activeScene->requestASRebuild();
+	auto activeScene = scene.lock();
+	auto sceneLock = activeScene != nullptr ? activeScene->lock() : std::unique_lock<std::recursive_mutex> {};
+	pose = Pose {.transform = newTransform};
+	if (activeScene != nullptr) {
+		activeScene->requestASRefit(this);
 	}
 }
 
+void Entity::setTransformMotion(Mat3x4f beginTransform, Mat3x4f endTransform, float timeBegin, float timeEnd)
+{
+	if (!(timeBegin < timeEnd)) {
+		auto msg = fmt::format("motion time range must not be empty, got [{}, {}]", timeBegin, timeEnd);
+		throw std::invalid_argument(msg);
+	}
+	auto activeScene = scene.lock();
+	auto sceneLock = activeScene != nullptr ? activeScene->lock() : std::unique_lock<std::recursive_mutex> {};
+	pose = Pose {
+		.transform = beginTransform,
+		.motion = Pose::Motion {
+			.endTransform = endTransform,
+			.timeBegin = timeBegin,
+			.timeEnd = timeEnd,
+		},
+	};
+	if (activeScene != nullptr) {
+		activeScene->requestASRefit(this);
+	}
+}
+
+Mat3x4f Entity::Pose::getTransformAt(float time) const
+{
+	if (!motion.has_value()) {
+		return transform;
+	}
+	float t = std::clamp((time - motion->timeBegin) / (motion->timeEnd - motion->timeBegin), 0.0f, 1.0f);
+	Mat3x4f interpolated {};
+	for (int i = 0; i < Mat3x4f::ROWS * Mat3x4f::COLS; ++i) {
+		interpolated[i] = (1.0f - t) * transform[i] + t * motion->endTransform[i];
+	}
+	return interpolated;
+}
+
+std::array<Mat3x4f, 2> Entity::Pose::getTransformKeys() const
+{
+	return {transform, motion.has_value() ? motion->endTransform : transform};
+}
+
 void Entity::setLaserRetro(float retro)
 {
+	auto activeScene = scene.lock();
+	auto sceneLock = activeScene != nullptr ? activeScene->lock() : std::unique_lock<std::recursive_mutex> {};
 	laser_retro = retro;
-	if (auto activeScene = scene.lock()) {
-		activeScene->requestASRebuild();
+	if (activeScene != nullptr) {
+		activeScene->requestSBTUpdate(this);
 	}
 }
 
-OptixInstance Entity::getIAS(int idx)
+OptixInstance Entity::getIAS(int idx, cudaStream_t stream)
 {
 	// NOTE: this assumes a single SBT record per GAS
 	OptixInstance instance = {
@@ -46,8 +99,27 @@ OptixInstance Entity::getIAS(int idx)
 		.sbtOffset = static_cast<unsigned int>(idx),
 		.visibilityMask = 255,
 		.flags = OPTIX_INSTANCE_FLAG_DISABLE_ANYHIT,
-		.traversableHandle = mesh->getGAS(),
+		.traversableHandle = mesh->getGAS(stream),
 	};
-	transform.toRaw(instance.transform);
+	pose.transform.toRaw(instance.transform);
 	return instance;
 }
+
+OptixMatrixMotionTransform Entity::getMotionTransform(cudaStream_t stream)
+{
+	if (!pose.motion.has_value()) {
+		throw std::logic_error("requested motion transform of a static entity");
+	}
+	OptixMatrixMotionTransform motionTransform = {
+		.child = mesh->getGAS(stream),
+		.motionOptions = {
+			.numKeys = 2,
+			.flags = OPTIX_MOTION_FLAG_NONE,
+			.timeBegin = pose.motion->timeBegin,
+			.timeEnd = pose.motion->timeEnd,
+		},
+	};
+	pose.transform.toRaw(motionTransform.transform[0]);
+	pose.motion->endTransform.toRaw(motionTransform.transform[1]);
+	return motionTransform;
+}
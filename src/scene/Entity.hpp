@@ -17,6 +17,8 @@
 #include <scene/Scene.hpp>
 #include <scene/Mesh.hpp>
 #include <APIObject.hpp>
+#include <array>
+#include <optional>
 #include <utility>
 #include <math/Mat3x4f.hpp>
 
@@ -24,19 +26,56 @@ constexpr float DEFAULT_LASER_RETRO = 100.0;
 
 struct Entity : APIObject<Entity>
 {
+	/**
+	 * Placement of the entity, static or moving linearly between two transforms.
+	 * Copied by consumers tracing the scene after releasing its lock (e.g. CPU raytracing).
+	 */
+	struct Pose
+	{
+		struct Motion
+		{
+			Mat3x4f endTransform;
+			float timeBegin;
+			float timeEnd;
+		};
+
+		Mat3x4f transform;  // Begin transform of a moving entity
+		std::optional<Motion> motion;
+
+		bool isMoving() const { return motion.has_value(); }
+
+		// Transform at the given time, interpolated the same way OptiX interpolates matrix motion transforms.
+		Mat3x4f getTransformAt(float time) const;
+
+		// Transforms at the beginning and at the end of the motion; both are equal for static entities.
+		std::array<Mat3x4f, 2> getTransformKeys() const;
+	};
+
 	Entity(std::shared_ptr<Mesh> mesh, std::optional<std::string> name=std::nullopt);
+	~Entity();
 
-	// TODO(prybicki): low-prio optimization: do not rebuild whole IAS if only transform changed
+	// Setters modify the entity under the lock of its scene, since graphs may be updating the scene meanwhile.
 	void setTransform(Mat3x4f newTransform);
-	OptixInstance getIAS(int idx);
+
+	// Entity moves linearly from beginTransform at timeBegin to endTransform at timeEnd; its pose is clamped outside that range.
+	// Rays intersect the entity at its pose interpolated for their time offset. setTransform() makes the entity static again.
+	void setTransformMotion(Mat3x4f beginTransform, Mat3x4f endTransform, float timeBegin, float timeEnd);
+	bool isMoving() const { return pose.isMoving(); }
+	const Pose& getPose() const { return pose; }
+
+	OptixInstance getIAS(int idx, cudaStream_t stream);
+	OptixMatrixMotionTransform getMotionTransform(cudaStream_t stream);
 	void setLaserRetro(float retro);
-	const float getLaserRetro() { return laser_retro;}
+	float getLaserRetro() const { return laser_retro; }
 	std::shared_ptr<Mesh> mesh;
 	std::weak_ptr<Scene> scene;
 private:
-	Mat3x4f transform;
+	Pose pose;
 	float laser_retro;
+	std::size_t sceneSlot {0}; // Stable index in the scene's instance table and SBT, assigned by Scene::addEntity
+
 	std::optional<std::string> humanReadableName;
 	friend struct APIObject<Entity>;
 	friend struct Scene;
+	friend struct Mesh;
 };
@@ -0,0 +1,85 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <scene/GASBatchBuilder.hpp>
+#include <scene/MeshGeometry.hpp>
+
+static std::size_t alignUp(std::size_t value, std::size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void GASBatchBuilder::build(const std::vector<std::shared_ptr<MeshGeometry>>& meshes, cudaStream_t stream)
+{
+	if (meshes.empty()) {
+		return;
+	}
+
+	std::vector<OptixAccelBufferSizes> bufferSizes(meshes.size());
+	std::vector<std::size_t> outputOffsets(meshes.size());
+	std::size_t tempSize = 0;
+	std::size_t arenaSize = 0;
+	for (std::size_t i = 0; i < meshes.size(); ++i) {
+		if (meshes[i]->backVerticesPending) {
+			meshes[i]->promoteBackVertices(stream);
+		}
+		meshes[i]->initBuildInput();
+		CHECK_OPTIX(optixAccelComputeMemoryUsage(Optix::getOrCreate().context,
+		                                         &meshes[i]->buildOptions,
+		                                         &meshes[i]->buildInput,
+		                                         1,
+		                                         &bufferSizes[i]));
+		outputOffsets[i] = arenaSize;
+		arenaSize += alignUp(bufferSizes[i].outputSizeInBytes, OPTIX_ACCEL_BUFFER_BYTE_ALIGNMENT);
+		tempSize = std::max(tempSize, bufferSizes[i].tempSizeInBytes);
+	}
+
+	// Builds are serialized by the stream, so the temporary buffer can be shared
+	dTemp.resizeToFit(tempSize);
+	dCompactedSizes.resizeToFit(meshes.size());
+	auto arena = std::make_shared<DeviceBuffer<std::byte>>();
+	arena->resizeToFit(arenaSize);
+
+	for (std::size_t i = 0; i < meshes.size(); ++i) {
+		auto& mesh = meshes[i];
+		std::lock_guard meshLock {mesh->mutex};
+		mesh->gasArena = arena;
+		mesh->gasBuffer = arena->readDeviceRaw() + outputOffsets[i];
+		mesh->gasBufferSize = bufferSizes[i].outputSizeInBytes;
+
+		OptixAccelEmitDesc emitDesc = {
+			.result = dCompactedSizes.readDeviceRaw() + i * sizeof(uint64_t),
+			.type = OPTIX_PROPERTY_TYPE_COMPACTED_SIZE,
+		};
+
+		OptixTraversableHandle gasHandle;
+		CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
+		                            stream,
+		                            &mesh->buildOptions,
+		                            &mesh->buildInput,
+		                            1,
+		                            dTemp.readDeviceRaw(),
+		                            dTemp.getByteSize(),
+		                            mesh->gasBuffer,
+		                            mesh->gasBufferSize,
+		                            &gasHandle,
+		                            &emitDesc,
+		                            1
+		));
+		mesh->cachedGAS = gasHandle;
+		// Vertices uploaded since the build input was made are promoted and refitted by the next getGAS()
+		mesh->gasNeedsUpdate = mesh->backVerticesPending;
+	}
+	RGL_DEBUG("Built {} GASes in a batch, arena size: {} bytes", meshes.size(), arenaSize);
+}
@@ -0,0 +1,41 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <DeviceBuffer.hpp>
+
+struct MeshGeometry;
+
+/**
+ * Builds GASes of many meshes in a single pass.
+ * Memory requirements of all meshes are queried upfront, so that a single temporary buffer (reused between builds)
+ * and a single output arena (shared by all meshes of the batch) are allocated. Builds are enqueued back-to-back.
+ * The arena is released when the last mesh using it is destroyed or rebuilt (or compacted).
+ * Compacted sizes of built GASes are emitted to a device buffer, to be consumed by GASCompactor.
+ */
+struct GASBatchBuilder
+{
+	void build(const std::vector<std::shared_ptr<MeshGeometry>>& meshes, cudaStream_t stream);
+
+	// Valid for work enqueued in the stream after the last build() and before the next one.
+	const DeviceBuffer<uint64_t>& getCompactedSizes() const { return dCompactedSizes; }
+
+private:
+	DeviceBuffer<std::byte> dTemp;
+	DeviceBuffer<uint64_t> dCompactedSizes;
+};
@@ -0,0 +1,69 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Decides which GAS arenas should be compacted.
+ * Compaction costs a build-sized copy and invalidates the IAS, so only arenas whose meshes have not been modified
+ * for a number of frames are considered, and only as long as GAS memory usage exceeds the budget.
+ */
+struct GASCompactionPolicy
+{
+	static constexpr std::size_t DEFAULT_STABLE_FRAME_COUNT = 30;
+	static constexpr std::size_t DEFAULT_MEMORY_BUDGET = 0; // Compact every stable GAS
+
+	struct Candidate
+	{
+		std::size_t size;
+		std::size_t compactedSize;
+		std::size_t stableFrameCount; // Frames since the last modification of any GAS in the arena
+		bool isCompactedSizeKnown;    // Readback of compacted sizes has completed
+	};
+
+	std::size_t stableFrameCount {DEFAULT_STABLE_FRAME_COUNT};
+	std::size_t memoryBudget {DEFAULT_MEMORY_BUDGET};
+
+	// Returns indices of candidates to compact, largest savings first, until the given memory usage fits the budget.
+	std::vector<std::size_t> select(const std::vector<Candidate>& candidates, std::size_t memoryUsage) const
+	{
+		std::vector<std::size_t> eligible;
+		for (std::size_t i = 0; i < candidates.size(); ++i) {
+			const auto& candidate = candidates[i];
+			if (candidate.isCompactedSizeKnown
+			 && candidate.stableFrameCount >= stableFrameCount
+			 && candidate.compactedSize < candidate.size) {
+				eligible.push_back(i);
+			}
+		}
+		auto savings = [&](std::size_t idx) { return candidates[idx].size - candidates[idx].compactedSize; };
+		std::stable_sort(eligible.begin(), eligible.end(), [&](std::size_t lhs, std::size_t rhs) {
+			return savings(lhs) > savings(rhs);
+		});
+
+		std::vector<std::size_t> selected;
+		for (auto&& idx : eligible) {
+			if (memoryUsage <= memoryBudget) {
+				break;
+			}
+			selected.push_back(idx);
+			memoryUsage -= savings(idx);
+		}
+		return selected;
+	}
+};
@@ -0,0 +1,146 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <scene/GASCompactor.hpp>
+#include <scene/MeshGeometry.hpp>
+
+#include <cstdint>
+
+static std::size_t alignUp(std::size_t value, std::size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+GASCompactor::Readback::Readback()
+{
+	CHECK_CUDA(cudaEventCreateWithFlags(&readyEvent, cudaEventDisableTiming));
+}
+
+GASCompactor::Readback::~Readback()
+{
+	if (readyEvent != nullptr) {
+		cudaEventDestroy(readyEvent);
+		readyEvent = nullptr;
+	}
+}
+
+void GASCompactor::track(const std::vector<std::shared_ptr<MeshGeometry>>& meshes, const DeviceBuffer<uint64_t>& dCompactedSizes, cudaStream_t stream)
+{
+	if (meshes.empty()) {
+		return;
+	}
+	auto readback = std::make_shared<Readback>();
+	readback->hCompactedSizes.copyFromDeviceAsync(dCompactedSizes, stream);
+	CHECK_CUDA(cudaEventRecord(readback->readyEvent, stream));
+
+	// All meshes of a batch share a single arena
+	TrackedArena tracked {.arena = meshes.front()->gasArena};
+	for (std::size_t i = 0; i < meshes.size(); ++i) {
+		tracked.meshes.push_back({
+			.mesh = meshes[i],
+			.readback = readback,
+			.readbackIdx = i,
+			.gasUpdateCount = meshes[i]->gasUpdateCount,
+			.stableFrameCount = 0,
+		});
+	}
+	arenas.push_back(std::move(tracked));
+}
+
+bool GASCompactor::isCompactionDue(std::size_t runCount)
+{
+	// The AS may be updated many times per run (e.g. by several graphs), or not at all in some runs
+	std::size_t elapsedRuns = runCount - lastRunCount;
+	lastRunCount = runCount;
+	arenasToCompact.clear();
+	std::vector<GASCompactionPolicy::Candidate> candidates;
+	std::size_t memoryUsage = 0;
+	for (auto it = arenas.begin(); it != arenas.end();) {
+		auto arena = it->arena.lock();
+		// Forget meshes which have been destroyed or rebuilt into another buffer
+		std::erase_if(it->meshes, [&](const TrackedMesh& tracked) {
+			auto mesh = tracked.mesh.lock();
+			return mesh == nullptr || mesh->gasArena != arena;
+		});
+		if (arena == nullptr || it->meshes.empty()) {
+			it = arenas.erase(it);
+			continue;
+		}
+
+		GASCompactionPolicy::Candidate candidate {
+			.size = arena->getByteSize(),
+			.compactedSize = 0,
+			.stableFrameCount = SIZE_MAX,
+			.isCompactedSizeKnown = cudaEventQuery(it->meshes.front().readback->readyEvent) == cudaSuccess,
+		};
+		for (auto&& tracked : it->meshes) {
+			auto mesh = tracked.mesh.lock();
+			if (mesh->gasUpdateCount != tracked.gasUpdateCount) {
+				tracked.gasUpdateCount = mesh->gasUpdateCount;
+				tracked.stableFrameCount = 0;
+			}
+			else {
+				tracked.stableFrameCount += elapsedRuns;
+			}
+			candidate.stableFrameCount = std::min(candidate.stableFrameCount, tracked.stableFrameCount);
+			if (candidate.isCompactedSizeKnown) {
+				auto compactedSize = tracked.readback->hCompactedSizes.readHost()[tracked.readbackIdx];
+				candidate.compactedSize += alignUp(compactedSize, OPTIX_ACCEL_BUFFER_BYTE_ALIGNMENT);
+			}
+		}
+		memoryUsage += candidate.size;
+		candidates.push_back(candidate);
+		++it;
+	}
+	arenasToCompact = policy.select(candidates, memoryUsage);
+	return !arenasToCompact.empty();
+}
+
+void GASCompactor::compact(cudaStream_t stream)
+{
+	for (auto&& arenaIdx : arenasToCompact) {
+		auto& tracked = arenas[arenaIdx];
+		auto oldArena = tracked.arena.lock();
+		std::vector<std::size_t> offsets;
+		std::size_t compactedArenaSize = 0;
+		for (auto&& trackedMesh : tracked.meshes) {
+			offsets.push_back(compactedArenaSize);
+			auto compactedSize = trackedMesh.readback->hCompactedSizes.readHost()[trackedMesh.readbackIdx];
+			compactedArenaSize += alignUp(compactedSize, OPTIX_ACCEL_BUFFER_BYTE_ALIGNMENT);
+		}
+
+		auto compactedArena = std::make_shared<DeviceBuffer<std::byte>>();
+		compactedArena->resizeToFit(compactedArenaSize);
+		for (std::size_t i = 0; i < tracked.meshes.size(); ++i) {
+			auto mesh = tracked.meshes[i].mesh.lock();
+			mesh->gasBuffer = compactedArena->readDeviceRaw() + offsets[i];
+			mesh->gasBufferSize = tracked.meshes[i].readback->hCompactedSizes.readHost()[tracked.meshes[i].readbackIdx];
+			mesh->gasArena = compactedArena;
+			CHECK_OPTIX(optixAccelCompact(Optix::getOrCreate().context,
+			                              stream,
+			                              mesh->cachedGAS.value(),
+			                              mesh->gasBuffer,
+			                              mesh->gasBufferSize,
+			                              &mesh->cachedGAS.value()));
+		}
+		stats.compactedGASCount += tracked.meshes.size();
+		stats.bytesSaved += oldArena->getByteSize() - compactedArena->getByteSize();
+		RGL_DEBUG("Compacted {} GASes: {} -> {} bytes", tracked.meshes.size(), oldArena->getByteSize(), compactedArena->getByteSize());
+
+		// Compacted arena is not tracked anymore. The old one returns to the caching allocator here, which reuses it
+		// only after an event recorded in the legacy stream, i.e. after the copy and launches enqueued before it.
+		tracked.meshes.clear();
+	}
+	arenasToCompact.clear();
+}
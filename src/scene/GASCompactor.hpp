@@ -0,0 +1,86 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <DeviceBuffer.hpp>
+#include <HostPinnedBuffer.hpp>
+#include <scene/GASCompactionPolicy.hpp>
+
+struct MeshGeometry;
+
+/**
+ * Compacts GASes built by GASBatchBuilder in the background.
+ * Compacted sizes emitted by the batch build are read back asynchronously (pinned memory + event),
+ * so that no frame waits for them. Arenas are compacted as a whole, because their memory
+ * can be released only when none of their meshes uses it.
+ */
+struct GASCompactor
+{
+	struct Stats
+	{
+		std::size_t compactedGASCount {0};
+		std::size_t bytesSaved {0};
+	};
+
+	GASCompactor() = default;
+	GASCompactor(const GASCompactor&) = delete;
+	GASCompactor& operator=(const GASCompactor&) = delete;
+
+	// Schedules readback of compacted sizes emitted by the batch build of the given meshes (in the same order).
+	void track(const std::vector<std::shared_ptr<MeshGeometry>>& meshes, const DeviceBuffer<uint64_t>& dCompactedSizes, cudaStream_t stream);
+
+	// Called before every update of the AS with the number of graph runs so far, which is what stability is counted in;
+	// returns true if some arenas should be compacted now.
+	bool isCompactionDue(std::size_t runCount);
+
+	// Compacts arenas selected by the last isCompactionDue(); GAS handles of affected meshes change.
+	void compact(cudaStream_t stream);
+
+	void setPolicy(const GASCompactionPolicy& newPolicy) { policy = newPolicy; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct Readback
+	{
+		Readback();
+		~Readback();
+		HostPinnedBuffer<uint64_t> hCompactedSizes;
+		cudaEvent_t readyEvent {nullptr};
+	};
+
+	struct TrackedMesh
+	{
+		std::weak_ptr<MeshGeometry> mesh;
+		std::shared_ptr<Readback> readback;
+		std::size_t readbackIdx;
+		std::size_t gasUpdateCount; // Value of MeshGeometry::gasUpdateCount seen by the last isCompactionDue()
+		std::size_t stableFrameCount; // Graph runs since the GAS was last seen modified
+	};
+
+	struct TrackedArena
+	{
+		std::weak_ptr<DeviceBuffer<std::byte>> arena;
+		std::vector<TrackedMesh> meshes;
+	};
+
+	GASCompactionPolicy policy;
+	Stats stats;
+	std::vector<TrackedArena> arenas;
+	std::vector<std::size_t> arenasToCompact;
+	std::size_t lastRunCount {0};
+};
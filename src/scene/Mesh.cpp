@@ -13,128 +13,76 @@
 // limitations under the License.
 
 #include <scene/Mesh.hpp>
+#include <scene/MeshRegistry.hpp>
+#include <scene/Entity.hpp>
 
-#include <filesystem>
-
-namespace fs = std::filesystem;
+#include <algorithm>
 
 API_OBJECT_INSTANCE(Mesh);
 
 Mesh::Mesh(const Vec3f *vertices, size_t vertexCount, const Vec3i *indices, size_t indexCount)
+: geometry(MeshRegistry::instance().getOrCreate(vertices, vertexCount, indices, indexCount))
 {
-	dVertices.copyFromHost(vertices, vertexCount);
-	dIndices.copyFromHost(indices, indexCount);
+	geometry->meshCount += 1;
 }
 
-void Mesh::updateVertices(const Vec3f *vertices, std::size_t vertexCount)
+Mesh::~Mesh()
 {
-	if (dVertices.getElemCount() != vertexCount) {
-		auto msg = fmt::format("Invalid argument: cannot update vertices because vertex counts do not match: old={}, new={}",
-		                        dVertices.getElemCount(), vertexCount);
-		throw std::invalid_argument(msg);
-	}
-	dVertices.copyFromHost(vertices, vertexCount);
-	gasNeedsUpdate = true;
+	geometry->meshCount -= 1;
 }
 
-OptixTraversableHandle Mesh::getGAS()
+std::shared_ptr<MeshGeometry> Mesh::getGeometry() const
 {
-	if (!cachedGAS.has_value()) {
-		cachedGAS = buildGAS();
-	}
-	if (gasNeedsUpdate) {
-		updateGAS();
-	}
-	return *cachedGAS;
+	std::lock_guard lock {mutex};
+	return geometry;
 }
 
-void Mesh::updateGAS()
+void Mesh::attachEntity(const Entity* entity)
 {
-	OptixAccelBuildOptions updateOptions = buildOptions;
-	updateOptions.operation = OPTIX_BUILD_OPERATION_UPDATE;
-
-	// OptiX update disallows buffer sizes to change
-	OptixBuildInput updateInput = buildInput;
-	const CUdeviceptr vertexBuffers[1] = {dVertices.readDeviceRaw()};
-	updateInput.triangleArray.vertexBuffers = vertexBuffers;
-	updateInput.triangleArray.indexBuffer = dIndices.readDeviceRaw();
-
-	scratchpad.resizeToFit(updateInput, updateOptions);
-
-	// Fun fact: calling optixAccelBuild does not change anything visually, but introduces a significant slowdown
-	// Investigation is needed whether it needs to be called at all (OptiX documentation says yes, but it works without)
-	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
-	                            nullptr, // TODO: stream
-	                            &updateOptions,
-	                            &updateInput,
-	                            1,
-	                            scratchpad.dTemp.readDeviceRaw(),
-	                            scratchpad.dTemp.getByteSize(),
-	                            scratchpad.dFull.readDeviceRaw(),
-	                            scratchpad.dFull.getByteSize(),
-	                            &cachedGAS.value(),
-	                            nullptr, // &emitDesc,
-	                            0));
-
-	gasNeedsUpdate = false;
+	std::lock_guard lock {mutex};
+	entities.push_back(entity);
 }
 
-OptixTraversableHandle Mesh::buildGAS()
+void Mesh::detachEntity(const Entity* entity)
 {
-	triangleInputFlags = OPTIX_GEOMETRY_FLAG_DISABLE_ANYHIT;
-	vertexBuffers[0] = dVertices.readDeviceRaw();
-
-	buildInput = {
-		.type = OPTIX_BUILD_INPUT_TYPE_TRIANGLES,
-		.triangleArray = {
-			.vertexBuffers = vertexBuffers,
-			.numVertices = static_cast<unsigned int>(dVertices.getElemCount()),
-			.vertexFormat = OPTIX_VERTEX_FORMAT_FLOAT3,
-			.vertexStrideInBytes = sizeof(decltype(dVertices)::ValueType),
-			.indexBuffer = dIndices.readDeviceRaw(),
-			.numIndexTriplets = static_cast<unsigned int>(dIndices.getElemCount()),
-			.indexFormat = OPTIX_INDICES_FORMAT_UNSIGNED_INT3,
-			.indexStrideInBytes = sizeof(decltype(dIndices)::ValueType),
-			.flags = &triangleInputFlags,
-			.numSbtRecords = 1,
-			.sbtIndexOffsetBuffer = 0,
-			.sbtIndexOffsetSizeInBytes = 0,
-			.sbtIndexOffsetStrideInBytes = 0,
-		}
-	};
+	std::lock_guard lock {mutex};
+	std::erase(entities, entity);
+}
 
-	buildOptions = {
-		.buildFlags = OPTIX_BUILD_FLAG_PREFER_FAST_TRACE
-		              | OPTIX_BUILD_FLAG_ALLOW_UPDATE,
-		              // | OPTIX_BUILD_FLAG_ALLOW_COMPACTION, // Temporarily disabled
-		.operation = OPTIX_BUILD_OPERATION_BUILD
+void Mesh::updateVertices(const Vec3f *vertices, std::size_t vertexCount)
+{
+	struct SceneSlot
+	{
+		std::weak_ptr<Scene> scene;
+		std::size_t slot;
+		const Entity* entity;
 	};
-
-	scratchpad.resizeToFit(buildInput, buildOptions);
-
-	// OptixAccelEmitDesc emitDesc = {
-		// .result = scratchpad.dCompactedSize.readDeviceRaw(),
-		// .type = OPTIX_PROPERTY_TYPE_COMPACTED_SIZE,
-	// };
-
-	OptixTraversableHandle gasHandle;
-	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
-	                            nullptr, // TODO: stream
-	                            &buildOptions,
-	                            &buildInput,
-	                            1,
-	                            scratchpad.dTemp.readDeviceRaw(),
-	                            scratchpad.dTemp.getByteSize(),
-	                            scratchpad.dFull.readDeviceRaw(),
-	                            scratchpad.dFull.getByteSize(),
-	                            &gasHandle,
-	                            nullptr, // &emitDesc,
-	                            0
-	));
-
-	// Compaction yields around 10% of memory and slows down a lot (e.g. 500us per model)
-	// scratchpad.doCompaction(gasHandle);
-
-	gasNeedsUpdate = false;
-	return gasHandle;
+	std::vector<SceneSlot> usages;
+	bool geometryReplaced = false;
+	{
+		std::lock_guard lock {mutex};
+		if (geometry->getVertexCount() != vertexCount) {
+			auto msg = fmt::format("Invalid argument: cannot update vertices because vertex counts do not match: old={}, new={}",
+			                        geometry->getVertexCount(), vertexCount);
+			throw std::invalid_argument(msg);
+		}
+		if (geometry->getMeshCount() > 1) {
+			geometry->meshCount -= 1;
+			geometry = std::make_shared<MeshGeometry>(*geometry, vertices);
+			geometry->meshCount += 1;
+			geometryReplaced = true;
+		}
+		else {
+			geometry->updateVertices(vertices, vertexCount);
+		}
+		// Entities may be destroyed once the mutex is released, only their scenes are asked about them
+		for (auto&& entity : entities) {
+			usages.push_back({entity->scene, entity->sceneSlot, entity});
+		}
+	}
+	for (auto&& usage : usages) {
+		if (auto scene = usage.scene.lock()) {
+			scene->onMeshModified(usage.slot, usage.entity, geometryReplaced);
+		}
+	}
 }
@@ -15,45 +15,43 @@
 #pragma once
 
 #include <cstddef>
-
-#include <optix_stubs.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <APIObject.hpp>
-#include <gpu/Optix.hpp>
-#include <DeviceBuffer.hpp>
-#include <math/Vector.hpp>
-#include <macros/cuda.hpp>
-#include <macros/optix.hpp>
-#include <scene/ASBuildScratchpad.hpp>
-
-#include <filesystem>
+#include <scene/MeshGeometry.hpp>
 
+struct Entity;
 
+/**
+ * API-level mesh. Device buffers and GAS live in MeshGeometry, which may be shared
+ * with other meshes of identical content when deduplication is enabled in MeshRegistry.
+ * Mesh knows its entities and notifies their scenes of vertex updates, so that scenes do not have to look for changes.
+ */
 struct Mesh : APIObject<Mesh>
 {
+	~Mesh();
+
+	// Updating vertices of a geometry shared with other meshes makes a private copy of it first (copy-on-write).
 	void updateVertices(const Vec3f *vertices, std::size_t vertexCount);
-	OptixTraversableHandle getGAS();
+	OptixTraversableHandle getGAS(cudaStream_t stream) { return getGeometry()->getGAS(stream); }
+
+	// Geometry may be replaced by updateVertices() meanwhile, hence returned by value.
+	std::shared_ptr<MeshGeometry> getGeometry() const;
+
+	// Called by entities using the mesh on their construction and destruction.
+	void attachEntity(const Entity* entity);
+	void detachEntity(const Entity* entity);
 
 private:
 	Mesh(const Vec3f *vertices, std::size_t vertexCount,
 		 const Vec3i *indices, std::size_t indexCount);
 
-	OptixTraversableHandle buildGAS();
-	void updateGAS();
-
 private:
 	friend APIObject<Mesh>;
-	friend struct Scene;
-	ASBuildScratchpad scratchpad;
-	bool gasNeedsUpdate;
-	std::optional<OptixTraversableHandle> cachedGAS;
-	DeviceBuffer<Vec3f> dVertices;
-	DeviceBuffer<Vec3i> dIndices;
-
-	// Shared between buildGAS() and updateGAS()
-	OptixBuildInput buildInput;
-	CUdeviceptr vertexBuffers[1];
-	unsigned triangleInputFlags;
-	OptixAccelBuildOptions buildOptions;
-
+	// Scenes lock meshes of their entities while holding their own lock, hence the mesh is never locked while notifying them
+	mutable std::mutex mutex;
+	std::shared_ptr<MeshGeometry> geometry;
+	std::vector<const Entity*> entities;
 };
@@ -0,0 +1,249 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <scene/MeshGeometry.hpp>
+
+#include <cstring>
+#include <vector>
+
+MeshGeometry::MeshGeometry(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount)
+{
+	dVertices.copyFromHost(vertices, vertexCount);
+	dIndices.copyFromHost(indices, indexCount);
+}
+
+MeshGeometry::MeshGeometry(const MeshGeometry& other, const Vec3f *vertices)
+{
+	dVertices.copyFromHost(vertices, other.dVertices.getElemCount());
+	dIndices.copyFromDevice(other.dIndices);
+}
+
+MeshGeometry::VertexUpload::VertexUpload()
+{
+	CHECK_CUDA(cudaEventCreateWithFlags(&uploaded, cudaEventDisableTiming));
+	CHECK_CUDA(cudaEventCreateWithFlags(&promoted, cudaEventDisableTiming));
+}
+
+MeshGeometry::VertexUpload::~VertexUpload()
+{
+	cudaEventDestroy(uploaded);
+	cudaEventDestroy(promoted);
+}
+
+cudaStream_t MeshGeometry::getCopyStream()
+{
+	static cudaStream_t copyStream = []() {
+		cudaStream_t stream = nullptr;
+		CHECK_CUDA(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+		return stream;
+	}();
+	return copyStream;
+}
+
+void MeshGeometry::updateVertices(const Vec3f *vertices, std::size_t vertexCount)
+{
+	std::lock_guard lock {mutex};
+	if (vertexUpload == nullptr) {
+		vertexUpload = std::make_unique<VertexUpload>();
+	}
+	// Blocks only if the previous upload from the staging buffer is still in progress
+	CHECK_CUDA(cudaEventSynchronize(vertexUpload->uploaded));
+	vertexUpload->hStaging.copyFromHost(vertices, vertexCount);
+
+	// Previous promotion may still be reading the back buffer
+	CHECK_CUDA(cudaStreamWaitEvent(getCopyStream(), vertexUpload->promoted));
+	vertexUpload->dBackVertices.copyFromHostAsync(vertexUpload->hStaging, getCopyStream());
+	CHECK_CUDA(cudaEventRecord(vertexUpload->uploaded, getCopyStream()));
+
+	backVerticesPending = true;
+	gasNeedsUpdate = true;
+	contentHash.reset();
+	if (hostCopy != nullptr) {
+		hostCopy->vertices = std::make_shared<const std::vector<Vec3f>>(vertices, vertices + vertexCount);
+	}
+}
+
+void MeshGeometry::ensureHostCopy()
+{
+	if (hostCopy != nullptr) {
+		return;
+	}
+	hostCopy = std::make_unique<HostCopy>();
+	std::vector<Vec3f> vertices(dVertices.getElemCount());
+	hostCopy->indices.resize(dIndices.getElemCount());
+	// The latest vertices may not have reached the device yet, but the staging buffer holds them since the last update
+	if (vertexUpload != nullptr) {
+		const Vec3f* staged = vertexUpload->hStaging.readHost();
+		vertices.assign(staged, staged + vertexUpload->hStaging.getElemCount());
+	}
+	else {
+		dVertices.copyToHost(vertices.data());
+	}
+	hostCopy->vertices = std::make_shared<const std::vector<Vec3f>>(std::move(vertices));
+	dIndices.copyToHost(hostCopy->indices.data());
+}
+
+std::shared_ptr<const std::vector<Vec3f>> MeshGeometry::getHostVertices()
+{
+	std::lock_guard lock {mutex};
+	ensureHostCopy();
+	return hostCopy->vertices;
+}
+
+const std::vector<Vec3i>& MeshGeometry::getHostIndices()
+{
+	// Indices never change once copied
+	std::lock_guard lock {mutex};
+	ensureHostCopy();
+	return hostCopy->indices;
+}
+
+void MeshGeometry::promoteBackVertices(cudaStream_t stream)
+{
+	// Device-to-device copy keeps the front buffer address, so that SBT records stay valid
+	CHECK_CUDA(cudaStreamWaitEvent(stream, vertexUpload->uploaded));
+	dVertices.copyFromDeviceAsync(vertexUpload->dBackVertices, stream);
+	CHECK_CUDA(cudaEventRecord(vertexUpload->promoted, stream));
+	backVerticesPending = false;
+}
+
+bool MeshGeometry::contentEquals(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount) const
+{
+	if (dVertices.getElemCount() != vertexCount || dIndices.getElemCount() != indexCount) {
+		return false;
+	}
+	std::vector<Vec3f> hVertices(vertexCount);
+	std::vector<Vec3i> hIndices(indexCount);
+	dVertices.copyToHost(hVertices.data());
+	dIndices.copyToHost(hIndices.data());
+	return std::memcmp(hVertices.data(), vertices, vertexCount * sizeof(Vec3f)) == 0
+	    && std::memcmp(hIndices.data(), indices, indexCount * sizeof(Vec3i)) == 0;
+}
+
+OptixTraversableHandle MeshGeometry::getGAS(cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	if (backVerticesPending) {
+		promoteBackVertices(stream);
+	}
+	if (!cachedGAS.has_value()) {
+		cachedGAS = buildGAS(stream);
+	}
+	if (gasNeedsUpdate) {
+		updateGAS(stream);
+	}
+	return *cachedGAS;
+}
+
+void MeshGeometry::updateGAS(cudaStream_t stream)
+{
+	OptixAccelBuildOptions updateOptions = buildOptions;
+	updateOptions.operation = OPTIX_BUILD_OPERATION_UPDATE;
+
+	// OptiX update disallows buffer sizes to change
+	OptixBuildInput updateInput = buildInput;
+	const CUdeviceptr vertexBuffers[1] = {dVertices.readDeviceRaw()};
+	updateInput.triangleArray.vertexBuffers = vertexBuffers;
+	updateInput.triangleArray.indexBuffer = dIndices.readDeviceRaw();
+
+	// GAS output buffer is kept, only temporary memory is needed
+	OptixAccelBufferSizes bufferSizes;
+	CHECK_OPTIX(optixAccelComputeMemoryUsage(Optix::getOrCreate().context, &updateOptions, &updateInput, 1, &bufferSizes));
+	scratchpad.dTemp.resizeToFit(bufferSizes.tempUpdateSizeInBytes);
+
+	// Fun fact: calling optixAccelBuild does not change anything visually, but introduces a significant slowdown
+	// Investigation is needed whether it needs to be called at all (OptiX documentation says yes, but it works without)
+	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
+	                            stream,
+	                            &updateOptions,
+	                            &updateInput,
+	                            1,
+	                            scratchpad.dTemp.readDeviceRaw(),
+	                            scratchpad.dTemp.getByteSize(),
+	                            gasBuffer,
+	                            gasBufferSize,
+	                            &cachedGAS.value(),
+	                            nullptr, // &emitDesc,
+	                            0));
+
+	gasNeedsUpdate = false;
+	gasUpdateCount += 1;
+}
+
+void MeshGeometry::initBuildInput()
+{
+	triangleInputFlags = OPTIX_GEOMETRY_FLAG_DISABLE_ANYHIT;
+	vertexBuffers[0] = dVertices.readDeviceRaw();
+
+	buildInput = {
+		.type = OPTIX_BUILD_INPUT_TYPE_TRIANGLES,
+		.triangleArray = {
+			.vertexBuffers = vertexBuffers,
+			.numVertices = static_cast<unsigned int>(dVertices.getElemCount()),
+			.vertexFormat = OPTIX_VERTEX_FORMAT_FLOAT3,
+			.vertexStrideInBytes = sizeof(decltype(dVertices)::ValueType),
+			.indexBuffer = dIndices.readDeviceRaw(),
+			.numIndexTriplets = static_cast<unsigned int>(dIndices.getElemCount()),
+			.indexFormat = OPTIX_INDICES_FORMAT_UNSIGNED_INT3,
+			.indexStrideInBytes = sizeof(decltype(dIndices)::ValueType),
+			.flags = &triangleInputFlags,
+			.numSbtRecords = 1,
+			.sbtIndexOffsetBuffer = 0,
+			.sbtIndexOffsetSizeInBytes = 0,
+			.sbtIndexOffsetStrideInBytes = 0,
+		}
+	};
+
+	buildOptions = {
+		.buildFlags = OPTIX_BUILD_FLAG_PREFER_FAST_TRACE
+		              | OPTIX_BUILD_FLAG_ALLOW_UPDATE
+		              | OPTIX_BUILD_FLAG_ALLOW_COMPACTION, // Compaction is done by GASCompactor for batch-built GASes
+		.operation = OPTIX_BUILD_OPERATION_BUILD
+	};
+}
+
+OptixTraversableHandle MeshGeometry::buildGAS(cudaStream_t stream)
+{
+	initBuildInput();
+	scratchpad.resizeToFit(buildInput, buildOptions);
+	gasArena.reset();
+	gasBuffer = scratchpad.dFull.readDeviceRaw();
+	gasBufferSize = scratchpad.dFull.getByteSize();
+
+	// OptixAccelEmitDesc emitDesc = {
+		// .result = scratchpad.dCompactedSize.readDeviceRaw(),
+		// .type = OPTIX_PROPERTY_TYPE_COMPACTED_SIZE,
+	// };
+
+	OptixTraversableHandle gasHandle;
+	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
+	                            stream,
+	                            &buildOptions,
+	                            &buildInput,
+	                            1,
+	                            scratchpad.dTemp.readDeviceRaw(),
+	                            scratchpad.dTemp.getByteSize(),
+	                            gasBuffer,
+	                            gasBufferSize,
+	                            &gasHandle,
+	                            nullptr, // &emitDesc,
+	                            0
+	));
+
+	// Compaction yields around 10% of memory and slows down a lot (e.g. 500us per model)
+	// scratchpad.doCompaction(gasHandle, stream);
+
+	gasNeedsUpdate = false;
+	return gasHandle;
+}
@@ -0,0 +1,133 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <optix_stubs.h>
+
+#include <gpu/Optix.hpp>
+#include <DeviceBuffer.hpp>
+#include <HostPinnedBuffer.hpp>
+#include <math/Vector.hpp>
+#include <macros/cuda.hpp>
+#include <macros/optix.hpp>
+#include <scene/ASBuildScratchpad.hpp>
+
+/**
+ * Device-side part of a mesh: vertex and index buffers and the GAS built on them.
+ * Geometry may be shared by many meshes with identical content (see MeshRegistry).
+ * Vertices are updated by API calls while graphs may be building the GAS; the mutex of the geometry is never held
+ * while locking anything else.
+ */
+struct MeshGeometry
+{
+	MeshGeometry(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount);
+
+	// Creates a private copy of the given geometry with different vertices (copy-on-write)
+	MeshGeometry(const MeshGeometry& other, const Vec3f *vertices);
+
+	MeshGeometry(MeshGeometry&&) = delete;
+	MeshGeometry& operator=(const MeshGeometry&) = delete;
+	MeshGeometry& operator=(MeshGeometry&&) = delete;
+
+	// Vertices are uploaded asynchronously to a back buffer; they replace the current ones in the next getGAS().
+	void updateVertices(const Vec3f *vertices, std::size_t vertexCount);
+
+	// Enqueues promotion of pending vertices and GAS build / refit in the given stream.
+	OptixTraversableHandle getGAS(cudaStream_t stream);
+	bool hasGAS() const { return cachedGAS.has_value(); }
+
+	std::size_t getVertexCount() const { return dVertices.getElemCount(); }
+
+	// Host copy of the content, made on the first use by a host-side consumer (e.g. CPU raytracing) and then kept up to date.
+	// Vertex updates replace the vertices instead of modifying them, so that consumers may keep using their snapshot;
+	// consumers may also compare snapshots to detect stale data derived from vertices.
+	std::shared_ptr<const std::vector<Vec3f>> getHostVertices();
+	const std::vector<Vec3i>& getHostIndices();
+
+	// Compares content with the given host data; requires a device -> host copy.
+	bool contentEquals(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount) const;
+
+	// Set for geometry registered in MeshRegistry, reset when its content changes.
+	std::optional<uint64_t> contentHash;
+
+	// Number of meshes using the geometry; other owners (e.g. caches of raytracing backends) do not count as sharing it.
+	std::size_t getMeshCount() const { return meshCount; }
+
+private:
+	void initBuildInput();
+	OptixTraversableHandle buildGAS(cudaStream_t stream);
+	void updateGAS(cudaStream_t stream);
+	void promoteBackVertices(cudaStream_t stream);
+	void ensureHostCopy();
+
+	// Vertex uploads are done in a separate stream to overlap with raytracing of the previous frame
+	static cudaStream_t getCopyStream();
+
+	/**
+	 * Allocated on the first vertex update, so that only deformable meshes pay for double buffering.
+	 * Upload: host -> pinned staging -> back buffer (copy stream); promotion: back -> front buffer (raytrace stream).
+	 */
+	struct VertexUpload
+	{
+		VertexUpload();
+		~VertexUpload();
+		HostPinnedBuffer<Vec3f> hStaging;
+		DeviceBuffer<Vec3f> dBackVertices;
+		cudaEvent_t uploaded {nullptr}; // Back buffer is filled, staging buffer can be reused
+		cudaEvent_t promoted {nullptr}; // Back buffer has been copied, it can be overwritten
+	};
+
+private:
+	friend struct Mesh;
+	friend struct Scene;
+	friend struct GASBatchBuilder;
+	friend struct GASCompactor;
+	ASBuildScratchpad scratchpad;
+	bool gasNeedsUpdate {false};
+	std::optional<OptixTraversableHandle> cachedGAS;
+
+	// GAS output memory; either scratchpad.dFull or a region of an arena shared with other geometries built in the same batch
+	std::shared_ptr<DeviceBuffer<std::byte>> gasArena;
+	CUdeviceptr gasBuffer {0};
+	std::size_t gasBufferSize {0};
+	std::size_t gasUpdateCount {0}; // Allows GASCompactor to detect geometries that are not stable
+
+	DeviceBuffer<Vec3f> dVertices;
+	DeviceBuffer<Vec3i> dIndices;
+	std::unique_ptr<VertexUpload> vertexUpload;
+	bool backVerticesPending {false};
+	std::atomic<std::size_t> meshCount {0};  // Meshes may be released on threads of graphs holding their last reference
+	std::mutex mutex;  // Guards vertex upload state and the host copy; GAS state is guarded by scenes using the geometry
+
+	struct HostCopy
+	{
+		std::shared_ptr<const std::vector<Vec3f>> vertices;
+		std::vector<Vec3i> indices;
+	};
+	std::unique_ptr<HostCopy> hostCopy;
+
+	// Shared between buildGAS() and updateGAS()
+	OptixBuildInput buildInput;
+	CUdeviceptr vertexBuffers[1];
+	unsigned triangleInputFlags;
+	OptixAccelBuildOptions buildOptions;
+};
@@ -0,0 +1,76 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <scene/MeshRegistry.hpp>
+
+MeshRegistry& MeshRegistry::instance()
+{
+	static MeshRegistry registry;
+	return registry;
+}
+
+void MeshRegistry::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+	if (!enabled) {
+		geometries.clear();
+	}
+}
+
+// FNV-1a over raw bytes of both buffers
+uint64_t MeshRegistry::computeHash(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	auto hashBytes = [&](const void* data, std::size_t size) {
+		auto bytes = reinterpret_cast<const uint8_t*>(data);
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+	hashBytes(&vertexCount, sizeof(vertexCount));
+	hashBytes(vertices, vertexCount * sizeof(Vec3f));
+	hashBytes(&indexCount, sizeof(indexCount));
+	hashBytes(indices, indexCount * sizeof(Vec3i));
+	return hash;
+}
+
+std::shared_ptr<MeshGeometry> MeshRegistry::getOrCreate(const Vec3f *vertices, std::size_t vertexCount,
+                                                        const Vec3i *indices, std::size_t indexCount)
+{
+	if (!enabled) {
+		return std::make_shared<MeshGeometry>(vertices, vertexCount, indices, indexCount);
+	}
+
+	uint64_t hash = computeHash(vertices, vertexCount, indices, indexCount);
+	auto& candidates = geometries[hash];
+	// Forget geometries which were destroyed or modified since registration
+	std::erase_if(candidates, [&](const std::weak_ptr<MeshGeometry>& candidate) {
+		auto geometry = candidate.lock();
+		return geometry == nullptr || geometry->contentHash != hash;
+	});
+	for (auto&& candidate : candidates) {
+		auto geometry = candidate.lock();
+		// Hash match is verified to be immune to collisions; this is still much cheaper than an upload and a GAS build
+		if (geometry->contentEquals(vertices, vertexCount, indices, indexCount)) {
+			deduplicatedCount += 1;
+			return geometry;
+		}
+	}
+
+	auto geometry = std::make_shared<MeshGeometry>(vertices, vertexCount, indices, indexCount);
+	geometry->contentHash = hash;
+	candidates.push_back(geometry);
+	return geometry;
+}
@@ -0,0 +1,51 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <scene/MeshGeometry.hpp>
+
+/**
+ * Content-addressed registry of mesh geometries.
+ * When enabled, meshes created with identical vertices and indices share a single MeshGeometry
+ * (device buffers and GAS). Geometry is reference-counted by the meshes using it;
+ * the registry holds only weak references. Disabled by default.
+ */
+struct MeshRegistry
+{
+	static MeshRegistry& instance();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return enabled; }
+
+	std::shared_ptr<MeshGeometry> getOrCreate(const Vec3f *vertices, std::size_t vertexCount,
+	                                          const Vec3i *indices, std::size_t indexCount);
+
+	// Number of mesh creations served by an already existing geometry
+	std::size_t getDeduplicatedCount() const { return deduplicatedCount; }
+
+	static uint64_t computeHash(const Vec3f *vertices, std::size_t vertexCount, const Vec3i *indices, std::size_t indexCount);
+
+private:
+	MeshRegistry() = default;
+
+	bool enabled {false};
+	std::size_t deduplicatedCount {0};
+	// Many geometries per hash, in case of a collision
+	std::unordered_map<uint64_t, std::vector<std::weak_ptr<MeshGeometry>>> geometries;
+};
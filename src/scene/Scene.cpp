@@ -14,72 +14,416 @@
 
 #include <scene/Scene.hpp>
 #include <scene/Entity.hpp>
+#include <graph/GraphRunner.hpp>
 
 API_OBJECT_INSTANCE(Scene);
 
+std::mutex Scene::registryMutex;
+std::set<Scene*> Scene::registry;
+
 std::shared_ptr<Scene> Scene::defaultInstance()
 {
 	static auto scene = Scene::create();
 	return scene;
 }
 
+Scene::Scene()
+{
+	std::lock_guard registryLock {registryMutex};
+	registry.insert(this);
+}
+
+Scene::~Scene()
+{
+	{
+		std::lock_guard registryLock {registryMutex};
+		registry.erase(this);
+	}
+	for (auto&& [stream, event] : streamEvents) {
+		cudaEventDestroy(event);
+	}
+}
+
+// Uploads modified elements, issuing a single copy per contiguous range of slots.
+template<typename T>
+static void uploadDirtySlots(const std::vector<T>& src, DeviceBuffer<T>& dst, const std::set<std::size_t>& dirtySlots, cudaStream_t stream)
+{
+	auto it = dirtySlots.begin();
+	while (it != dirtySlots.end()) {
+		std::size_t rangeBegin = *it;
+		std::size_t rangeEnd = rangeBegin + 1;
+		for (++it; it != dirtySlots.end() && *it == rangeEnd; ++it) {
+			rangeEnd += 1;
+		}
+		dst.copyFromHostAtAsync(src.data() + rangeBegin, rangeEnd - rangeBegin, rangeBegin, stream);
+	}
+}
+
 std::size_t Scene::getObjectCount()
-{ return entities.size(); }
+{
+	std::lock_guard lock {mutex};
+	return entityCount;
+}
+
+std::vector<std::shared_ptr<Entity>> Scene::getEntities() const
+{
+	std::lock_guard lock {mutex};
+	std::vector<std::shared_ptr<Entity>> entities;
+	entities.reserve(entityCount);
+	for (auto&& entity : entitySlots) {
+		if (entity != nullptr) {
+			entities.push_back(entity);
+		}
+	}
+	return entities;
+}
+
+void Scene::forgetStream(cudaStream_t stream)
+{
+	std::lock_guard registryLock {registryMutex};
+	for (auto&& scene : registry) {
+		std::lock_guard lock {scene->mutex};
+		scene->readerStreams.erase(stream);
+		if (scene->updateStream == stream) {
+			scene->updateStream.reset();  // The update is completed, nothing to wait for
+		}
+		auto it = scene->streamEvents.find(stream);
+		if (it != scene->streamEvents.end()) {
+			cudaEventDestroy(it->second);  // Called from destructors, must not throw
+			scene->streamEvents.erase(it);
+		}
+	}
+}
 
 void Scene::clear()
 {
-	entities.clear();
+	std::lock_guard lock {mutex};
+	clearEntities();
+	readerStreams.clear();
+	updateStream.reset();
+	for (auto&& [stream, event] : streamEvents) {
+		CHECK_CUDA(cudaEventDestroy(event));
+	}
+	streamEvents.clear();
+}
+
+void Scene::clearEntities()
+{
+	entitySlots.clear();
+	freeSlots.clear();
+	entityCount = 0;
+	hInstances.clear();
+	hMotionTransforms.clear();
+	hHitgroupRecords.clear();
+	meshesPendingGASBuild.clear();
+	dirtyInstanceSlots.clear();
+	dirtyHitgroupSlots.clear();
+	dirtyGASSlots.clear();
 	requestFullRebuild();
 }
 
 void Scene::addEntity(std::shared_ptr<Entity> entity)
 {
+	std::lock_guard lock {mutex};
+	if (isSlotOf(entity)) {
+		return;
+	}
+	std::size_t slot = allocateSlot();
 	entity->scene = weak_from_this();
-	entities.insert(entity);
-	requestFullRebuild();
+	entity->sceneSlot = slot;
+	entitySlots[slot] = std::move(entity);
+	entityCount += 1;
+	if (!entitySlots[slot]->mesh->getGeometry()->hasGAS()) {
+		meshesPendingGASBuild.push_back(entitySlots[slot]->mesh->getGeometry());
+	}
+	dirtyInstanceSlots.insert(slot);
+	dirtyHitgroupSlots.insert(slot);
+	// Instance table is updated incrementally, but BVH quality requires rebuilding IAS when its content changes
+	requestASRebuild();
 }
 
 void Scene::removeEntity(std::shared_ptr<Entity> entity)
 {
-	entities.erase(entity);
-	requestFullRebuild();
+	std::lock_guard lock {mutex};
+	if (!isSlotOf(entity)) {
+		return;
+	}
+	std::size_t slot = entity->sceneSlot;
+	entity->scene.reset();
+	entitySlots[slot].reset();
+	freeSlots.push_back(slot);
+	entityCount -= 1;
+	if (entityCount == 0) {
+		clearEntities(); // Drop the table to avoid keeping slots of all entities ever added
+		return;
+	}
+	dirtyInstanceSlots.insert(slot);
+	dirtyHitgroupSlots.insert(slot);
+	dirtyGASSlots.erase(slot);
+	requestASRebuild();
+}
+
+std::size_t Scene::allocateSlot()
+{
+	if (!freeSlots.empty()) {
+		std::size_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+	entitySlots.emplace_back();
+	hInstances.emplace_back();
+	hMotionTransforms.emplace_back();
+	hHitgroupRecords.emplace_back();
+	return entitySlots.size() - 1;
+}
+
+bool Scene::isSlotOf(const std::shared_ptr<Entity>& entity) const
+{
+	return entity->sceneSlot < entitySlots.size() && entitySlots[entity->sceneSlot] == entity;
+}
+
+std::size_t Scene::getVersion() const
+{
+	std::lock_guard lock {mutex};
+	return modificationCount;
 }
 
 void Scene::requestFullRebuild()
 {
+	std::lock_guard lock {mutex};
 	requestASRebuild();
 	requestSBTRebuild();
 }
 
-OptixTraversableHandle Scene::getAS()
+OptixTraversableHandle Scene::getAS(cudaStream_t stream)
 {
-	if (!cachedAS.has_value()) {
-		cachedAS = buildAS();
+	std::lock_guard lock {mutex};
+	waitForUpdates(stream);
+	auto plan = SceneUpdatePlan::forAS({
+		.hasAS = cachedAS.has_value(),
+		.meshesPendingBuild = !meshesPendingGASBuild.empty(),
+		.instanceCountChanged = dInstances.getElemCount() != hInstances.size(),
+		.instancesModified = !dirtyInstanceSlots.empty(),
+		.meshesModified = !dirtyGASSlots.empty(),
+		.compactionDue = gasCompactor.isCompactionDue(GraphRunner::getTotalRunCount()),
+		.refitCount = asRefitCount,
+		.maxRefitCount = MAX_AS_REFIT_COUNT,
+	});
+	if (!plan.isEmpty()) {
+		beginUpdate(stream);
+	}
+	plan.enqueue([&](SceneUpdatePlan::Step step) {
+		switch (step) {
+			case SceneUpdatePlan::Step::BuildGAS: buildPendingGASes(stream); break;
+			case SceneUpdatePlan::Step::UpdateGAS: updateGASes(stream); break;
+			case SceneUpdatePlan::Step::CompactGAS: compactGASes(stream); break;
+			case SceneUpdatePlan::Step::UploadInstances: uploadInstances(stream); break;
+			case SceneUpdatePlan::Step::BuildIAS: cachedAS = buildAS(stream); break;
+			case SceneUpdatePlan::Step::RefitIAS: refitAS(stream); break;
+			default: throw std::logic_error(fmt::format("unexpected IAS update step: {}", static_cast<int>(step)));
+		}
+	});
+	if (!plan.isEmpty()) {
+		endUpdate(stream);
 	}
 	return *cachedAS;
 }
 
-OptixShaderBindingTable Scene::getSBT()
+OptixShaderBindingTable Scene::getSBT(cudaStream_t stream)
 {
-	if (!cachedSBT.has_value()) {
-		cachedSBT = buildSBT();
+	std::lock_guard lock {mutex};
+	waitForUpdates(stream);
+	auto plan = SceneUpdatePlan::forSBT({
+		.hasSBT = cachedSBT.has_value(),
+		.recordCountChanged = dHitgroupRecords.getElemCount() != hHitgroupRecords.size(),
+		.recordsModified = !dirtyHitgroupSlots.empty(),
+	});
+	if (!plan.isEmpty()) {
+		beginUpdate(stream);
+	}
+	plan.enqueue([&](SceneUpdatePlan::Step step) {
+		switch (step) {
+			case SceneUpdatePlan::Step::UploadHitgroupRecords: uploadHitgroupRecords(stream); break;
+			case SceneUpdatePlan::Step::BuildSBT: cachedSBT = buildSBT(stream); break;
+			default: throw std::logic_error(fmt::format("unexpected SBT update step: {}", static_cast<int>(step)));
+		}
+	});
+	if (!plan.isEmpty()) {
+		endUpdate(stream);
 	}
 	return *cachedSBT;
 }
 
-OptixShaderBindingTable Scene::buildSBT()
+void Scene::prepare(cudaStream_t stream)
+{
+	std::lock_guard lock {mutex};
+	getAS(stream);
+	getSBT(stream);
+}
+
+static bool isCapturing(cudaStream_t stream)
+{
+	cudaStreamCaptureStatus captureStatus;
+	CHECK_CUDA(cudaStreamIsCapturing(stream, &captureStatus));
+	return captureStatus != cudaStreamCaptureStatusNone;
+}
+
+void Scene::waitForUpdates(cudaStream_t stream)
+{
+	if (isCapturing(stream)) {
+		return;
+	}
+	// Work of the stream is going to use the scene, whether or not it updates it
+	readerStreams.insert(stream);
+	if (!updateStream.has_value() || *updateStream == stream) {
+		return;
+	}
+	CHECK_CUDA(cudaStreamWaitEvent(stream, streamEvents.at(*updateStream)));
+}
+
+void Scene::beginUpdate(cudaStream_t stream)
+{
+	if (isCapturing(stream)) {
+		return;
+	}
+	// Launches of other streams were enqueued under the lock, hence before the events recorded now
+	for (auto&& reader : readerStreams) {
+		if (reader != stream) {
+			CHECK_CUDA(cudaStreamWaitEvent(stream, recordStreamEvent(reader)));
+		}
+	}
+	readerStreams = {stream};
+}
+
+void Scene::endUpdate(cudaStream_t stream)
+{
+	if (isCapturing(stream)) {
+		return;
+	}
+	recordStreamEvent(stream);
+	updateStream = stream;
+}
+
+cudaEvent_t Scene::recordStreamEvent(cudaStream_t stream)
 {
-	static DeviceBuffer<HitgroupRecord> dHitgroupRecords;
-	static DeviceBuffer<RaygenRecord> dRaygenRecords;
-	static DeviceBuffer<MissRecord> dMissRecords;
+	auto it = streamEvents.find(stream);
+	if (it == streamEvents.end()) {
+		cudaEvent_t event = nullptr;
+		CHECK_CUDA(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+		it = streamEvents.emplace(stream, event).first;
+	}
+	// Recording again covers the work recorded before, e.g. the last update of the scene
+	CHECK_CUDA(cudaEventRecord(it->second, stream));
+	return it->second;
+}
+
+void Scene::buildPendingGASes(cudaStream_t stream)
+{
+	// Geometries may be shared between entities or built meanwhile by another scene
+	std::vector<std::shared_ptr<MeshGeometry>> meshes;
+	std::set<MeshGeometry*> uniqueMeshes;
+	for (auto&& weakMesh : meshesPendingGASBuild) {
+		auto mesh = weakMesh.lock();
+		if (mesh == nullptr || mesh->hasGAS() || uniqueMeshes.contains(mesh.get())) {
+			continue;
+		}
+		uniqueMeshes.insert(mesh.get());
+		meshes.push_back(mesh);
+	}
+	meshesPendingGASBuild.clear();
+	gasBatchBuilder.build(meshes, stream);
+	gasCompactor.track(meshes, gasBatchBuilder.getCompactedSizes(), stream);
+}
+
+void Scene::compactGASes(cudaStream_t stream)
+{
+	gasCompactor.compact(stream);
+	for (std::size_t slot = 0; slot < entitySlots.size(); ++slot) {
+		if (entitySlots[slot] != nullptr) {
+			dirtyInstanceSlots.insert(slot);
+		}
+	}
+}
+
+void Scene::updateGASes(cudaStream_t stream)
+{
+	// Refit of a geometry shared by several entities is enqueued only once
+	for (auto&& slot : dirtyGASSlots) {
+		if (entitySlots[slot] != nullptr) {
+			entitySlots[slot]->mesh->getGAS(stream);
+		}
+	}
+	dirtyGASSlots.clear();
+}
+
+// Note: copies from pageable memory are staged before cudaMemcpyAsync returns, so host tables may be modified right after.
+void Scene::uploadInstances(cudaStream_t stream)
+{
+	// Handles of motion transforms are their device addresses, reallocation invalidates all instances of moving entities
+	if (dMotionTransforms.resizeToFit(hMotionTransforms.size())) {
+		for (std::size_t slot = 0; slot < entitySlots.size(); ++slot) {
+			if (entitySlots[slot] != nullptr) {
+				dirtyInstanceSlots.insert(slot);
+			}
+		}
+	}
+	for (auto&& slot : dirtyInstanceSlots) {
+		auto& entity = entitySlots[slot];
+		if (entity != nullptr) {
+			hInstances[slot] = entity->getIAS(static_cast<int>(slot), stream);
+			if (entity->isMoving()) {
+				// Motion transform carries the entity's transform, the instance only redirects traversal to it
+				hMotionTransforms[slot] = entity->getMotionTransform(stream);
+				hInstances[slot].traversableHandle = getMotionTransformHandle(slot);
+				Mat3x4f::identity().toRaw(hInstances[slot].transform);
+			}
+			continue;
+		}
+		// Free slots are kept in the table as instances invisible to any ray
+		hInstances[slot] = OptixInstance {
+			.instanceId = static_cast<unsigned int>(slot),
+			.sbtOffset = static_cast<unsigned int>(slot),
+			.visibilityMask = 0,
+			.flags = OPTIX_INSTANCE_FLAG_DISABLE_ANYHIT,
+			.traversableHandle = static_cast<OptixTraversableHandle>(0),
+		};
+		Mat3x4f::identity().toRaw(hInstances[slot].transform);
+	}
+	if (dInstances.getElemCount() != hInstances.size()) {
+		dInstances.copyFromHostAsync(hInstances.data(), hInstances.size(), stream);
+	}
+	else {
+		uploadDirtySlots(hInstances, dInstances, dirtyInstanceSlots, stream);
+	}
+	uploadDirtySlots(hMotionTransforms, dMotionTransforms, dirtyInstanceSlots, stream);
+	dirtyInstanceSlots.clear();
+}
+
+// Motion transforms are packed in a single device buffer, each of them has to be aligned on its own
+static_assert(sizeof(OptixMatrixMotionTransform) % OPTIX_TRANSFORM_BYTE_ALIGNMENT == 0);
+
+OptixTraversableHandle Scene::getMotionTransformHandle(std::size_t slot)
+{
+	OptixTraversableHandle handle;
+	CUdeviceptr motionTransform = dMotionTransforms.readDeviceRaw() + slot * sizeof(OptixMatrixMotionTransform);
+	CHECK_OPTIX(optixConvertPointerToTraversableHandle(Optix::getOrCreate().context,
+	                                                   motionTransform,
+	                                                   OPTIX_TRAVERSABLE_TYPE_MATRIX_MOTION_TRANSFORM,
+	                                                   &handle));
+	return handle;
+}
 
-	// TODO(prybicki): low priority: can HG count be reduced to be == count(GASes)? or must it be count(IASes)?
-	std::vector<HitgroupRecord> hHitgroupRecords;
-	for (auto&& entity : entities) {
-		auto& mesh = entity->mesh;
-		hHitgroupRecords.emplace_back(); // TODO(prybicki): fix, this is weird
-		HitgroupRecord *hr = &(*hHitgroupRecords.rbegin());
+void Scene::uploadHitgroupRecords(cudaStream_t stream)
+{
+	for (auto&& slot : dirtyHitgroupSlots) {
+		HitgroupRecord* hr = &hHitgroupRecords[slot];
 		CHECK_OPTIX(optixSbtRecordPackHeader(Optix::getOrCreate().hitgroupPG, hr));
+		if (entitySlots[slot] == nullptr) {
+			hr->data = TriangleMeshSBTData{}; // Free slot, never hit
+			continue;
+		}
+		auto& entity = entitySlots[slot];
+		auto mesh = entity->mesh->getGeometry();
 		hr->data = TriangleMeshSBTData{
 			.vertex = mesh->dVertices.readDevice(),
 			.index = mesh->dIndices.readDevice(),
@@ -88,44 +432,44 @@ OptixShaderBindingTable Scene::buildSBT()
 			.laser_retro = entity->getLaserRetro(),
 		};
 	}
-	dHitgroupRecords.copyFromHost(hHitgroupRecords);
+	if (dHitgroupRecords.getElemCount() != hHitgroupRecords.size()) {
+		dHitgroupRecords.copyFromHostAsync(hHitgroupRecords.data(), hHitgroupRecords.size(), stream);
+	}
+	else {
+		uploadDirtySlots(hHitgroupRecords, dHitgroupRecords, dirtyHitgroupSlots, stream);
+	}
+	dirtyHitgroupSlots.clear();
+}
 
+OptixShaderBindingTable Scene::buildSBT(cudaStream_t stream)
+{
 	RaygenRecord hRaygenRecord;
 	CHECK_OPTIX(optixSbtRecordPackHeader(Optix::getOrCreate().raygenPG, &hRaygenRecord));
-	dRaygenRecords.copyFromHost(&hRaygenRecord, 1);
+	dRaygenRecords.copyFromHostAsync(&hRaygenRecord, 1, stream);
 
 	MissRecord hMissRecord;
 	CHECK_OPTIX(optixSbtRecordPackHeader(Optix::getOrCreate().missPG, &hMissRecord));
-	dMissRecords.copyFromHost(&hMissRecord, 1);
+	dMissRecords.copyFromHostAsync(&hMissRecord, 1, stream);
 
 	return OptixShaderBindingTable{
 		.raygenRecord = dRaygenRecords.readDeviceRaw(),
 		.missRecordBase = dMissRecords.readDeviceRaw(),
 		.missRecordStrideInBytes = sizeof(MissRecord),
 		.missRecordCount = 1U,
-		.hitgroupRecordBase = getObjectCount() > 0 ? dHitgroupRecords.readDeviceRaw() : static_cast<CUdeviceptr>(0),
+		.hitgroupRecordBase = dHitgroupRecords.getElemCount() > 0 ? dHitgroupRecords.readDeviceRaw() : static_cast<CUdeviceptr>(0),
 		.hitgroupRecordStrideInBytes = sizeof(HitgroupRecord),
 		.hitgroupRecordCount = static_cast<unsigned>(dHitgroupRecords.getElemCount()),
 	};
 }
 
-OptixTraversableHandle Scene::buildAS()
+OptixTraversableHandle Scene::buildAS(cudaStream_t stream)
 {
+	asRefitCount = 0;
 	if (getObjectCount() == 0) {
 		return static_cast<OptixTraversableHandle>(0);
 	}
-	std::vector<OptixInstance> instances;
-	for (auto&& entity : entities) {
-		// TODO(prybicki): this is somewhat inefficient, because most of the time only transform changes.
-		instances.push_back(entity->getIAS(static_cast<int>(instances.size())));
-	}
 
-	// *** *** *** ACHTUNG *** *** ***
-	// Calls to cudaMemcpy below are a duck-tape for synchronizing all streams from LidarContexts.
-	dInstances.resizeToFit(instances.size());
-	dInstances.copyFromHost(instances);
-
-	OptixBuildInput instanceInput = {
+	asBuildInput = {
 	.type = OPTIX_BUILD_INPUT_TYPE_INSTANCES,
 	.instanceArray = {
 	.instances = dInstances.readDeviceRaw(),
@@ -133,14 +477,14 @@ OptixTraversableHandle Scene::buildAS()
 	},
 	};
 
-	OptixAccelBuildOptions accelBuildOptions = {
+	asBuildOptions = {
 	.buildFlags =
-	OPTIX_BUILD_FLAG_ALLOW_UPDATE // TODO(prybicki): figure out if there's a faster way to update than the current one
+	OPTIX_BUILD_FLAG_ALLOW_UPDATE
 	| OPTIX_BUILD_FLAG_ALLOW_COMPACTION,
 	.operation = OPTIX_BUILD_OPERATION_BUILD
 	};
 
-	scratchpad.resizeToFit(instanceInput, accelBuildOptions);
+	scratchpad.resizeToFit(asBuildInput, asBuildOptions);
 
 	OptixAccelEmitDesc emitDesc = {
 	.result = scratchpad.dCompactedSize.readDeviceRaw(),
@@ -149,9 +493,9 @@ OptixTraversableHandle Scene::buildAS()
 
 	OptixTraversableHandle sceneHandle;
 	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
-	                            nullptr, // TODO(prybicki): run in stream
-	                            &accelBuildOptions,
-	                            &instanceInput,
+	                            stream,
+	                            &asBuildOptions,
+	                            &asBuildInput,
 	                            1,
 	                            scratchpad.dTemp.readDeviceRaw(),
 	                            scratchpad.dTemp.getByteSize(),
@@ -162,17 +506,96 @@ OptixTraversableHandle Scene::buildAS()
 	                            1
 	));
 
-	// scratchpad.doCompaction(sceneHandle);
+	// scratchpad.doCompaction(sceneHandle, stream);
 
 	return sceneHandle;
 }
 
+void Scene::refitAS(cudaStream_t stream)
+{
+	if (getObjectCount() == 0) {
+		return;
+	}
+
+	// OptiX update requires the same build input and output buffer as the original build
+	OptixAccelBuildOptions refitOptions = asBuildOptions;
+	refitOptions.operation = OPTIX_BUILD_OPERATION_UPDATE;
+	scratchpad.resizeToFit(asBuildInput, refitOptions);
+
+	CHECK_OPTIX(optixAccelBuild(Optix::getOrCreate().context,
+	                            stream,
+	                            &refitOptions,
+	                            &asBuildInput,
+	                            1,
+	                            scratchpad.dTemp.readDeviceRaw(),
+	                            scratchpad.dTemp.getByteSize(),
+	                            scratchpad.dFull.readDeviceRaw(),
+	                            scratchpad.dFull.getByteSize(),
+	                            &cachedAS.value(),
+	                            nullptr,
+	                            0
+	));
+	asRefitCount += 1;
+}
+
 void Scene::requestASRebuild()
 {
+	std::lock_guard lock {mutex};
 	cachedAS.reset();
+	modificationCount += 1;
+}
+
+void Scene::requestASRefit(Entity* entity)
+{
+	std::lock_guard lock {mutex};
+	if (entity->sceneSlot < entitySlots.size() && entitySlots[entity->sceneSlot].get() == entity) {
+		dirtyInstanceSlots.insert(entity->sceneSlot);
+		modificationCount += 1;
+	}
+}
+
+void Scene::requestSBTUpdate(Entity* entity)
+{
+	std::lock_guard lock {mutex};
+	if (entity->sceneSlot < entitySlots.size() && entitySlots[entity->sceneSlot].get() == entity) {
+		dirtyHitgroupSlots.insert(entity->sceneSlot);
+		modificationCount += 1;
+	}
+}
+
+void Scene::setCompactionPolicy(const GASCompactionPolicy& policy)
+{
+	std::lock_guard lock {mutex};
+	gasCompactor.setPolicy(policy);
+}
+
+GASCompactor::Stats Scene::getCompactionStats() const
+{
+	std::lock_guard lock {mutex};
+	return gasCompactor.getStats();
+}
+
+void Scene::onMeshModified(std::size_t slot, const Entity* entity, bool geometryReplaced)
+{
+	std::lock_guard lock {mutex};
+	if (slot >= entitySlots.size() || entitySlots[slot].get() != entity) {
+		return;
+	}
+	if (geometryReplaced) {
+		// Private copy of a shared geometry has its own GAS handle and device buffers
+		dirtyInstanceSlots.insert(slot);
+		dirtyHitgroupSlots.insert(slot);
+		meshesPendingGASBuild.push_back(entity->mesh->getGeometry());
+	}
+	else {
+		dirtyGASSlots.insert(slot);
+	}
+	modificationCount += 1;
 }
 
 void Scene::requestSBTRebuild()
 {
+	std::lock_guard lock {mutex};
 	cachedSBT.reset();
+	modificationCount += 1;
 }
@@ -15,50 +15,159 @@
 #pragma once
 
 #include <set>
+#include <mutex>
+#include <vector>
 #include <string>
 #include <optional>
 #include <unordered_map>
 #include <scene/ASBuildScratchpad.hpp>
+#include <scene/SceneUpdatePlan.hpp>
+#include <scene/GASBatchBuilder.hpp>
+#include <scene/GASCompactor.hpp>
 #include <APIObject.hpp>
 
 #include <gpu/ShaderBindingTableTypes.h>
 
 struct Entity;
+struct MeshGeometry;
 
 /**
  * Class responsible for managing objects and meshes, building AS and SBT.
- * Ported from the PoC code which assumed 1:1 mesh:object relationship.
- * Because of that, when some objects share a mesh, SBT records will be duplicated.
- * This will still work, but it causes pointless CPU -> GPU copies.
- * TODO(prybicki): fix it
+ * Each entity occupies a stable slot in a persistent instance table, mirrored by the hitgroup records table.
+ * Slots of removed entities are recycled. Only the slots modified since the last upload are copied to the device.
+ * Moving entities are instanced through matrix motion transforms, which OptiX interpolates at each ray's time.
+ *
+ * Scene may be modified by API calls while graphs trace it; all methods are serialized by the scene's mutex.
+ * Scene may be traced by concurrently running graphs, each in its own stream. Getters of AS and SBT are serialized;
+ * they order the given stream after updates enqueued in other streams, and updates after launches enqueued in other
+ * streams before them. To that end, launches keep the scene locked until they are enqueued (see lock()).
+ * Streams being captured are not ordered against other streams; replays of captured launches are preceded by prepare()
+ * in the replaying stream instead.
  */
 struct Scene : APIObject<Scene>, std::enable_shared_from_this<Scene>
 {
 	static std::shared_ptr<Scene> defaultInstance();
+	~Scene();
+
+	// Makes all scenes forget the given stream, whose work must be completed, so that it can be destroyed.
+	static void forgetStream(cudaStream_t stream);
 
 	void addEntity(std::shared_ptr<Entity> entity);
 	void removeEntity(std::shared_ptr<Entity> entity);
+	// Also forgets the ordering of streams, hence the scene must not be traced meanwhile.
 	void clear();
 
 	std::size_t getObjectCount();
 
-	OptixTraversableHandle getAS();
-	OptixShaderBindingTable getSBT();
+	// Entities in the order of their slots; for consumers of the scene other than OptiX (e.g. CPU raytracing).
+	std::vector<std::shared_ptr<Entity>> getEntities() const;
+
+	// Acceleration structure and SBT updates are enqueued in the given stream; results are valid for work enqueued after them.
+	OptixTraversableHandle getAS(cudaStream_t stream);
+	OptixShaderBindingTable getSBT(cudaStream_t stream);
+
+	/**
+	 * Changes whenever the content of the scene changes (entities, their poses and properties, vertices of meshes),
+	 * allowing consumers to detect that their results of tracing the scene are stale.
+	 */
+	std::size_t getVersion() const;
+
+	// Builds all pending acceleration structures and the SBT, so that their cost is not paid by the first raytrace.
+	void prepare(cudaStream_t stream);
+
+	// Held from getting the AS and SBT until the launch using them is enqueued.
+	std::unique_lock<std::recursive_mutex> lock() { return std::unique_lock {mutex}; }
 
 	void requestFullRebuild();
 	void requestASRebuild();
 	void requestSBTRebuild();
 
+	// Requests updating the given entity's instance and refitting the IAS instead of rebuilding it.
+	void requestASRefit(Entity* entity);
+
+	// Requests updating the given entity's hitgroup record.
+	void requestSBTUpdate(Entity* entity);
+
+	// Called by the mesh of the entity in the given slot after its vertices were updated, see Mesh.
+	// Entity is only compared with the content of the slot, it may have been destroyed meanwhile.
+	void onMeshModified(std::size_t slot, const Entity* entity, bool geometryReplaced);
+
+	// GASes of meshes that have not been modified for a number of frames are compacted while GAS memory exceeds the budget.
+	void setCompactionPolicy(const GASCompactionPolicy& policy);
+	GASCompactor::Stats getCompactionStats() const;
+
 private:
-	OptixShaderBindingTable buildSBT();
-	OptixTraversableHandle buildAS();
+	Scene();
+	friend APIObject<Scene>;
+
+	// Drops all entities, keeping the ordering of streams which may still trace the dropped AS
+	void clearEntities();
+
+	OptixShaderBindingTable buildSBT(cudaStream_t stream);
+	OptixTraversableHandle buildAS(cudaStream_t stream);
+	void refitAS(cudaStream_t stream);
+	void buildPendingGASes(cudaStream_t stream);
+	void updateGASes(cudaStream_t stream);
+	void compactGASes(cudaStream_t stream);
+	void uploadInstances(cudaStream_t stream);
+	OptixTraversableHandle getMotionTransformHandle(std::size_t slot);
+	void uploadHitgroupRecords(cudaStream_t stream);
+
+	// Ordering of streams using the scene; callers hold the mutex
+	void waitForUpdates(cudaStream_t stream);
+	void beginUpdate(cudaStream_t stream);
+	void endUpdate(cudaStream_t stream);
+	cudaEvent_t recordStreamEvent(cudaStream_t stream);
+
+	std::size_t allocateSlot();
+	bool isSlotOf(const std::shared_ptr<Entity>& entity) const;
 
 private:
-	std::set<std::shared_ptr<Entity>> entities;
+	// Refitting degrades IAS quality over time, therefore IAS is rebuilt after this number of consecutive refits.
+	static constexpr std::size_t MAX_AS_REFIT_COUNT = 64;
+
+	// Slot-allocated entity table; index is the entity's instance id and SBT offset, nullptr marks a free slot
+	std::vector<std::shared_ptr<Entity>> entitySlots;
+	std::vector<std::size_t> freeSlots;
+	std::size_t entityCount {0};
+	std::size_t modificationCount {0};  // All counters making up the version only grow, so does their sum
+
 	ASBuildScratchpad scratchpad;
+	GASBatchBuilder gasBatchBuilder;
+	GASCompactor gasCompactor;
+	std::vector<std::weak_ptr<MeshGeometry>> meshesPendingGASBuild;
 
 	std::optional<OptixTraversableHandle> cachedAS;
 	std::optional<OptixShaderBindingTable> cachedSBT;
 
+	// Slots modified since the last upload
+	std::set<std::size_t> dirtyInstanceSlots;
+	std::set<std::size_t> dirtyHitgroupSlots;
+	// Slots of entities whose meshes have been modified since the last GAS update
+	std::set<std::size_t> dirtyGASSlots;
+
+	// IAS refit bookkeeping
+	std::size_t asRefitCount {0};
+	OptixAccelBuildOptions asBuildOptions;
+	OptixBuildInput asBuildInput;
+
+	std::vector<OptixInstance> hInstances;
 	DeviceBuffer<OptixInstance> dInstances;
+
+	// Motion transforms of moving entities, indexed by slot; instances of moving entities refer to them instead of GASes
+	std::vector<OptixMatrixMotionTransform> hMotionTransforms;
+	DeviceBuffer<OptixMatrixMotionTransform> dMotionTransforms;
+
+	// Stream ordering
+	static std::mutex registryMutex;
+	static std::set<Scene*> registry;  // All alive scenes, which may refer to streams
+	mutable std::recursive_mutex mutex;  // Also guards the content of the scene, modified by API calls while graphs run
+	std::unordered_map<cudaStream_t, cudaEvent_t> streamEvents;  // Reused for every recording in the stream
+	std::optional<cudaStream_t> updateStream;  // Of the last update, recorded in its event right after the update
+	std::set<cudaStream_t> readerStreams;      // Which may have traced the scene since the last update
+
+	std::vector<HitgroupRecord> hHitgroupRecords;
+	DeviceBuffer<HitgroupRecord> dHitgroupRecords;
+	DeviceBuffer<RaygenRecord> dRaygenRecords;
+	DeviceBuffer<MissRecord> dMissRecords;
 };
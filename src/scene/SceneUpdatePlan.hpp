@@ -0,0 +1,118 @@
+// Copyright 2022 Robotec.AI
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Ordered list of operations needed to bring scene's acceleration structure and SBT up to date.
+ * The plan is computed on the host, independently of CUDA, and then enqueued by the Scene on a single stream.
+ * Since all steps land in the same stream, their order in the plan is the order in which GPU executes them.
+ */
+struct SceneUpdatePlan
+{
+	enum class Step
+	{
+		BuildGAS,              // Build GASes of newly added meshes in a single batch
+		UpdateGAS,             // Refit GASes of meshes whose vertices have changed
+		CompactGAS,            // Compact stable GASes; changes their handles
+		UploadInstances,       // Copy modified instances to the device
+		BuildIAS,
+		RefitIAS,
+		UploadHitgroupRecords, // Copy modified hitgroup records to the device
+		BuildSBT,
+	};
+
+	struct ASState
+	{
+		bool hasAS;                // IAS has been built before
+		bool meshesPendingBuild;   // Some meshes of the scene have no GAS yet
+		bool instanceCountChanged; // Instance table has grown or shrunk since the last upload
+		bool instancesModified;    // Some instances have been modified since the last upload
+		bool meshesModified;       // Some meshes have been modified since the last IAS build / refit
+		bool compactionDue;        // Some GASes are to be compacted
+		std::size_t refitCount;    // Consecutive refits since the last IAS build
+		std::size_t maxRefitCount;
+	};
+
+	struct SBTState
+	{
+		bool hasSBT;
+		bool recordCountChanged;
+		bool recordsModified;
+	};
+
+	static SceneUpdatePlan forAS(const ASState& state)
+	{
+		SceneUpdatePlan plan;
+		bool refitNeeded = state.instancesModified || state.meshesModified || state.compactionDue;
+		// Change of the instance count invalidates the IAS build input, refit is not possible
+		bool rebuildNeeded = !state.hasAS || state.instanceCountChanged || (refitNeeded && state.refitCount >= state.maxRefitCount);
+
+		// GASes must be up to date before instances referencing them are consumed by the IAS build / refit
+		if (state.meshesPendingBuild) {
+			plan.steps.push_back(Step::BuildGAS);
+		}
+		if (state.meshesModified) {
+			plan.steps.push_back(Step::UpdateGAS);
+		}
+		// Compaction changes GAS handles, therefore all instances referring to them have to be updated
+		if (state.compactionDue) {
+			plan.steps.push_back(Step::CompactGAS);
+		}
+		if (state.instancesModified || state.instanceCountChanged || state.compactionDue) {
+			plan.steps.push_back(Step::UploadInstances);
+		}
+		if (rebuildNeeded) {
+			plan.steps.push_back(Step::BuildIAS);
+		}
+		else if (refitNeeded) {
+			plan.steps.push_back(Step::RefitIAS);
+		}
+		return plan;
+	}
+
+	static SceneUpdatePlan forSBT(const SBTState& state)
+	{
+		SceneUpdatePlan plan;
+		if (state.recordsModified || state.recordCountChanged) {
+			plan.steps.push_back(Step::UploadHitgroupRecords);
+		}
+		// Change of the record count invalidates the SBT (and possibly its device pointers)
+		if (!state.hasSBT || state.recordCountChanged) {
+			plan.steps.push_back(Step::BuildSBT);
+		}
+		return plan;
+	}
+
+	bool isEmpty() const { return steps.empty(); }
+	const std::vector<Step>& getSteps() const { return steps; }
+
+	/**
+	 * Passes the steps, in order, to the given callable, which is expected to enqueue them in a stream.
+	 * Tests may pass a mock stream recording the steps instead.
+	 */
+	template<typename StreamEnqueuer>
+	void enqueue(StreamEnqueuer&& enqueuer) const
+	{
+		for (auto&& step : steps) {
+			enqueuer(step);
+		}
+	}
+
+private:
+	std::vector<Step> steps;
+};
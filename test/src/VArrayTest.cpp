@@ -1,11 +1,69 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <cstring>
+
 #include <VArray.hpp>
 #include <VArrayProxy.hpp>
 
 using namespace ::testing;
 
+// Executes operations immediately in host memory and records calls instead of using CUDA
+struct FakeDeviceAllocator : DeviceAllocator
+{
+	void* allocate(std::size_t bytes, MemLoc location) override
+	{
+		calls.push_back(fmt::format("allocate {} {}", bytes, location == MemLoc::Host ? "host" : "device"));
+		return std::malloc(bytes);
+	}
+
+	void deallocate(void* ptr, MemLoc location, cudaStream_t stream) override
+	{
+		calls.push_back(fmt::format("deallocate {} in {}", location == MemLoc::Host ? "host" : "device", name(stream)));
+		std::free(ptr);
+	}
+
+	void copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream) override
+	{
+		calls.push_back(fmt::format("copy {} in {}", bytes, name(stream)));
+		std::memcpy(dst, src, bytes);
+	}
+
+	void memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream) override
+	{
+		calls.push_back(fmt::format("memset {} in {}", bytes, name(stream)));
+		std::memset(dst, value, bytes);
+	}
+
+	cudaEvent_t createEvent() override { return reinterpret_cast<cudaEvent_t>(++eventCount); }
+	void destroyEvent(cudaEvent_t event) override { --eventCount; }
+	void recordEvent(cudaEvent_t event, cudaStream_t stream) override { calls.push_back(fmt::format("record in {}", name(stream))); }
+	void streamWaitEvent(cudaStream_t stream, cudaEvent_t event) override { calls.push_back(fmt::format("wait in {}", name(stream))); }
+	void synchronizeEvent(cudaEvent_t event) override { calls.push_back("synchronize"); }
+	bool isEventDone(cudaEvent_t event) override { return true; }
+	bool isUnified() const override { return unified; }
+
+	void prefetchAsync(const void* ptr, std::size_t bytes, MemLoc location, cudaStream_t stream) override
+	{
+		calls.push_back(fmt::format("prefetch {} to {} in {}", bytes, location == MemLoc::Host ? "host" : "device", name(stream)));
+	}
+
+	static std::string name(cudaStream_t stream) { return stream == nullptr ? "legacy" : fmt::format("stream{}", reinterpret_cast<uintptr_t>(stream)); }
+
+	std::vector<std::string> calls;
+	uintptr_t eventCount {0};
+	bool unified {false};
+};
+
+struct VArrayStreams : Test
+{
+	std::shared_ptr<FakeDeviceAllocator> allocator = std::make_shared<FakeDeviceAllocator>();
+	cudaStream_t streamA = reinterpret_cast<cudaStream_t>(1);
+	cudaStream_t streamB = reinterpret_cast<cudaStream_t>(2);
+
+	std::vector<std::string> takeCalls() { return std::exchange(allocator->calls, {}); }
+};
+
 TEST(VArray, Smoke)
 {
 	VArrayProxy<int>::Ptr array = VArrayProxy<int>::create(1);
@@ -44,4 +102,168 @@ TEST(VArray, Smoke)
 		EXPECT_EQ(values[1], 3);
 		EXPECT_EQ(values[2], 0);
 	}
-}
\ No newline at end of file
+}
+
+TEST_F(VArrayStreams, ReaderInAnotherStreamWaitsForWriter)
+{
+	auto array = VArray::create<int>(0, allocator);
+	array->resizeAsync(4, streamA, false);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 16 device"));
+
+	array->getWritePtr(MemLoc::Device, streamA);
+	array->getReadPtr(MemLoc::Device, streamA);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+
+	array->getReadPtr(MemLoc::Device, streamB);
+	EXPECT_THAT(takeCalls(), ElementsAre("record in stream1", "wait in stream2"));
+
+	// Readers are not tracked, so the writer in the other stream does not wait for the reader
+	array->getWritePtr(MemLoc::Device, streamB);
+	array->getReadPtr(MemLoc::Device, streamB);
+	array->getReadPtr(MemLoc::Device, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("record in stream1", "wait in stream2", "record in stream2", "wait in stream1"));
+}
+
+TEST_F(VArrayStreams, UntrackedDevicePointersDoNotBlock)
+{
+	auto array = VArray::create<int>(4, allocator);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 16 device", "memset 16 in legacy", "record in legacy", "synchronize"));
+
+	array->getWritePtr(MemLoc::Device, streamA);
+	array->getReadPtr(MemLoc::Device);
+	array->resize(2, false);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+}
+
+TEST_F(VArrayStreams, MigrationIsOrderedInStream)
+{
+	auto array = VArrayProxy<int>::create(VArray::create<int>(0, allocator));
+	int values[] = {1, 2, 3};
+	array->copyAsync(values, 3, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 12 device", "copy 12 in stream1"));
+
+	array->untyped()->migrateAsync(MemLoc::Host, streamB);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 12 host", "record in stream1", "wait in stream2", "copy 12 in stream2"));
+
+	// Host has to wait for the copy
+	const int* hostPtr = array->getReadPtr(MemLoc::Host);
+	EXPECT_THAT(takeCalls(), ElementsAre("record in stream2", "synchronize"));
+	EXPECT_THAT(std::vector<int>(hostPtr, hostPtr + 3), ElementsAre(1, 2, 3));
+
+	hostPtr = array->getReadPtr(MemLoc::Host);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+}
+
+TEST_F(VArrayStreams, UnmodifiedDataIsNotCopiedAgain)
+{
+	auto array = VArrayProxy<int>::create(VArray::create<int>(0, allocator));
+	int values[] = {1, 2, 3};
+	array->copyAsync(values, 3, streamA);
+	array->getReadPtr(MemLoc::Host, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 12 device", "copy 12 in stream1", "allocate 12 host", "copy 12 in stream1"));
+
+	// Both copies are valid
+	array->getReadPtr(MemLoc::Device, streamA);
+	array->getReadPtr(MemLoc::Host, streamA);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+
+	// Writing invalidates the other copy, which is refreshed in the existing allocation
+	array->getWritePtr(MemLoc::Device, streamA);
+	array->getReadPtr(MemLoc::Device, streamA);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+	array->getReadPtr(MemLoc::Host, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("copy 12 in stream1"));
+
+	// So does resizing
+	array->resizeAsync(2, streamA, false);
+	array->getReadPtr(MemLoc::Device, streamA);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+	array->getReadPtr(MemLoc::Host, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("copy 8 in stream1"));
+}
+
+TEST_F(VArrayStreams, UnifiedMemoryIsPrefetchedInsteadOfCopied)
+{
+	allocator->unified = true;
+	auto array = VArrayProxy<int>::create(VArray::create<int>(0, allocator));
+	int values[] = {1, 2, 3};
+	array->copyAsync(values, 3, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 12 device", "copy 12 in stream1"));
+
+	// Locations share the allocation
+	const int* hostPtr = array->getReadPtr(MemLoc::Host, streamA);
+	const int* devicePtr = array->getReadPtr(MemLoc::Device, streamA);
+	EXPECT_EQ(hostPtr, devicePtr);
+	EXPECT_THAT(takeCalls(), ElementsAre("prefetch 12 to host in stream1", "prefetch 12 to device in stream1"));
+
+	// Already prefetched, only ordering is needed
+	array->getReadPtr(MemLoc::Device, streamB);
+	EXPECT_THAT(takeCalls(), ElementsAre("record in stream1", "wait in stream2"));
+
+	// Writes do not invalidate anything
+	int* hostWritePtr = array->getWritePtr(MemLoc::Host);
+	EXPECT_EQ(hostWritePtr, hostPtr);
+	EXPECT_THAT(takeCalls(), ElementsAre("record in stream1", "wait in legacy", "prefetch 12 to host in legacy",
+	                                     "record in legacy", "synchronize"));
+	hostWritePtr[0] = 4;
+	array->untyped()->migrateAsync(MemLoc::Device, streamA);
+	EXPECT_THAT(takeCalls(), ElementsAre("prefetch 12 to device in stream1"));
+	EXPECT_THAT(std::vector<int>(devicePtr, devicePtr + 3), ElementsAre(4, 2, 3));
+
+	array.reset();
+	EXPECT_THAT(takeCalls(), ElementsAre("deallocate device in stream1"));
+}
+
+TEST_F(VArrayStreams, GrowingIsOrderedAfterPendingWork)
+{
+	auto array = VArrayProxy<int>::create(VArray::create<int>(0, allocator));
+	int values[] = {1, 2};
+	array->copyAsync(values, 2, streamA);
+	takeCalls();
+
+	array->resizeAsync(3, streamB);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 12 device", "record in stream1", "wait in stream2", "copy 8 in stream2",
+	                                     "deallocate device in stream2", "memset 4 in stream2"));
+
+	// Within capacity
+	array->resizeAsync(1, streamA, false);
+	array->resizeAsync(3, streamA, false);
+	EXPECT_THAT(takeCalls(), IsEmpty());
+
+	array.reset();
+	EXPECT_THAT(takeCalls(), ElementsAre("deallocate device in stream2"));
+	EXPECT_EQ(allocator->eventCount, 0);
+}
+
+TEST_F(VArrayStreams, CapacityFollowsPolicyOfActiveTracker)
+{
+	auto tracker = std::make_shared<MemoryTracker>();
+	tracker->setPolicy({.growthFactor = 2.0f, .shrinkAfterFrames = 2});
+	MemoryTracker::Activation activation {tracker.get()};
+
+	auto array = VArray::create<int>(0, allocator);
+	array->resizeAsync(4, streamA, false);
+	array->resizeAsync(5, streamA, false);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 16 device", "allocate 32 device", "copy 16 in stream1", "deallocate device in stream1"));
+	EXPECT_EQ(array->getElemCapacity(), 8);
+	EXPECT_EQ(tracker->getStats(MemLoc::Device).currentBytes, 32);
+
+	// Capacity is kept for the high-water mark of the window, with the headroom of growth
+	tracker->beginFrame();
+	array->resizeAsync(1, streamA, false);
+	tracker->beginFrame();
+	array->resizeAsync(2, streamA, false);
+	EXPECT_EQ(array->getElemCapacity(), 8);
+	tracker->beginFrame();
+	tracker->beginFrame();
+	array->resizeAsync(2, streamA, false);
+	EXPECT_EQ(array->getElemCapacity(), 4);
+	EXPECT_THAT(takeCalls(), ElementsAre("allocate 16 device", "copy 8 in stream1", "deallocate device in stream1"));
+
+	MemoryTracker::Stats stats = tracker->getStats(MemLoc::Device);
+	EXPECT_EQ(stats.currentBytes, 16);
+	EXPECT_EQ(stats.highWaterBytes, 32);
+	array.reset();
+	EXPECT_EQ(tracker->getStats(MemLoc::Device).currentBytes, 0);
+}
+
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <graph/BranchPlan.hpp>
+
+using namespace ::testing;
+
+static std::vector<std::size_t> getBranchNodes(const BranchPlan& plan, std::size_t branch)
+{
+	std::vector<std::size_t> nodes;
+	for (auto&& step : plan.getBranch(branch)) {
+		nodes.push_back(step.node);
+	}
+	return nodes;
+}
+
+TEST(BranchPlan, ChainIsSingleBranch)
+{
+	// rays -> raytrace -> compact -> yield
+	BranchPlan plan = BranchPlan::build({{}, {0}, {1}, {2}});
+	ASSERT_EQ(plan.getBranchCount(), 1);
+	EXPECT_THAT(getBranchNodes(plan, 0), ElementsAre(0, 1, 2, 3));
+	for (std::size_t node = 0; node < 4; ++node) {
+		EXPECT_FALSE(plan.isWaitedFor(node));
+		EXPECT_THAT(plan.getBranch(0)[node].waitFor, IsEmpty());
+	}
+}
+
+TEST(BranchPlan, ForkAfterRaytrace)
+{
+	// rays(0) -> raytrace(1) -> compact(2) -> format(3) -> yield(4)
+	//                        -> downsample(5) -> pcd(6)
+	//                        -> visualize(7)
+	BranchPlan plan = BranchPlan::build({{}, {0}, {1}, {2}, {3}, {1}, {5}, {1}});
+	ASSERT_EQ(plan.getBranchCount(), 3);
+	EXPECT_THAT(getBranchNodes(plan, 0), ElementsAre(0, 1, 2, 3, 4));
+	EXPECT_THAT(getBranchNodes(plan, 1), ElementsAre(5, 6));
+	EXPECT_THAT(getBranchNodes(plan, 2), ElementsAre(7));
+
+	// Only the fork point is synchronized
+	EXPECT_THAT(plan.getBranch(1)[0].waitFor, ElementsAre(1));
+	EXPECT_THAT(plan.getBranch(1)[1].waitFor, IsEmpty());
+	EXPECT_THAT(plan.getBranch(2)[0].waitFor, ElementsAre(1));
+	for (std::size_t node = 0; node < 8; ++node) {
+		EXPECT_EQ(plan.isWaitedFor(node), node == 1) << node;
+	}
+}
+
+TEST(BranchPlan, JoinWaitsForOtherBranches)
+{
+	// Diamond: 0 -> 1 -> 3, 0 -> 2 -> 3
+	BranchPlan plan = BranchPlan::build({{}, {0}, {0}, {1, 2}});
+	ASSERT_EQ(plan.getBranchCount(), 2);
+	EXPECT_THAT(getBranchNodes(plan, 0), ElementsAre(0, 1, 3));
+	EXPECT_THAT(getBranchNodes(plan, 1), ElementsAre(2));
+	EXPECT_THAT(plan.getBranch(1)[0].waitFor, ElementsAre(0));
+	EXPECT_THAT(plan.getBranch(0)[2].waitFor, ElementsAre(2));
+	EXPECT_TRUE(plan.isWaitedFor(0));
+	EXPECT_FALSE(plan.isWaitedFor(1));
+	EXPECT_TRUE(plan.isWaitedFor(2));
+}
+
+TEST(BranchPlan, IndependentRoots)
+{
+	BranchPlan plan = BranchPlan::build({{}, {}, {0}, {1}});
+	ASSERT_EQ(plan.getBranchCount(), 2);
+	EXPECT_THAT(getBranchNodes(plan, 0), ElementsAre(0, 2));
+	EXPECT_THAT(getBranchNodes(plan, 1), ElementsAre(1, 3));
+	EXPECT_EQ(plan.getBranchOf(3), 1);
+}
+
+TEST(BranchPlan, RejectsNonTopologicalOrder)
+{
+	EXPECT_THROW(BranchPlan::build({{1}, {}}), std::logic_error);
+}
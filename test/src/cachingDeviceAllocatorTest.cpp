@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <set>
+
+#include <CachingDeviceAllocator.hpp>
+
+using namespace ::testing;
+
+// Hands out host memory and lets the test decide when work recorded in streams completes
+struct FakeUpstreamAllocator : DeviceAllocator
+{
+	void* allocate(std::size_t bytes, MemLoc location) override
+	{
+		if (bytes > failAbove) {
+			throw std::runtime_error("out of memory");
+		}
+		allocatedBytes += bytes;
+		void* ptr = std::malloc(bytes);
+		sizes[ptr] = bytes;
+		return ptr;
+	}
+
+	void deallocate(void* ptr, MemLoc location, cudaStream_t stream) override
+	{
+		allocatedBytes -= sizes.at(ptr);
+		sizes.erase(ptr);
+		std::free(ptr);
+	}
+
+	void copyAsync(void* dst, const void* src, std::size_t bytes, cudaStream_t stream) override { std::memcpy(dst, src, bytes); }
+	void memsetAsync(void* dst, int value, std::size_t bytes, cudaStream_t stream) override { std::memset(dst, value, bytes); }
+	cudaEvent_t createEvent() override { return reinterpret_cast<cudaEvent_t>(++eventCount); }
+	void destroyEvent(cudaEvent_t event) override {}
+	void recordEvent(cudaEvent_t event, cudaStream_t stream) override { pendingEvents.insert(event); }
+	void streamWaitEvent(cudaStream_t stream, cudaEvent_t event) override {}
+	void synchronizeEvent(cudaEvent_t event) override { pendingEvents.erase(event); }
+	bool isEventDone(cudaEvent_t event) override { return !pendingEvents.contains(event); }
+
+	void completeAllWork() { pendingEvents.clear(); }
+
+	std::unordered_map<void*, std::size_t> sizes;
+	std::set<cudaEvent_t> pendingEvents;
+	std::size_t allocatedBytes {0};
+	std::size_t failAbove {std::numeric_limits<std::size_t>::max()};
+	uintptr_t eventCount {0};
+};
+
+struct CachingAllocator : Test
+{
+	std::shared_ptr<FakeUpstreamAllocator> upstream = std::make_shared<FakeUpstreamAllocator>();
+	CachingDeviceAllocator allocator {upstream};
+	cudaStream_t stream = reinterpret_cast<cudaStream_t>(1);
+};
+
+TEST(CachingDeviceAllocator, BlockSizes)
+{
+	EXPECT_EQ(CachingDeviceAllocator::getBlockSize(1), CachingDeviceAllocator::MIN_BLOCK_SIZE);
+	EXPECT_EQ(CachingDeviceAllocator::getBlockSize(513), 1024);
+	EXPECT_EQ(CachingDeviceAllocator::getBlockSize(1024), 1024);
+	EXPECT_EQ(CachingDeviceAllocator::getBlockSize(CachingDeviceAllocator::LARGE_BLOCK_SIZE), CachingDeviceAllocator::LARGE_BLOCK_SIZE);
+	EXPECT_EQ(CachingDeviceAllocator::getBlockSize(CachingDeviceAllocator::LARGE_BLOCK_SIZE + 1), 2 * CachingDeviceAllocator::LARGE_BLOCK_SIZE);
+}
+
+TEST_F(CachingAllocator, ReusesBlocksOfTheSameSizeClass)
+{
+	void* first = allocator.allocate(1000, MemLoc::Device);
+	allocator.deallocate(first, MemLoc::Device, nullptr);
+	void* second = allocator.allocate(600, MemLoc::Device);
+	EXPECT_EQ(second, first);
+
+	// Other size classes and locations are served separately
+	void* large = allocator.allocate(5000, MemLoc::Device);
+	void* host = allocator.allocate(600, MemLoc::Host);
+	EXPECT_NE(large, first);
+	EXPECT_NE(host, first);
+
+	auto stats = allocator.getStats(MemLoc::Device);
+	EXPECT_EQ(stats.hitCount, 1);
+	EXPECT_EQ(stats.missCount, 2);
+	EXPECT_EQ(stats.usedBytes, 1024 + 8192);
+	EXPECT_EQ(stats.cachedBytes, 0);
+	allocator.deallocate(large, MemLoc::Device, nullptr);
+	allocator.deallocate(second, MemLoc::Device, nullptr);
+	allocator.deallocate(host, MemLoc::Host, nullptr);
+}
+
+TEST_F(CachingAllocator, DoesNotReuseBlocksUsedByPendingWork)
+{
+	void* first = allocator.allocate(1000, MemLoc::Device);
+	allocator.deallocate(first, MemLoc::Device, stream);
+	void* second = allocator.allocate(1000, MemLoc::Device);
+	EXPECT_NE(second, first);
+
+	upstream->completeAllWork();
+	void* third = allocator.allocate(1000, MemLoc::Device);
+	EXPECT_EQ(third, first);
+	allocator.deallocate(second, MemLoc::Device, stream);
+	allocator.deallocate(third, MemLoc::Device, stream);
+}
+
+TEST_F(CachingAllocator, ReleasesMemoryAboveCacheLimit)
+{
+	allocator.setCacheLimit(MemLoc::Device, 2048);
+	void* small = allocator.allocate(1024, MemLoc::Device);
+	void* large = allocator.allocate(2048, MemLoc::Device);
+	allocator.deallocate(small, MemLoc::Device, stream);
+	allocator.deallocate(large, MemLoc::Device, stream);
+	EXPECT_LE(allocator.getStats(MemLoc::Device).cachedBytes, 2048);
+	EXPECT_EQ(upstream->allocatedBytes, allocator.getStats(MemLoc::Device).cachedBytes);
+
+	allocator.setCacheLimit(MemLoc::Device, 0);
+	EXPECT_EQ(allocator.getStats(MemLoc::Device).cachedBytes, 0);
+	EXPECT_EQ(upstream->allocatedBytes, 0);
+
+	// Without cache, blocks are returned to upstream immediately
+	void* ptr = allocator.allocate(1024, MemLoc::Device);
+	allocator.deallocate(ptr, MemLoc::Device, stream);
+	EXPECT_EQ(upstream->allocatedBytes, 0);
+}
+
+TEST_F(CachingAllocator, ReleasesCacheWhenUpstreamIsOutOfMemory)
+{
+	void* ptr = allocator.allocate(4096, MemLoc::Device);
+	allocator.deallocate(ptr, MemLoc::Device, stream);
+	upstream->failAbove = 4096;
+	EXPECT_THROW(allocator.allocate(1 << 20, MemLoc::Device), std::runtime_error);
+	EXPECT_EQ(allocator.getStats(MemLoc::Device).cachedBytes, 0);
+
+	upstream->failAbove = std::numeric_limits<std::size_t>::max();
+	void* ok = allocator.allocate(1 << 20, MemLoc::Device);
+	EXPECT_NE(ok, nullptr);
+	allocator.deallocate(ok, MemLoc::Device, stream);
+}
+
+TEST_F(CachingAllocator, RejectsForeignPointers)
+{
+	int value;
+	EXPECT_THROW(allocator.deallocate(&value, MemLoc::Device, stream), std::logic_error);
+}
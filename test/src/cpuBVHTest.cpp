@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <cpu/BVH.hpp>
+
+static constexpr int PACKET_SIZE = 8;
+
+struct Triangle
+{
+	Vec3f a, b, c;
+};
+
+static std::vector<Triangle> makeRandomTriangles(std::mt19937& rng, int count)
+{
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::vector<Triangle> triangles;
+	for (int i = 0; i < count; ++i) {
+		Vec3f center {position(rng), position(rng), position(rng)};
+		triangles.push_back({
+			center + Vec3f {offset(rng), offset(rng), offset(rng)},
+			center + Vec3f {offset(rng), offset(rng), offset(rng)},
+			center + Vec3f {offset(rng), offset(rng), offset(rng)},
+		});
+	}
+	return triangles;
+}
+
+static BVH buildBVH(const std::vector<Triangle>& triangles)
+{
+	std::vector<AABB> bounds(triangles.size());
+	for (std::size_t i = 0; i < triangles.size(); ++i) {
+		bounds[i].grow(triangles[i].a);
+		bounds[i].grow(triangles[i].b);
+		bounds[i].grow(triangles[i].c);
+	}
+	return BVH::build(bounds);
+}
+
+// Closest hit distance of each lane, infinity for misses
+static std::array<float, PACKET_SIZE> traceBVH(const BVH& bvh, const std::vector<Triangle>& triangles, RayPacket<PACKET_SIZE> packet)
+{
+	std::array<float, PACKET_SIZE> closest;
+	closest.fill(std::numeric_limits<float>::infinity());
+	bvh.traverse(packet, [&](uint32_t prim, RayPacket<PACKET_SIZE>& rays) {
+		bool hit[PACKET_SIZE];
+		float t[PACKET_SIZE], u[PACKET_SIZE], v[PACKET_SIZE];
+		rays.intersectTriangle(triangles[prim].a, triangles[prim].b, triangles[prim].c, hit, t, u, v);
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			if (hit[lane]) {
+				rays.tMax[lane] = t[lane];
+				closest[lane] = t[lane];
+			}
+		}
+	});
+	return closest;
+}
+
+static std::array<float, PACKET_SIZE> traceBruteForce(const std::vector<Triangle>& triangles, RayPacket<PACKET_SIZE> packet)
+{
+	std::array<float, PACKET_SIZE> closest;
+	closest.fill(std::numeric_limits<float>::infinity());
+	for (auto&& triangle : triangles) {
+		bool hit[PACKET_SIZE];
+		float t[PACKET_SIZE], u[PACKET_SIZE], v[PACKET_SIZE];
+		packet.intersectTriangle(triangle.a, triangle.b, triangle.c, hit, t, u, v);
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			if (hit[lane]) {
+				packet.tMax[lane] = t[lane];
+				closest[lane] = t[lane];
+			}
+		}
+	}
+	return closest;
+}
+
+TEST(CpuBVH, EmptyBVHIsNeverHit)
+{
+	BVH bvh = BVH::build({});
+	EXPECT_TRUE(bvh.isEmpty());
+
+	RayPacket<PACKET_SIZE> packet;
+	packet.setRay(0, {0, 0, 0}, {0, 0, 1}, 100.0f);
+	bool visited = false;
+	bvh.traverse(packet, [&](uint32_t, RayPacket<PACKET_SIZE>&) { visited = true; });
+	EXPECT_FALSE(visited);
+}
+
+TEST(CpuBVH, MatchesBruteForce)
+{
+	std::mt19937 rng(1234);
+	auto triangles = makeRandomTriangles(rng, 2000);
+	BVH bvh = buildBVH(triangles);
+	ASSERT_FALSE(bvh.isEmpty());
+
+	// Packets of coherent rays, as fired by lidars, with some lanes inactive
+	std::uniform_real_distribution<float> angle(-1.0f, 1.0f);
+	int hitCount = 0;
+	for (int packetIdx = 0; packetIdx < 500; ++packetIdx) {
+		RayPacket<PACKET_SIZE> packet;
+		Vec3f origin {angle(rng) * 20.0f, angle(rng) * 20.0f, -20.0f};
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			if ((packetIdx + lane) % 5 == 0) {
+				continue;
+			}
+			Vec3f dir {angle(rng) - origin[0] / 40.0f, angle(rng) - origin[1] / 40.0f, 1.0f};
+			packet.setRay(lane, origin, dir, 1000.0f);
+		}
+		auto expected = traceBruteForce(triangles, packet);
+		auto actual = traceBVH(bvh, triangles, packet);
+		for (int lane = 0; lane < PACKET_SIZE; ++lane) {
+			EXPECT_EQ(actual[lane], expected[lane]) << "packet " << packetIdx << ", lane " << lane;
+			hitCount += std::isfinite(expected[lane]) ? 1 : 0;
+		}
+	}
+	EXPECT_GT(hitCount, 0);
+}
+
+TEST(CpuBVH, CoincidentPrimitives)
+{
+	// Centroids cannot be separated, the builder has to split anyway without exceeding the traversal stack
+	std::vector<Triangle> triangles(1000, Triangle {{-1, -1, 5}, {1, -1, 5}, {0, 1, 5}});
+	BVH bvh = buildBVH(triangles);
+
+	RayPacket<PACKET_SIZE> packet;
+	packet.setRay(0, {0, 0, 0}, {0, 0, 1}, 100.0f);
+	packet.setRay(1, {5, 0, 0}, {0, 0, 1}, 100.0f);
+	auto hits = traceBVH(bvh, triangles, packet);
+	EXPECT_FLOAT_EQ(hits[0], 5.0f);
+	EXPECT_EQ(hits[1], std::numeric_limits<float>::infinity());
+}
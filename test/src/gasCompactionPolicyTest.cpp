@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scene/GASCompactionPolicy.hpp>
+
+using namespace ::testing;
+using Candidate = GASCompactionPolicy::Candidate;
+
+static Candidate stableCandidate(std::size_t size, std::size_t compactedSize)
+{
+	return {
+		.size = size,
+		.compactedSize = compactedSize,
+		.stableFrameCount = GASCompactionPolicy::DEFAULT_STABLE_FRAME_COUNT,
+		.isCompactedSizeKnown = true,
+	};
+}
+
+TEST(GASCompactionPolicy, DefaultCompactsEveryStableArena)
+{
+	GASCompactionPolicy policy;
+	std::vector<Candidate> candidates = {stableCandidate(100, 80), stableCandidate(100, 40)};
+	EXPECT_THAT(policy.select(candidates, 200), ElementsAre(1, 0));
+}
+
+TEST(GASCompactionPolicy, SkipsUnstableAndUnknown)
+{
+	GASCompactionPolicy policy;
+	std::vector<Candidate> candidates = {stableCandidate(100, 80), stableCandidate(100, 40), stableCandidate(100, 10)};
+	candidates[1].stableFrameCount = policy.stableFrameCount - 1;
+	candidates[2].isCompactedSizeKnown = false;
+	EXPECT_THAT(policy.select(candidates, 300), ElementsAre(0));
+}
+
+TEST(GASCompactionPolicy, SkipsArenasWithoutSavings)
+{
+	GASCompactionPolicy policy;
+	std::vector<Candidate> candidates = {stableCandidate(100, 100)};
+	EXPECT_THAT(policy.select(candidates, 100), IsEmpty());
+}
+
+TEST(GASCompactionPolicy, StopsWhenWithinBudget)
+{
+	GASCompactionPolicy policy {.memoryBudget = 250};
+	std::vector<Candidate> candidates = {stableCandidate(100, 90), stableCandidate(100, 50), stableCandidate(100, 70)};
+	// 300 -> 250 after compacting the arena with the largest savings
+	EXPECT_THAT(policy.select(candidates, 300), ElementsAre(1));
+	EXPECT_THAT(policy.select(candidates, 200), IsEmpty());
+}
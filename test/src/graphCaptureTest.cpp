@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+
+#include <graph/GraphCapture.hpp>
+
+using namespace ::testing;
+using Mode = GraphCapture::Mode;
+
+// Records calls instead of using CUDA graphs
+struct MockExecutor : GraphExecutor
+{
+	explicit MockExecutor(std::vector<std::string>& calls) : calls(calls) {}
+
+	void beginCapture(cudaStream_t) override { calls.push_back("begin"); }
+	void endCapture(cudaStream_t) override { calls.push_back(executable ? "update" : "instantiate"); executable = true; }
+	void abortCapture(cudaStream_t) override { calls.push_back("abort"); }
+	void launch(cudaStream_t) override { calls.push_back("launch"); }
+	bool hasExecutable() const override { return executable; }
+	void reset() override { executable = false; }
+
+	std::vector<std::string>& calls;
+	bool executable {false};
+};
+
+struct GraphCaptureTest : Test
+{
+	GraphCaptureTest() : capture(std::make_unique<MockExecutor>(calls)) { capture.setEnabled(true); }
+
+	// Returns the mode and the calls made by the run
+	std::pair<Mode, std::vector<std::string>> run(std::size_t planId)
+	{
+		calls.clear();
+		Mode mode = capture.run({
+			.planId = planId,
+			.nodes = nodes,
+			.capturable = capturable,
+			.prepare = [this]() { return inputsUpToDate; },
+			.schedule = [this]() {
+				calls.push_back("schedule");
+				if (scheduleFailures > 0) {
+					scheduleFailures -= 1;
+					throw std::runtime_error("buffer reallocated");
+				}
+			},
+		}, nullptr);
+		return {mode, calls};
+	}
+
+	std::vector<std::string> calls;
+	GraphCapture capture;
+	std::vector<const void*> nodes {&nodeA, &nodeB};
+	bool capturable {true};
+	bool inputsUpToDate {true};
+	int scheduleFailures {0};
+	int nodeA, nodeB, nodeC;
+};
+
+static GraphCapture::State steadyState()
+{
+	return {
+		.enabled = true,
+		.capturable = true,
+		.hasRecording = true,
+		.sameNodes = true,
+		.samePlan = true,
+		.inputsUpToDate = true,
+		.eagerRunCount = 0,
+	};
+}
+
+TEST(GraphCaptureDecision, ReplaysOnlySteadyState)
+{
+	EXPECT_EQ(GraphCapture::decide(steadyState()), Mode::Replay);
+
+	auto state = steadyState();
+	state.enabled = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Eager);
+
+	state = steadyState();
+	state.capturable = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Eager);
+
+	state = steadyState();
+	state.samePlan = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Update);
+
+	state = steadyState();
+	state.inputsUpToDate = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Update);
+}
+
+TEST(GraphCaptureDecision, RecordsAfterEagerRun)
+{
+	auto state = steadyState();
+	state.hasRecording = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Eager);
+	state.eagerRunCount = 1;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Capture);
+
+	// Recording of other nodes cannot be updated
+	state = steadyState();
+	state.sameNodes = false;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Eager);
+	state.eagerRunCount = 1;
+	EXPECT_EQ(GraphCapture::decide(state), Mode::Capture);
+}
+
+TEST_F(GraphCaptureTest, Disabled)
+{
+	capture.setEnabled(false);
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("schedule")));
+	}
+}
+
+TEST_F(GraphCaptureTest, SteadyStateIsReplayed)
+{
+	EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("schedule")));
+	EXPECT_THAT(run(1), Pair(Mode::Capture, ElementsAre("begin", "schedule", "instantiate", "launch")));
+	EXPECT_THAT(run(1), Pair(Mode::Replay, ElementsAre("launch")));
+	EXPECT_THAT(run(1), Pair(Mode::Replay, ElementsAre("launch")));
+}
+
+TEST_F(GraphCaptureTest, ChangesUpdateRecording)
+{
+	run(1);
+	run(1);
+
+	// Node parameters changed
+	EXPECT_THAT(run(2), Pair(Mode::Update, ElementsAre("begin", "schedule", "update", "launch")));
+	EXPECT_THAT(run(2), Pair(Mode::Replay, ElementsAre("launch")));
+
+	// Scene changed
+	inputsUpToDate = false;
+	EXPECT_THAT(run(2), Pair(Mode::Update, ElementsAre("begin", "schedule", "update", "launch")));
+	inputsUpToDate = true;
+	EXPECT_THAT(run(2), Pair(Mode::Replay, ElementsAre("launch")));
+}
+
+TEST_F(GraphCaptureTest, TopologyChangeFallsBackToEager)
+{
+	run(1);
+	run(1);
+
+	nodes = {&nodeA, &nodeC};
+	EXPECT_THAT(run(2), Pair(Mode::Eager, ElementsAre("schedule")));
+	EXPECT_THAT(run(2), Pair(Mode::Capture, ElementsAre("begin", "schedule", "instantiate", "launch")));
+	EXPECT_THAT(run(2), Pair(Mode::Replay, ElementsAre("launch")));
+}
+
+TEST_F(GraphCaptureTest, FailedUpdateFallsBackToEager)
+{
+	run(1);
+	run(1);
+
+	// E.g. buffers had to grow for more rays
+	scheduleFailures = 1;
+	EXPECT_THAT(run(2), Pair(Mode::Eager, ElementsAre("begin", "schedule", "abort", "schedule")));
+	EXPECT_THAT(run(2), Pair(Mode::Capture, ElementsAre("begin", "schedule", "instantiate", "launch")));
+	EXPECT_THAT(run(2), Pair(Mode::Replay, ElementsAre("launch")));
+}
+
+TEST_F(GraphCaptureTest, PlanFailingToRecordAfterEagerRunStaysEager)
+{
+	run(1);
+	scheduleFailures = 1;
+	EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("begin", "schedule", "abort", "schedule")));
+	EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("schedule")));
+	EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("schedule")));
+
+	// Changed plan is given another chance
+	EXPECT_THAT(run(2), Pair(Mode::Capture, ElementsAre("begin", "schedule", "instantiate", "launch")));
+}
+
+TEST_F(GraphCaptureTest, NotCapturableGraphStaysEager)
+{
+	capturable = false;
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_THAT(run(1), Pair(Mode::Eager, ElementsAre("schedule")));
+	}
+}
+
+TEST_F(GraphCaptureTest, ErrorsOfEagerRunsArePropagated)
+{
+	capture.setEnabled(false);
+	scheduleFailures = 1;
+	EXPECT_THROW(run(1), std::runtime_error);
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include <graph/GraphProfiler.hpp>
+
+TEST(GraphProfiler, StatsOfNoSamples)
+{
+	GraphProfiler::Stats stats = GraphProfiler::computeStats({});
+	EXPECT_EQ(stats.sampleCount, 0);
+	EXPECT_EQ(stats.minMs, 0.0);
+	EXPECT_EQ(stats.avgMs, 0.0);
+	EXPECT_EQ(stats.p99Ms, 0.0);
+}
+
+TEST(GraphProfiler, StatsOfSamples)
+{
+	GraphProfiler::Stats stats = GraphProfiler::computeStats({4.0, 1.0, 3.0, 2.0});
+	EXPECT_EQ(stats.sampleCount, 4);
+	EXPECT_DOUBLE_EQ(stats.minMs, 1.0);
+	EXPECT_DOUBLE_EQ(stats.avgMs, 2.5);
+	EXPECT_DOUBLE_EQ(stats.p99Ms, 4.0);
+}
+
+TEST(GraphProfiler, PercentileIgnoresSingleOutlierOfLargeWindow)
+{
+	// Nearest rank of the 99th percentile of 200 samples is the 198th one
+	std::vector<double> durations(200, 1.0);
+	durations[17] = 100.0;
+	durations[42] = 2.0;
+	GraphProfiler::Stats stats = GraphProfiler::computeStats(durations);
+	EXPECT_DOUBLE_EQ(stats.p99Ms, 1.0);
+
+	durations[43] = 3.0;
+	stats = GraphProfiler::computeStats(durations);
+	EXPECT_DOUBLE_EQ(stats.p99Ms, 2.0);
+}
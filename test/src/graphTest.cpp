@@ -1,10 +1,18 @@
 #include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
 #include <utils.hpp>
 #include <scenes.hpp>
 #include <lidars.hpp>
 #include <RGLFields.hpp>
 
 #include <math/Mat3x4f.hpp>
+#include <gpu/RayReturns.hpp>
+#include <graph/Node.hpp>
+
+using ::testing::HasSubstr;
 
 class Graph : public RGLAutoCleanupTest {};
 
@@ -176,6 +184,1102 @@ TEST_F(Graph, FormatNodeResults)
 	}
 }
 
+TEST_F(Graph, EntityPoseRefit)
+{
+	auto entity = makeEntity(makeCubeMesh());
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	// Moving the entity on every run exercises both IAS refits and periodic full rebuilds
+	for (int i = 0; i < 100; ++i) {
+		float distance = 5.0f + 0.1f * i;
+		rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({0, 0, distance}).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+		Field<XYZ_F32>::type hitPoint;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, &hitPoint));
+		EXPECT_NEAR(hitPoint[2], distance - 1.0f, 1e-4);
+	}
+}
+
+TEST_F(Graph, EntitySlotReuse)
+{
+	auto mesh = makeCubeMesh();
+	std::vector<rgl_entity_t> entities;
+	for (float x : {-3.0f, 0.0f, 3.0f}) {
+		entities.push_back(makeEntity(mesh));
+		rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({x, 0, 5}).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entities.back(), &entityPoseTf));
+	}
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = {
+		Mat3x4f::TRS({-3, 0, 0}).toRGL(),
+		Mat3x4f::TRS({0, 0, 0}).toRGL(),
+		Mat3x4f::TRS({3, 0, 0}).toRGL()
+	};
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, yield));
+
+	int32_t outCount, outSizeOf;
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &outCount, &outSizeOf));
+	EXPECT_EQ(outCount, 3);
+
+	// Removed entity's slot must not be hit
+	ASSERT_RGL_SUCCESS(rgl_entity_destroy(entities[1]));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &outCount, &outSizeOf));
+	EXPECT_EQ(outCount, 2);
+
+	// New entity reuses the free slot
+	entities[1] = makeEntity(mesh);
+	rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({0, 0, 10}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entities[1], &entityPoseTf));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &outCount, &outSizeOf));
+	ASSERT_EQ(outCount, 3);
+
+	std::vector<Field<XYZ_F32>::type> hitPoints(outCount);
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	EXPECT_NEAR(hitPoints[0][2], 4.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[1][2], 9.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[2][2], 4.0f, 1e-4);
+}
+
+TEST_F(Graph, ScenePrepare)
+{
+	// Each entity has its own mesh, so that their GASes are built in a single batch
+	setupBoxesAlongAxes(nullptr);
+	EXPECT_RGL_SUCCESS(rgl_scene_prepare(nullptr));
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, yield));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	int32_t outCount, outSizeOf;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &outCount, &outSizeOf));
+	EXPECT_GT(outCount, 0);
+}
+
+TEST_F(Graph, GASCompaction)
+{
+	// Statistics are cumulative
+	int64_t compactedCountBefore, bytesSavedBefore;
+	EXPECT_RGL_SUCCESS(rgl_scene_get_compaction_stats(nullptr, &compactedCountBefore, &bytesSavedBefore));
+	EXPECT_RGL_SUCCESS(rgl_scene_configure_compaction(nullptr, 0, 0));
+	auto entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({0, 0, 5}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	// Compacted sizes are read back asynchronously, compaction happens in one of the following runs
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		Field<XYZ_F32>::type hitPoint;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, &hitPoint));
+		EXPECT_NEAR(hitPoint[2], 4.0f, 1e-4);
+	}
+
+	int64_t compactedCount, bytesSaved;
+	EXPECT_RGL_SUCCESS(rgl_scene_get_compaction_stats(nullptr, &compactedCount, &bytesSaved));
+	EXPECT_EQ(compactedCount - compactedCountBefore, 1);
+	EXPECT_GT(bytesSaved, bytesSavedBefore);
+	EXPECT_RGL_SUCCESS(rgl_scene_configure_compaction(nullptr, 30, 0));
+}
+
+TEST_F(Graph, MeshDeduplicationCopyOnWrite)
+{
+	EXPECT_RGL_SUCCESS(rgl_configure_mesh_deduplication(true));
+	auto sharedMesh = makeCubeMesh();
+	auto updatedMesh = makeCubeMesh(); // Shares geometry with sharedMesh until updated
+	EXPECT_RGL_SUCCESS(rgl_configure_mesh_deduplication(false));
+
+	auto leftEntity = makeEntity(sharedMesh);
+	auto rightEntity = makeEntity(updatedMesh);
+	rgl_mat3x4f leftPoseTf = Mat3x4f::TRS({-3, 0, 5}).toRGL();
+	rgl_mat3x4f rightPoseTf = Mat3x4f::TRS({3, 0, 5}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(leftEntity, &leftPoseTf));
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(rightEntity, &rightPoseTf));
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = {
+		Mat3x4f::TRS({-3, 0, 0}).toRGL(),
+		Mat3x4f::TRS({3, 0, 0}).toRGL()
+	};
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	std::vector<Field<XYZ_F32>::type> hitPoints(rays.size());
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	EXPECT_NEAR(hitPoints[0][2], 4.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[1][2], 4.0f, 1e-4);
+
+	// Only the updated mesh grows
+	ASSERT_RGL_SUCCESS(rgl_mesh_update_vertices(updatedMesh, cubeVerticesX2, ARRAY_SIZE(cubeVerticesX2)));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	EXPECT_NEAR(hitPoints[0][2], 4.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[1][2], 3.0f, 1e-4);
+}
+
+TEST_F(Graph, MeshUpdateVerticesMany)
+{
+	std::vector<rgl_mesh_t> meshes = { makeCubeMesh(), makeCubeMesh() };
+	auto leftEntity = makeEntity(meshes[0]);
+	auto rightEntity = makeEntity(meshes[1]);
+	rgl_mat3x4f leftPoseTf = Mat3x4f::TRS({-3, 0, 5}).toRGL();
+	rgl_mat3x4f rightPoseTf = Mat3x4f::TRS({3, 0, 5}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(leftEntity, &leftPoseTf));
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(rightEntity, &rightPoseTf));
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays = {
+		Mat3x4f::TRS({-3, 0, 0}).toRGL(),
+		Mat3x4f::TRS({3, 0, 0}).toRGL()
+	};
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	// Invalid vertex count of any mesh rejects the whole call
+	std::vector<const rgl_vec3f*> vertices = { cubeVerticesX2, cubeVerticesX2 };
+	std::vector<int32_t> vertexCounts = { ARRAY_SIZE(cubeVerticesX2), ARRAY_SIZE(cubeVerticesX2) - 1 };
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_mesh_update_vertices_many(meshes.data(), vertices.data(), vertexCounts.data(), meshes.size()), "");
+
+	// Updates take effect in the next run
+	vertexCounts[1] = ARRAY_SIZE(cubeVerticesX2);
+	ASSERT_RGL_SUCCESS(rgl_mesh_update_vertices_many(meshes.data(), vertices.data(), vertexCounts.data(), meshes.size()));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	std::vector<Field<XYZ_F32>::type> hitPoints(rays.size());
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	EXPECT_NEAR(hitPoints[0][2], 3.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[1][2], 3.0f, 1e-4);
+}
+
+TEST_F(Graph, EntityMotionBlur)
+{
+	auto entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f beginPoseTf = Mat3x4f::TRS({0, 0, 5}).toRGL();
+	rgl_mat3x4f endPoseTf = Mat3x4f::TRS({0, 0, 15}).toRGL();
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_entity_set_pose_motion(entity, &beginPoseTf, &endPoseTf, 0.1f, 0.1f), "time_begin < time_end");
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose_motion(entity, &beginPoseTf, &endPoseTf, 0.0f, 0.1f));
+
+	rgl_node_t useRays=nullptr, setTimeOffsets=nullptr, raytrace=nullptr, yield=nullptr;
+	std::vector<rgl_mat3x4f> rays(3, Mat3x4f::identity().toRGL());
+	std::vector<float> timeOffsets = { 0.0f, 0.05f, 0.1f };
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, TIME_STAMP_F64 };
+
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_set_time_offsets(&setTimeOffsets, timeOffsets.data(), timeOffsets.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, setTimeOffsets));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(setTimeOffsets, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	// Each ray sees the entity where it was at the ray's firing time
+	std::vector<Field<XYZ_F32>::type> hitPoints(rays.size());
+	std::vector<Field<TIME_STAMP_F64>::type> timeStamps(rays.size());
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, TIME_STAMP_F64, timeStamps.data()));
+	EXPECT_NEAR(hitPoints[0][2], 4.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[1][2], 9.0f, 1e-4);
+	EXPECT_NEAR(hitPoints[2][2], 14.0f, 1e-4);
+	for (std::size_t i = 0; i < timeOffsets.size(); ++i) {
+		EXPECT_EQ(timeStamps[i], timeOffsets[i]);
+	}
+
+	// Setting a single pose stops the motion
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &endPoseTf));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, hitPoints.data()));
+	for (auto&& hitPoint : hitPoints) {
+		EXPECT_NEAR(hitPoint[2], 14.0f, 1e-4);
+	}
+
+	// Time offsets have to match rays
+	timeOffsets.pop_back();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_set_time_offsets(&setTimeOffsets, timeOffsets.data(), timeOffsets.size()));
+	EXPECT_RGL_STATUS(rgl_graph_run(raytrace), RGL_INVALID_PIPELINE, "time offsets", "TimeOffsetsCount(2)");
+}
+
+TEST_F(Graph, CpuRaytraceBackendMatchesOptix)
+{
+	setupBoxesAlongAxes(nullptr);
+	auto movingEntity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f beginPoseTf = Mat3x4f::TRS({-5, -5, -5}).toRGL();
+	rgl_mat3x4f endPoseTf = Mat3x4f::TRS({-5, 5, -5}, {0, 45, 0}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose_motion(movingEntity, &beginPoseTf, &endPoseTf, 0.0f, 0.1f));
+
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 3.6, 1.8);
+	std::vector<float> timeOffsets(rays.size());
+	for (std::size_t i = 0; i < rays.size(); ++i) {
+		timeOffsets[i] = 0.1f * static_cast<float>(i) / static_cast<float>(rays.size());
+	}
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, IS_HIT_I32 };
+
+	rgl_node_t useRays=nullptr, setTimeOffsets=nullptr, raytrace=nullptr, yield=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_set_time_offsets(&setTimeOffsets, timeOffsets.data(), timeOffsets.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, setTimeOffsets));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(setTimeOffsets, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	auto runWithBackend = [&](rgl_raytrace_backend_t backend, std::vector<Field<XYZ_F32>::type>& xyz, std::vector<Field<IS_HIT_I32>::type>& isHit) {
+		xyz.resize(rays.size());
+		isHit.resize(rays.size());
+		ASSERT_RGL_SUCCESS(rgl_node_raytrace_set_backend(raytrace, backend));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, xyz.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, IS_HIT_I32, isHit.data()));
+	};
+	std::vector<Field<XYZ_F32>::type> optixXYZ, cpuXYZ;
+	std::vector<Field<IS_HIT_I32>::type> optixIsHit, cpuIsHit;
+	runWithBackend(RGL_RAYTRACE_BACKEND_OPTIX, optixXYZ, optixIsHit);
+	runWithBackend(RGL_RAYTRACE_BACKEND_CPU, cpuXYZ, cpuIsHit);
+
+	// Rays grazing triangle edges may differ, hence a small number of mismatches is tolerated
+	std::size_t mismatchCount = 0;
+	for (std::size_t i = 0; i < rays.size(); ++i) {
+		bool match = optixIsHit[i] == cpuIsHit[i];
+		for (int axis = 0; match && optixIsHit[i] && axis < 3; ++axis) {
+			match = std::abs(optixXYZ[i][axis] - cpuXYZ[i][axis]) < 1e-3f;
+		}
+		mismatchCount += match ? 0 : 1;
+	}
+	EXPECT_LE(mismatchCount, rays.size() / 1000);
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_node_raytrace_set_backend(raytrace, static_cast<rgl_raytrace_backend_t>(-1)), "backend");
+}
+
+TEST_F(Graph, MultiReturn)
+{
+	// Two cubes along the first ray; the second ray misses everything
+	for (float z : {5.0f, 10.0f}) {
+		rgl_entity_t entity = makeEntity(makeCubeMesh());
+		rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, z).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	}
+	// Rays avoid the diagonals of cube faces, where neighbouring triangles both report a hit
+	std::vector<rgl_mat3x4f> rays = {
+		Mat3x4f::translation(0.3f, 0.2f, 0).toRGL(),
+		Mat3x4f::TRS({0.3f, 0.2f, 0}, {180, 0, 0}).toRGL(),
+	};
+	constexpr int returnCount = 3;
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, IS_HIT_I32, RAY_IDX_U32, RETURN_TYPE_U8 };
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, yield=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace_set_return_count(raytrace, returnCount));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	// Both faces of the nearer cube and the near face of the farther one
+	float expectedZ[returnCount] = {4.0f, 6.0f, 9.0f};
+	for (auto backend : {RGL_RAYTRACE_BACKEND_OPTIX, RGL_RAYTRACE_BACKEND_CPU}) {
+		ASSERT_RGL_SUCCESS(rgl_node_raytrace_set_backend(raytrace, backend));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+		int32_t pointCount, pointSize;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &pointCount, &pointSize));
+		ASSERT_EQ(pointCount, static_cast<int32_t>(rays.size()) * returnCount);
+
+		std::vector<Field<XYZ_F32>::type> xyz(pointCount);
+		std::vector<Field<IS_HIT_I32>::type> isHit(pointCount);
+		std::vector<Field<RAY_IDX_U32>::type> rayIdx(pointCount);
+		std::vector<Field<RETURN_TYPE_U8>::type> returnType(pointCount);
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, xyz.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, IS_HIT_I32, isHit.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, RAY_IDX_U32, rayIdx.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, RETURN_TYPE_U8, returnType.data()));
+
+		for (int k = 0; k < returnCount; ++k) {
+			EXPECT_TRUE(isHit[k]);
+			EXPECT_NEAR(xyz[k][2], expectedZ[k], 1e-4f);
+			EXPECT_EQ(rayIdx[k], 0);
+			EXPECT_EQ(returnType[k], k);
+
+			EXPECT_FALSE(isHit[returnCount + k]);
+			EXPECT_EQ(rayIdx[returnCount + k], 1);
+			EXPECT_EQ(returnType[returnCount + k], k);
+		}
+	}
+
+	// Changing the return count of an executed graph changes the output size
+	for (int newReturnCount : {1, returnCount}) {
+		ASSERT_RGL_SUCCESS(rgl_node_raytrace_set_return_count(raytrace, newReturnCount));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		int32_t pointCount, pointSize;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &pointCount, &pointSize));
+		EXPECT_EQ(pointCount, static_cast<int32_t>(rays.size()) * newReturnCount);
+		std::vector<Field<XYZ_F32>::type> xyz(pointCount);
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, xyz.data()));
+		EXPECT_NEAR(xyz[0][2], expectedZ[0], 1e-4f);
+	}
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_node_raytrace_set_return_count(raytrace, 0), "return_count");
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_node_raytrace_set_return_count(raytrace, MAX_RETURN_COUNT + 1), "return_count");
+}
+
+TEST_F(Graph, BatchedLidars)
+{
+	// Same setup as in MultiReturn: cubes at z=5 and z=10 along the first ray, the second ray misses everything
+	for (float z : {5.0f, 10.0f}) {
+		rgl_entity_t entity = makeEntity(makeCubeMesh());
+		rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, z).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	}
+	std::vector<rgl_mat3x4f> rays = {
+		Mat3x4f::translation(0.3f, 0.2f, 0).toRGL(),
+		Mat3x4f::TRS({0.3f, 0.2f, 0}, {180, 0, 0}).toRGL(),
+	};
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, IS_HIT_I32 };
+
+	// Two lidars sharing rays, differing in range and number of returns; they are traced by a single launch
+	rgl_node_t useRays=nullptr, raytraceNear=nullptr, raytraceFar=nullptr, yieldNear=nullptr, yieldFar=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytraceNear, nullptr, 7));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytraceFar, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace_set_return_count(raytraceFar, 2));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yieldNear, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yieldFar, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytraceNear));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytraceFar));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytraceNear, yieldNear));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytraceFar, yieldFar));
+
+	for (auto backend : {RGL_RAYTRACE_BACKEND_OPTIX, RGL_RAYTRACE_BACKEND_CPU}) {
+		ASSERT_RGL_SUCCESS(rgl_node_raytrace_set_backend(raytraceNear, backend));
+		ASSERT_RGL_SUCCESS(rgl_node_raytrace_set_backend(raytraceFar, backend));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(useRays));
+
+		int32_t nearCount, farCount, pointSize;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yieldNear, XYZ_F32, &nearCount, &pointSize));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yieldFar, XYZ_F32, &farCount, &pointSize));
+		ASSERT_EQ(nearCount, static_cast<int32_t>(rays.size()));
+		ASSERT_EQ(farCount, static_cast<int32_t>(rays.size()) * 2);
+
+		std::vector<Field<XYZ_F32>::type> nearXYZ(nearCount), farXYZ(farCount);
+		std::vector<Field<IS_HIT_I32>::type> nearHit(nearCount), farHit(farCount);
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yieldNear, XYZ_F32, nearXYZ.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yieldNear, IS_HIT_I32, nearHit.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yieldFar, XYZ_F32, farXYZ.data()));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yieldFar, IS_HIT_I32, farHit.data()));
+
+		EXPECT_TRUE(nearHit[0]);
+		EXPECT_NEAR(nearXYZ[0][2], 4.0f, 1e-4f);
+		EXPECT_FALSE(nearHit[1]);
+
+		EXPECT_TRUE(farHit[0]);
+		EXPECT_NEAR(farXYZ[0][2], 4.0f, 1e-4f);
+		EXPECT_TRUE(farHit[1]);
+		EXPECT_NEAR(farXYZ[1][2], 6.0f, 1e-4f);
+		EXPECT_FALSE(farHit[2]);
+		EXPECT_FALSE(farHit[3]);
+	}
+}
+
+TEST_F(Graph, CaptureFollowsChanges)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 5).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::translation(0.3f, 0.2f, 0).toRGL() };
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, DISTANCE_F32 };
+
+	rgl_node_t useRays=nullptr, transformRays=nullptr, raytrace=nullptr, yield=nullptr;
+	rgl_mat3x4f raysTf = Mat3x4f::identity().toRGL();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, transformRays));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(transformRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_capture(raytrace, true));
+
+	auto expectHit = [&](float z, float distance) {
+		Field<XYZ_F32>::type xyz;
+		Field<DISTANCE_F32>::type dist;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, &xyz));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, DISTANCE_F32, &dist));
+		EXPECT_NEAR(xyz[2], z, 1e-4f);
+		EXPECT_NEAR(dist, distance, 1e-4f);
+	};
+
+	// Eager, recorded and replayed runs
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHit(4.0f, 4.0f);
+	}
+
+	// Node parameters changed
+	raysTf = Mat3x4f::translation(0, 0, 1).toRGL();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+	for (int i = 0; i < 2; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHit(4.0f, 3.0f);
+	}
+
+	// Scene changed
+	entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	for (int i = 0; i < 2; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHit(9.0f, 8.0f);
+	}
+
+	// More rays than buffers can hold
+	std::vector<rgl_mat3x4f> moreRays(64, rays[0]);
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, moreRays.data(), moreRays.size()));
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		int32_t pointCount, pointSize;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &pointCount, &pointSize));
+		EXPECT_EQ(pointCount, static_cast<int32_t>(moreRays.size()));
+	}
+	expectHit(9.0f, 8.0f);
+
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_capture(raytrace, false));
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	expectHit(9.0f, 8.0f);
+}
+
+TEST_F(Graph, CaptureCompactsVaryingHitCount)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 5).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::translation(0.3f, 0, 0).toRGL(), Mat3x4f::translation(1.5f, 0, 0).toRGL() };
+	std::vector<rgl_field_t> fields = { XYZ_F32 };
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, format=nullptr, yield=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_node_points_format(&format, fields.data(), fields.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, fields.data(), fields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, format));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, yield));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_capture(raytrace, true));
+
+	auto expectHits = [&](int32_t hitCount) {
+		for (auto&& [node, field] : {std::pair {format, RGL_FIELD_DYNAMIC_FORMAT}, std::pair {yield, XYZ_F32}}) {
+			int32_t pointCount, pointSize;
+			ASSERT_RGL_SUCCESS(rgl_graph_get_result_size(node, field, &pointCount, &pointSize));
+			ASSERT_EQ(pointCount, hitCount);
+			std::vector<Field<XYZ_F32>::type> xyz(rays.size());  // Room for all rays, only hits are written
+			ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(node, field, xyz.data()));
+			for (int32_t i = 0; i < hitCount; ++i) {
+				EXPECT_NEAR(xyz[i][2], 4.0f, 1e-4f);
+			}
+		}
+	};
+
+	// Eager, recorded and replayed runs
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHits(1);
+	}
+
+	// More hits than in the recorded run
+	entityPoseTf = Mat3x4f::translation(1, 0, 5).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	for (int i = 0; i < 2; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHits(2);
+	}
+
+	// Fewer hits
+	entityPoseTf = Mat3x4f::translation(0, 0, 5).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	for (int i = 0; i < 2; ++i) {
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		expectHits(1);
+	}
+}
+
+TEST_F(Graph, PipelinedFrames)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> yieldFields = { XYZ_F32, DISTANCE_F32 };
+
+	rgl_node_t useRays=nullptr, transformRays=nullptr, raytrace=nullptr, yield=nullptr;
+	rgl_mat3x4f raysTf = Mat3x4f::identity().toRGL();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, transformRays));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(transformRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_configure_pipeline(raytrace, 0), "depth");
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_configure_pipeline(raytrace, 4), "depth");
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_pipeline(raytrace, 3));
+
+	int64_t frameId = 0;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_frame_id(raytrace, &frameId));
+	EXPECT_EQ(frameId, -1);
+	EXPECT_RGL_STATUS(rgl_graph_get_frame_result_data(yield, 0, DISTANCE_F32, &frameId), RGL_INVALID_ARGUMENT, "frame 0", "not been run");
+
+	auto expectFrameDistance = [&](int64_t frame, float distance) {
+		int32_t pointCount, pointSize;
+		Field<DISTANCE_F32>::type dist;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_frame_result_size(yield, frame, DISTANCE_F32, &pointCount, &pointSize));
+		EXPECT_EQ(pointCount, 1);
+		EXPECT_EQ(pointSize, static_cast<int32_t>(sizeof(dist)));
+		ASSERT_RGL_SUCCESS(rgl_graph_get_frame_result_data(yield, frame, DISTANCE_F32, &dist));
+		EXPECT_NEAR(dist, distance, 1e-4f);
+	};
+
+	// Sensor moves towards the cube, results of older frames are read after newer ones are started
+	for (int frame = 0; frame < 3; ++frame) {
+		raysTf = Mat3x4f::translation(0, 0, static_cast<float>(frame)).toRGL();
+		EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		EXPECT_RGL_SUCCESS(rgl_graph_get_frame_id(raytrace, &frameId));
+		EXPECT_EQ(frameId, frame);
+	}
+	for (int frame = 0; frame < 3; ++frame) {
+		expectFrameDistance(frame, 9.0f - static_cast<float>(frame));
+	}
+
+	// Frame 3 reuses the slot of frame 0
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_STATUS(rgl_graph_get_frame_result_data(yield, 0, DISTANCE_F32, &frameId), RGL_INVALID_ARGUMENT, "frame 0", "overwritten");
+	EXPECT_RGL_STATUS(rgl_graph_get_frame_result_data(yield, 4, DISTANCE_F32, &frameId), RGL_INVALID_ARGUMENT, "frame 4", "not been run");
+	expectFrameDistance(1, 8.0f);
+	expectFrameDistance(3, 7.0f);
+
+	// Latest results are still available as usual
+	Field<DISTANCE_F32>::type latestDistance;
+	ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, DISTANCE_F32, &latestDistance));
+	EXPECT_NEAR(latestDistance, 7.0f, 1e-4f);
+
+	// Without pipelining only the last frame is kept
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_pipeline(raytrace, 1));
+	EXPECT_RGL_STATUS(rgl_graph_get_frame_result_data(yield, 3, DISTANCE_F32, &frameId), RGL_INVALID_ARGUMENT, "frame 3", "discarded");
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	expectFrameDistance(4, 7.0f);
+	ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_STATUS(rgl_graph_get_frame_result_data(yield, 4, DISTANCE_F32, &frameId), RGL_INVALID_ARGUMENT, "frame 4", "overwritten");
+	expectFrameDistance(5, 7.0f);
+}
+
+TEST_F(Graph, FusedChainsMatchUnfused)
+{
+	setupBoxesAlongAxes(nullptr);
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+	std::vector<rgl_field_t> fields = { XYZ_F32, DISTANCE_F32 };
+	rgl_mat3x4f firstTf = Mat3x4f::TRS({0.5f, 0.2f, 0.1f}, {5, 10, 15}).toRGL();
+	rgl_mat3x4f secondTf = Mat3x4f::TRS({-1.0f, 0.3f, 0.0f}, {0, 0, 30}).toRGL();
+
+	// Ray transforms are folded into the launch, compaction into formatting
+	rgl_node_t useRaysA=nullptr, firstTfA=nullptr, secondTfA=nullptr, raytraceA=nullptr, compactA=nullptr, formatA=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRaysA, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&firstTfA, &firstTf));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&secondTfA, &secondTf));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytraceA, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compactA));
+	EXPECT_RGL_SUCCESS(rgl_node_points_format(&formatA, fields.data(), fields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRaysA, firstTfA));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(firstTfA, secondTfA));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(secondTfA, raytraceA));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytraceA, compactA));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compactA, formatA));
+
+	// Rays transformed by the second node are used by another node, compacted fields are yielded separately
+	rgl_node_t useRaysB=nullptr, firstTfB=nullptr, secondTfB=nullptr, otherTfB=nullptr, raytraceB=nullptr, compactB=nullptr, yieldB=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRaysB, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&firstTfB, &firstTf));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&secondTfB, &secondTf));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&otherTfB, &secondTf));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytraceB, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compactB));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yieldB, fields.data(), fields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRaysB, firstTfB));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(firstTfB, secondTfB));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(secondTfB, raytraceB));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(secondTfB, otherTfB));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytraceB, compactB));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compactB, yieldB));
+
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytraceA));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytraceB));
+
+	int32_t formattedCount, formattedSize, pointCount, pointSize;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(formatA, RGL_FIELD_DYNAMIC_FORMAT, &formattedCount, &formattedSize));
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yieldB, XYZ_F32, &pointCount, &pointSize));
+	ASSERT_GT(pointCount, 0);
+	ASSERT_EQ(formattedCount, pointCount);
+	ASSERT_EQ(formattedSize, static_cast<int32_t>(sizeof(Field<XYZ_F32>::type) + sizeof(Field<DISTANCE_F32>::type)));
+
+	std::vector<char> formatted(formattedCount * formattedSize);
+	std::vector<Field<XYZ_F32>::type> xyz(pointCount);
+	std::vector<Field<DISTANCE_F32>::type> distance(pointCount);
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(formatA, RGL_FIELD_DYNAMIC_FORMAT, formatted.data()));
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yieldB, XYZ_F32, xyz.data()));
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yieldB, DISTANCE_F32, distance.data()));
+	for (int i = 0; i < pointCount; ++i) {
+		const char* point = formatted.data() + i * formattedSize;
+		EXPECT_EQ(std::memcmp(point, &xyz[i], sizeof(xyz[i])), 0) << "point " << i;
+		EXPECT_EQ(std::memcmp(point + sizeof(xyz[i]), &distance[i], sizeof(distance[i])), 0) << "point " << i;
+	}
+}
+
+TEST_F(Graph, Profiling)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_configure_profiling(raytrace, true, 0), "window_size > 0");
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_profiling(raytrace, true, 3));
+	for (int i = 0; i < 5; ++i) {
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	}
+	// Triggers lazy compaction outside of scheduling, which is not measured
+	int32_t pointCount, pointSize;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(compact, XYZ_F32, &pointCount, &pointSize));
+
+	int32_t profileCount = 0;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_profile(raytrace, nullptr, 0, &profileCount));
+	ASSERT_GE(profileCount, 3);
+	std::vector<rgl_node_profile_t> profiles(profileCount);
+	EXPECT_RGL_SUCCESS(rgl_graph_get_profile(compact, profiles.data(), profiles.size(), &profileCount));
+	ASSERT_EQ(profileCount, static_cast<int32_t>(profiles.size()));
+
+	std::set<rgl_node_t> scheduledNodes;
+	for (auto&& profile : profiles) {
+		if (profile.phase == RGL_PROFILE_PHASE_SCHEDULE) {
+			scheduledNodes.insert(profile.node);
+			EXPECT_EQ(profile.sample_count, 3);  // Limited by the window
+		}
+		EXPECT_LE(profile.host_min_ms, profile.host_avg_ms);
+		EXPECT_LE(profile.host_avg_ms, profile.host_p99_ms);
+		EXPECT_LE(profile.gpu_min_ms, profile.gpu_avg_ms);
+		EXPECT_LE(profile.gpu_avg_ms, profile.gpu_p99_ms);
+	}
+	EXPECT_EQ(scheduledNodes, std::set<rgl_node_t>({useRays, raytrace, compact}));
+
+	std::filesystem::path tracePath = std::filesystem::temp_directory_path() / "RGL-profile.json";
+	EXPECT_RGL_SUCCESS(rgl_graph_write_profile_trace(raytrace, tracePath.string().c_str()));
+	std::ifstream traceFile {tracePath};
+	std::string trace {std::istreambuf_iterator<char>(traceFile), std::istreambuf_iterator<char>()};
+	EXPECT_EQ(trace.rfind("{\"traceEvents\"", 0), 0);
+	EXPECT_NE(trace.find("\"RaytraceNode\""), std::string::npos);
+
+	// Disabling drops collected samples
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_profiling(raytrace, false, 3));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_get_profile(raytrace, nullptr, 0, &profileCount));
+	EXPECT_EQ(profileCount, 0);
+}
+
+TEST_F(Graph, UnchangedNodesAreNotRecomputed)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> yieldFields = { DISTANCE_F32 };
+
+	rgl_node_t useRays=nullptr, transformRays=nullptr, raytrace=nullptr, yield=nullptr;
+	rgl_mat3x4f raysTf = Mat3x4f::identity().toRGL();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, transformRays));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(transformRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	auto runAndGetDistance = [&]() {
+		Field<DISTANCE_F32>::type distance;
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yield, DISTANCE_F32, &distance));
+		return distance;
+	};
+	auto generationOf = [](rgl_node_t node) { return Node::validatePtr(node)->getOutputGeneration(); };
+
+	EXPECT_NEAR(runAndGetDistance(), 9.0f, 1e-4f);
+	auto rayGeneration = generationOf(transformRays);
+	auto hitGeneration = generationOf(raytrace);
+	auto yieldGeneration = generationOf(yield);
+
+	// Static rig in a static scene
+	EXPECT_NEAR(runAndGetDistance(), 9.0f, 1e-4f);
+	EXPECT_EQ(generationOf(transformRays), rayGeneration);
+	EXPECT_EQ(generationOf(raytrace), hitGeneration);
+	EXPECT_NE(generationOf(yield), yieldGeneration);  // Nodes not tracking generations run every time
+
+	// Deforming a mesh used by no entity of the scene does not change the scene
+	rgl_mesh_t otherMesh = makeCubeMesh();
+	ASSERT_RGL_SUCCESS(rgl_mesh_update_vertices(otherMesh, cubeVertices, ARRAY_SIZE(cubeVertices)));
+	EXPECT_NEAR(runAndGetDistance(), 9.0f, 1e-4f);
+	EXPECT_EQ(generationOf(raytrace), hitGeneration);
+
+	// Scene changes, rays do not
+	entityPoseTf = Mat3x4f::translation(0, 0, 20).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	EXPECT_NEAR(runAndGetDistance(), 19.0f, 1e-4f);
+	EXPECT_EQ(generationOf(transformRays), rayGeneration);
+	EXPECT_NE(generationOf(raytrace), hitGeneration);
+	hitGeneration = generationOf(raytrace);
+
+	// Rays change
+	raysTf = Mat3x4f::translation(0, 0, 5).toRGL();
+	EXPECT_RGL_SUCCESS(rgl_node_rays_transform(&transformRays, &raysTf));
+	EXPECT_NEAR(runAndGetDistance(), 14.0f, 1e-4f);
+	EXPECT_NE(generationOf(transformRays), rayGeneration);
+	EXPECT_NE(generationOf(raytrace), hitGeneration);
+}
+
+TEST_F(Graph, MemoryStatsFollowRayCount)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> manyRays = makeLidar3dRays(360, 180, 0.36, 0.18);
+	std::vector<rgl_mat3x4f> fewRays = makeLidar3dRays(360, 180, 3.6, 1.8);
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, manyRays.data(), manyRays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_configure_memory(raytrace, 0.5f, 2), "growth_factor >= 1.0f");
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_configure_memory(raytrace, 1.0f, -1), "shrink_after_frames >= 0");
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_capture(raytrace, false));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_memory(raytrace, 1.0f, 2));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+	int64_t deviceBytes, deviceHighWaterBytes, hostBytes, hostHighWaterBytes;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_memory_stats(raytrace, &deviceBytes, &deviceHighWaterBytes, &hostBytes, &hostHighWaterBytes));
+	EXPECT_GT(deviceBytes, 0);
+	EXPECT_EQ(deviceHighWaterBytes, deviceBytes);
+	int64_t manyRaysBytes = deviceBytes;
+
+	// Capacity left after the larger frames is released once it is not needed for the shrinking window
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, fewRays.data(), fewRays.size()));
+	for (int i = 0; i < 4; ++i) {
+		// Moving the entity makes the raytrace recompute (and resize) its outputs
+		entityPoseTf = Mat3x4f::translation(0, 0, 10 + i).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	}
+	EXPECT_RGL_SUCCESS(rgl_graph_get_memory_stats(raytrace, &deviceBytes, &deviceHighWaterBytes, &hostBytes, &hostHighWaterBytes));
+	EXPECT_LT(deviceBytes, manyRaysBytes);
+	EXPECT_EQ(deviceHighWaterBytes, manyRaysBytes);
+}
+
+TEST_F(Graph, ResultBuffers)
+{
+	rgl_entity_t entity = makeEntity(makeCubeMesh());
+	rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, 10).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, yield=nullptr;
+	std::vector<rgl_field_t> yieldFields = {XYZ_F32};
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, yieldFields.data(), yieldFields.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, yield));
+
+	std::vector<Vec3f> buffer(rays.size());
+	int64_t capacity = buffer.size() * sizeof(Vec3f);
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_bind_result_buffer(raytrace, XYZ_F32, buffer.data(), capacity, RGL_RESULT_BUFFER_HOST), "YieldPointsNode or FormatPointsNode");
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_bind_result_buffer(yield, DISTANCE_F32, buffer.data(), capacity, RGL_RESULT_BUFFER_HOST), "does not yield");
+	EXPECT_RGL_SUCCESS(rgl_graph_bind_result_buffer(yield, XYZ_F32, buffer.data(), capacity, RGL_RESULT_BUFFER_HOST));
+
+	int32_t bufferCount = 0;
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_wait_result_buffer(yield, XYZ_F32, &bufferCount), "has not been written");
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_wait_result_buffer(yield, XYZ_F32, &bufferCount));
+	void* event = nullptr;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_buffer_event(yield, XYZ_F32, &event));
+	EXPECT_NE(event, nullptr);
+
+	int32_t count, sizeOf;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &count, &sizeOf));
+	ASSERT_EQ(bufferCount, count);
+	ASSERT_GT(count, 0);
+	std::vector<Vec3f> copied(count);
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, copied.data()));
+	EXPECT_EQ(std::memcmp(buffer.data(), copied.data(), count * sizeof(Vec3f)), 0);
+
+	// Runs do not write past the bound capacity
+	EXPECT_RGL_SUCCESS(rgl_graph_bind_result_buffer(yield, XYZ_F32, buffer.data(), sizeof(Vec3f), RGL_RESULT_BUFFER_HOST));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_wait(raytrace), "too small");
+	EXPECT_RGL_SUCCESS(rgl_graph_bind_result_buffer(yield, XYZ_F32, nullptr, 0, RGL_RESULT_BUFFER_HOST));
+}
+
+TEST_F(Graph, ExecutionPlanFollowsChanges)
+{
+	setupBoxesAlongAxes(nullptr);
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 3.6, 1.8);
+	std::vector<rgl_field_t> xyzOnly = { XYZ_F32 };
+	std::vector<rgl_field_t> xyzDistance = { XYZ_F32, DISTANCE_F32 };
+
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, yield=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, xyzOnly.data(), xyzOnly.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	int32_t pointCount, pointSize;
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));  // Reuses the plan
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &pointCount, &pointSize));
+	EXPECT_EQ(pointCount, static_cast<int32_t>(rays.size()));
+
+	// Parameter change: the raytrace node has to compute the newly requested field
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield, xyzDistance.data(), xyzDistance.size()));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	std::vector<Field<DISTANCE_F32>::type> distance(rays.size());
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yield, DISTANCE_F32, distance.data()));
+
+	// Topology change: non-hits get removed
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_remove_child(raytrace, yield));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, yield));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yield, XYZ_F32, &pointCount, &pointSize));
+	EXPECT_GT(pointCount, 0);
+	EXPECT_LT(pointCount, static_cast<int32_t>(rays.size()));
+
+	// Validation errors are reported again on every run until fixed
+	EXPECT_RGL_SUCCESS(rgl_graph_node_remove_child(useRays, raytrace));
+	EXPECT_RGL_STATUS(rgl_graph_run(raytrace), RGL_INVALID_PIPELINE, "looked for", "IRaysNode");
+	EXPECT_RGL_STATUS(rgl_graph_run(raytrace), RGL_INVALID_PIPELINE, "looked for", "IRaysNode");
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+}
+
+TEST_F(Graph, AsyncRun)
+{
+	setupBoxesAlongAxes(nullptr);
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+	std::vector<rgl_field_t> fields = { XYZ_F32 };
+
+	// Two independent graphs, executing concurrently
+	rgl_node_t useRays[2] = {}, raytrace[2] = {}, yield[2] = {};
+	for (int i = 0; i < 2; ++i) {
+		EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays[i], rays.data(), rays.size()));
+		EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace[i], nullptr, 1000));
+		EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield[i], fields.data(), fields.size()));
+		EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays[i], raytrace[i]));
+		EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace[i], yield[i]));
+	}
+
+	bool isDone = false;
+	EXPECT_RGL_SUCCESS(rgl_graph_is_done(raytrace[0], &isDone));
+	EXPECT_TRUE(isDone);  // Never run
+
+	for (int frame = 0; frame < 3; ++frame) {
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace[0]));
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace[1]));
+
+		// The first graph is waited for explicitly, the second one implicitly when reading its results
+		EXPECT_RGL_SUCCESS(rgl_graph_wait(yield[0]));
+		EXPECT_RGL_SUCCESS(rgl_graph_is_done(raytrace[0], &isDone));
+		EXPECT_TRUE(isDone);
+
+		std::vector<Field<XYZ_F32>::type> xyz[2];
+		for (int i = 0; i < 2; ++i) {
+			int32_t pointCount, pointSize;
+			EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(yield[i], XYZ_F32, &pointCount, &pointSize));
+			EXPECT_EQ(pointCount, static_cast<int32_t>(rays.size()));
+			xyz[i].resize(pointCount);
+			EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(yield[i], XYZ_F32, xyz[i].data()));
+		}
+		for (std::size_t p = 0; p < rays.size(); ++p) {
+			EXPECT_EQ(xyz[0][p][0], xyz[1][p][0]);
+		}
+
+		// Scene modifications do not wait for running graphs
+		rgl_mat3x4f entityPoseTf = Mat3x4f::translation(0, 0, static_cast<float>(frame)).toRGL();
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace[0]));
+		EXPECT_RGL_SUCCESS(rgl_entity_set_pose(makeEntity(), &entityPoseTf));
+		EXPECT_RGL_SUCCESS(rgl_graph_wait(raytrace[0]));
+	}
+
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_wait(nullptr), "node != nullptr");
+	EXPECT_RGL_INVALID_ARGUMENT(rgl_graph_is_done(raytrace[0], nullptr), "out_done != nullptr");
+}
+
+TEST_F(Graph, ConcurrentGraphsFollowSceneUpdates)
+{
+	auto entity = makeEntity(makeCubeMesh());
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> fields = { XYZ_F32 };
+
+	rgl_node_t useRays[2] = {}, raytrace[2] = {}, yield[2] = {};
+	for (int i = 0; i < 2; ++i) {
+		EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays[i], rays.data(), rays.size()));
+		EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace[i], nullptr, 1000));
+		EXPECT_RGL_SUCCESS(rgl_node_points_yield(&yield[i], fields.data(), fields.size()));
+		EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays[i], raytrace[i]));
+		EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace[i], yield[i]));
+	}
+
+	// Whichever graph is scheduled first updates the scene in its stream, the other one has to wait for the update
+	for (int frame = 0; frame < 100; ++frame) {
+		float distance = 5.0f + 0.1f * frame;
+		rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({0, 0, distance}).toRGL();
+		ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace[frame % 2]));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace[(frame + 1) % 2]));
+
+		for (int i = 0; i < 2; ++i) {
+			Field<XYZ_F32>::type hitPoint;
+			ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield[i], XYZ_F32, &hitPoint));
+			EXPECT_NEAR(hitPoint[2], distance - 1.0f, 1e-4) << "graph " << i << ", frame " << frame;
+		}
+	}
+}
+
+TEST_F(Graph, SceneUpdatesDuringRuns)
+{
+	rgl_mesh_t mesh = makeCubeMesh();
+	rgl_entity_t entity = makeEntity(mesh);
+	rgl_mat3x4f entityPoseTf = Mat3x4f::TRS({0, 0, 5}).toRGL();
+	ASSERT_RGL_SUCCESS(rgl_entity_set_pose(entity, &entityPoseTf));
+	std::vector<rgl_mat3x4f> rays = { Mat3x4f::identity().toRGL() };
+	std::vector<rgl_field_t> fields = { XYZ_F32 };
+
+	rgl_node_t useRays = nullptr, raytrace = nullptr, yield = nullptr;
+	ASSERT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	ASSERT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	ASSERT_RGL_SUCCESS(rgl_node_points_yield(&yield, fields.data(), fields.size()));
+	ASSERT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	ASSERT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, yield));
+
+	// Modifications made while the graph runs are seen by its next run
+	for (int frame = 0; frame < 20; ++frame) {
+		bool enlarged = frame % 2 == 0;
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+		ASSERT_RGL_SUCCESS(rgl_mesh_update_vertices(mesh, enlarged ? cubeVerticesX2 : cubeVertices, ARRAY_SIZE(cubeVertices)));
+		ASSERT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+		Field<XYZ_F32>::type hitPoint;
+		ASSERT_RGL_SUCCESS(rgl_graph_get_result_data(yield, XYZ_F32, &hitPoint));
+		EXPECT_NEAR(hitPoint[2], enlarged ? 3.0f : 4.0f, 1e-4) << "frame " << frame;
+	}
+}
+
+TEST_F(Graph, ParallelBranches)
+{
+	setupBoxesAlongAxes(nullptr);
+	std::vector<rgl_mat3x4f> rays = makeLidar3dRays(360, 180, 0.36, 0.18);
+	std::vector<rgl_field_t> fields = { XYZ_F32, IS_HIT_I32 };
+
+	// Raytrace forks into compact -> yield, yield and downsample -> yield branches
+	rgl_node_t useRays=nullptr, raytrace=nullptr, compact=nullptr, compactYield=nullptr, rawYield=nullptr, downsample=nullptr, downsampleYield=nullptr;
+	EXPECT_RGL_SUCCESS(rgl_node_rays_from_mat3x4f(&useRays, rays.data(), rays.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_raytrace(&raytrace, nullptr, 1000));
+	EXPECT_RGL_SUCCESS(rgl_node_points_compact(&compact));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&compactYield, fields.data(), 1));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&rawYield, fields.data(), fields.size()));
+	EXPECT_RGL_SUCCESS(rgl_node_points_downsample(&downsample, 1.0f, 1.0f, 1.0f));
+	EXPECT_RGL_SUCCESS(rgl_node_points_yield(&downsampleYield, fields.data(), 1));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(useRays, raytrace));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, compact));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, compactYield));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(raytrace, rawYield));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(compact, downsample));
+	EXPECT_RGL_SUCCESS(rgl_graph_node_add_child(downsample, downsampleYield));
+
+	for (int frame = 0; frame < 5; ++frame) {
+		EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
+
+		std::vector<Field<IS_HIT_I32>::type> isHit(rays.size());
+		EXPECT_RGL_SUCCESS(rgl_graph_get_result_data(rawYield, IS_HIT_I32, isHit.data()));
+		int32_t hitCount = std::count_if(isHit.begin(), isHit.end(), [](auto&& hit) { return hit != 0; });
+
+		int32_t compactCount, downsampleCount, pointSize;
+		EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(compactYield, XYZ_F32, &compactCount, &pointSize));
+		EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(downsampleYield, XYZ_F32, &downsampleCount, &pointSize));
+		EXPECT_GT(hitCount, 0);
+		EXPECT_EQ(compactCount, hitCount);
+		EXPECT_GT(downsampleCount, 0);
+		EXPECT_LE(downsampleCount, compactCount);
+	}
+}
+
 /* TEST_F(Pipeline, AWSIM)
 {
 	setupBoxesAlongAxes(nullptr);
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scene/SceneUpdatePlan.hpp>
+
+using namespace ::testing;
+using Step = SceneUpdatePlan::Step;
+
+// Records steps in the order they would be executed by a CUDA stream.
+struct MockStream
+{
+	void operator()(Step step) { enqueued.push_back(step); }
+	std::vector<Step> enqueued;
+};
+
+static std::vector<Step> enqueue(const SceneUpdatePlan& plan)
+{
+	MockStream stream;
+	plan.enqueue(stream);
+	return stream.enqueued;
+}
+
+static SceneUpdatePlan::ASState upToDateAS()
+{
+	return {
+		.hasAS = true,
+		.meshesPendingBuild = false,
+		.instanceCountChanged = false,
+		.instancesModified = false,
+		.meshesModified = false,
+		.compactionDue = false,
+		.refitCount = 0,
+		.maxRefitCount = 8,
+	};
+}
+
+TEST(SceneUpdatePlan, UpToDateSceneEnqueuesNothing)
+{
+	EXPECT_TRUE(SceneUpdatePlan::forAS(upToDateAS()).isEmpty());
+	EXPECT_TRUE(SceneUpdatePlan::forSBT({.hasSBT = true, .recordCountChanged = false, .recordsModified = false}).isEmpty());
+}
+
+TEST(SceneUpdatePlan, FirstBuild)
+{
+	auto state = upToDateAS();
+	state.hasAS = false;
+	state.instanceCountChanged = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UploadInstances, Step::BuildIAS));
+
+	state.meshesPendingBuild = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::BuildGAS, Step::UploadInstances, Step::BuildIAS));
+
+	auto sbtPlan = SceneUpdatePlan::forSBT({.hasSBT = false, .recordCountChanged = true, .recordsModified = true});
+	EXPECT_THAT(enqueue(sbtPlan), ElementsAre(Step::UploadHitgroupRecords, Step::BuildSBT));
+}
+
+TEST(SceneUpdatePlan, TransformChangeRefitsAfterUpload)
+{
+	auto state = upToDateAS();
+	state.instancesModified = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UploadInstances, Step::RefitIAS));
+}
+
+TEST(SceneUpdatePlan, MeshUpdateRefitsGASBeforeIAS)
+{
+	auto state = upToDateAS();
+	state.meshesModified = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UpdateGAS, Step::RefitIAS));
+
+	state.instancesModified = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UpdateGAS, Step::UploadInstances, Step::RefitIAS));
+}
+
+TEST(SceneUpdatePlan, InstanceCountChangeForcesRebuild)
+{
+	auto state = upToDateAS();
+	state.instanceCountChanged = true;
+	state.instancesModified = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UploadInstances, Step::BuildIAS));
+}
+
+TEST(SceneUpdatePlan, RefitLimitForcesRebuild)
+{
+	auto state = upToDateAS();
+	state.instancesModified = true;
+	state.refitCount = state.maxRefitCount;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UploadInstances, Step::BuildIAS));
+
+	// Limit alone does not trigger any work
+	state.instancesModified = false;
+	EXPECT_TRUE(SceneUpdatePlan::forAS(state).isEmpty());
+}
+
+TEST(SceneUpdatePlan, CompactionUpdatesInstances)
+{
+	auto state = upToDateAS();
+	state.compactionDue = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::CompactGAS, Step::UploadInstances, Step::RefitIAS));
+
+	state.meshesModified = true;
+	EXPECT_THAT(enqueue(SceneUpdatePlan::forAS(state)), ElementsAre(Step::UpdateGAS, Step::CompactGAS, Step::UploadInstances, Step::RefitIAS));
+}
+
+TEST(SceneUpdatePlan, HitgroupRecordChangeKeepsSBT)
+{
+	auto plan = SceneUpdatePlan::forSBT({.hasSBT = true, .recordCountChanged = false, .recordsModified = true});
+	EXPECT_THAT(enqueue(plan), ElementsAre(Step::UploadHitgroupRecords));
+}
@@ -19,6 +19,11 @@ TEST_F(Tape, RecordPlayAllCalls)
 	int32_t major, minor, patch;
 	EXPECT_RGL_SUCCESS(rgl_get_version_info(&major, &minor, &patch));
 	EXPECT_RGL_SUCCESS(rgl_configure_logging(RGL_LOG_LEVEL_DEBUG, "Tape.RecordPlayAllCalls.log", true));
+	EXPECT_RGL_SUCCESS(rgl_configure_memory_pool(RGL_MEMORY_POOL_DEVICE, 256 << 20));
+	EXPECT_RGL_SUCCESS(rgl_configure_memory_mode(RGL_MEMORY_MODE_AUTO));
+
+	int64_t usedBytes, cachedBytes, hitCount, missCount;
+	EXPECT_RGL_SUCCESS(rgl_get_memory_pool_stats(RGL_MEMORY_POOL_HOST_PINNED, &usedBytes, &cachedBytes, &hitCount, &missCount));
 
 	rgl_mesh_t mesh = nullptr;
 	EXPECT_RGL_SUCCESS(rgl_mesh_create(&mesh, cubeVertices, ARRAY_SIZE(cubeVertices), cubeIndices, ARRAY_SIZE(cubeIndices)));
@@ -71,8 +76,28 @@ TEST_F(Tape, RecordPlayAllCalls)
 
 	EXPECT_RGL_SUCCESS(rgl_graph_node_remove_child(raytrace, compact));
 
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_capture(raytrace, false));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_pipeline(raytrace, 1));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_profiling(raytrace, true, 1));
+	EXPECT_RGL_SUCCESS(rgl_graph_configure_memory(raytrace, 2.0f, 16));
 	EXPECT_RGL_SUCCESS(rgl_graph_run(raytrace));
 
+	int64_t frameId;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_frame_id(raytrace, &frameId));
+
+	int32_t profileCount;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_profile(raytrace, nullptr, 0, &profileCount));
+	EXPECT_RGL_SUCCESS(rgl_graph_write_profile_trace(raytrace, "Tape.RecordPlayAllCalls.json"));
+
+	int64_t deviceBytes, deviceHighWaterBytes, hostBytes, hostHighWaterBytes;
+	EXPECT_RGL_SUCCESS(rgl_graph_get_memory_stats(raytrace, &deviceBytes, &deviceHighWaterBytes, &hostBytes, &hostHighWaterBytes));
+
+	bool isDone;
+	EXPECT_RGL_SUCCESS(rgl_graph_is_done(raytrace, &isDone));
+	EXPECT_RGL_SUCCESS(rgl_graph_wait(raytrace));
+
+	EXPECT_RGL_SUCCESS(rgl_graph_bind_result_buffer(format, RGL_FIELD_DYNAMIC_FORMAT, nullptr, 0, RGL_RESULT_BUFFER_HOST));
+
 	int32_t outCount, outSizeOf;
 	EXPECT_RGL_SUCCESS(rgl_graph_get_result_size(format, RGL_FIELD_DYNAMIC_FORMAT, &outCount, &outSizeOf));
 
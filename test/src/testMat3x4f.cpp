@@ -21,3 +21,15 @@ TEST(Mat3x4f, Multiplication)
 
 	EXPECT_EQ(lhs * rhs, gold);
 }
+
+TEST(Mat3x4f, Inverse)
+{
+	Mat3x4f tf = Mat3x4f::TRS({1, -2, 3}, {30, 45, 60}, {2, 0.5, 1});
+	Mat3x4f identity = Mat3x4f::identity();
+	Mat3x4f lhsProduct = tf * tf.inverse();
+	Mat3x4f rhsProduct = tf.inverse() * tf;
+	for (int i = 0; i < Mat3x4f::ROWS * Mat3x4f::COLS; ++i) {
+		EXPECT_NEAR(lhsProduct[i], identity[i], 1e-6);
+		EXPECT_NEAR(rhsProduct[i], identity[i], 1e-6);
+	}
+}